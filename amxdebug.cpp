@@ -0,0 +1,295 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#if defined _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <dirent.h>
+#endif
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "amxdebug.h"
+#include "mappedfile.h"
+
+
+namespace amxdebug
+{
+
+	namespace
+	{
+
+		const char *const SCRIPT_DIRS[] = { "gamemodes", "filterscripts", "npcmodes" };
+		const char AMX_FILE_EXT[] = ".amx";
+
+		// From amxdbg.h.
+		const uint16_t AMX_DBG_MAGIC = 0xF1EF;
+		const char IDENT_FUNCTION = 9;
+
+		/*
+			Reads the tables one record at a time, checking every read
+			against the end of the debug info.
+		*/
+		class Reader
+		{
+		public:
+			Reader(const char *data, size_t size) : pos(data), end(data + size) {}
+
+			template <typename T>
+			bool Get(T &value)
+			{
+				if ((size_t)(end - pos) < sizeof(T))
+					return false;
+				memcpy(&value, pos, sizeof(T));
+				pos += sizeof(T);
+				return true;
+			}
+
+			bool GetString(std::string &str)
+			{
+				const char *terminator = (const char *)memchr(pos, '\0', (size_t)(end - pos));
+				if (terminator == NULL)
+					return false;
+				str.assign(pos, terminator);
+				pos = terminator + 1;
+				return true;
+			}
+
+			bool Skip(size_t size)
+			{
+				if ((size_t)(end - pos) < size)
+					return false;
+				pos += size;
+				return true;
+			}
+
+			bool AtEnd() const { return pos == end; }
+			const char *GetPos() const { return pos; }
+
+		private:
+			const char *pos, *end;
+		};
+
+		/*
+			The tables come in this order: files, lines, symbols, tags,
+			automatons and states. Only the first three are kept, the rest
+			is read to check that the whole thing was understood.
+		*/
+		bool Parse(const char *data, size_t size, DebugInfo &info)
+		{
+			// The header: size (of everything, the header included), magic,
+			// versions, flags, then the number of entries in each table.
+			Reader hdr_reader(data, size);
+			int32_t total_size;
+			uint16_t magic;
+			char file_version, amx_version;
+			int16_t flags;
+			uint16_t num_files, num_lines, num_symbols, num_tags, num_automatons, num_states;
+			if (!hdr_reader.Get(total_size) || !hdr_reader.Get(magic) || !hdr_reader.Get(file_version) ||
+				!hdr_reader.Get(amx_version) || !hdr_reader.Get(flags) || !hdr_reader.Get(num_files) ||
+				!hdr_reader.Get(num_lines) || !hdr_reader.Get(num_symbols) || !hdr_reader.Get(num_tags) ||
+				!hdr_reader.Get(num_automatons) || !hdr_reader.Get(num_states))
+			{
+				return false;
+			}
+			const size_t hdr_size = (size_t)(hdr_reader.GetPos() - data);
+			if (magic != AMX_DBG_MAGIC || total_size < (int32_t)hdr_size || (size_t)total_size > size)
+				return false;
+			Reader reader(data + hdr_size, (size_t)total_size - hdr_size);
+			std::string name;
+			for (uint16_t i = 0; i < num_files; ++i)
+			{
+				File file;
+				if (!reader.Get(file.address) || !reader.GetString(file.name))
+					return false;
+				info.files.push_back(file);
+			}
+			for (uint16_t i = 0; i < num_lines; ++i)
+			{
+				Line line;
+				if (!reader.Get(line.address) || !reader.Get(line.line))
+					return false;
+				info.lines.push_back(line);
+			}
+			for (uint16_t i = 0; i < num_symbols; ++i)
+			{
+				ucell address, start, end;
+				int16_t tag, dim;
+				char ident, vclass;
+				if (!reader.Get(address) || !reader.Get(tag) || !reader.Get(start) || !reader.Get(end) ||
+					!reader.Get(ident) || !reader.Get(vclass) || !reader.Get(dim) || !reader.GetString(name) ||
+					dim < 0 || !reader.Skip((size_t)dim * (sizeof(int16_t) + sizeof(ucell))))
+				{
+					return false;
+				}
+				if (ident == IDENT_FUNCTION && start < end)
+				{
+					Function func;
+					func.start = start;
+					func.end = end;
+					func.name = name;
+					info.functions.push_back(func);
+				}
+			}
+			for (uint16_t i = 0; i < num_tags; ++i)
+			{
+				int16_t id;
+				if (!reader.Get(id) || !reader.GetString(name))
+					return false;
+			}
+			for (uint16_t i = 0; i < num_automatons; ++i)
+			{
+				int16_t id;
+				ucell address;
+				if (!reader.Get(id) || !reader.Get(address) || !reader.GetString(name))
+					return false;
+			}
+			for (uint16_t i = 0; i < num_states; ++i)
+			{
+				int16_t id, automaton;
+				if (!reader.Get(id) || !reader.Get(automaton) || !reader.GetString(name))
+					return false;
+			}
+			// The counts are 16-bit, a huge script may have overflowed them.
+			if (!reader.AtEnd())
+				return false;
+			std::sort(info.functions.begin(), info.functions.end(), [](const Function &a, const Function &b)
+			{
+				return a.start < b.start;
+			});
+			std::sort(info.lines.begin(), info.lines.end(), [](const Line &a, const Line &b)
+			{
+				return a.address < b.address;
+			});
+			std::sort(info.files.begin(), info.files.end(), [](const File &a, const File &b)
+			{
+				return a.address < b.address;
+			});
+			return true;
+		}
+
+		/*
+			Everything up to the code is left alone when the server loads
+			the script, except for the native table (amx_Register writes
+			the addresses of the natives into it) and the header's flags.
+		*/
+		bool IsScriptFile(AMX *amx, const char *data, size_t size)
+		{
+			const AMX_HEADER *hdr = (const AMX_HEADER *)amx->base;
+			AMX_HEADER file_hdr;
+			if (size < sizeof(file_hdr))
+				return false;
+			memcpy(&file_hdr, data, sizeof(file_hdr));
+			if (file_hdr.magic != hdr->magic || file_hdr.file_version != hdr->file_version ||
+				file_hdr.amx_version != hdr->amx_version || file_hdr.defsize != hdr->defsize ||
+				file_hdr.cod != hdr->cod || file_hdr.dat != hdr->dat || file_hdr.hea != hdr->hea ||
+				file_hdr.stp != hdr->stp || file_hdr.cip != hdr->cip || file_hdr.publics != hdr->publics ||
+				file_hdr.natives != hdr->natives || file_hdr.libraries != hdr->libraries ||
+				file_hdr.pubvars != hdr->pubvars || file_hdr.tags != hdr->tags ||
+				file_hdr.nametable != hdr->nametable)
+			{
+				return false;
+			}
+			if (file_hdr.size <= file_hdr.cod || (size_t)file_hdr.size > size || file_hdr.natives < file_hdr.publics)
+				return false;
+			const size_t publics = (size_t)file_hdr.publics, natives = (size_t)file_hdr.natives;
+			if (memcmp(data + publics, amx->base + publics, natives - publics) != 0)
+				return false;
+			if (file_hdr.nametable > 0 && file_hdr.nametable < file_hdr.cod)
+			{
+				const size_t nametable = (size_t)file_hdr.nametable, cod = (size_t)file_hdr.cod;
+				if (memcmp(data + nametable, amx->base + nametable, cod - nametable) != 0)
+					return false;
+			}
+			return true;
+		}
+
+		bool HasAmxExt(const char *file_name)
+		{
+			const size_t len = strlen(file_name), ext_len = sizeof(AMX_FILE_EXT) - 1;
+			return len > ext_len && strcmp(&file_name[len - ext_len], AMX_FILE_EXT) == 0;
+		}
+
+		void ListScripts(const std::string &dir, std::vector<std::string> &paths)
+		{
+#if defined _WIN32
+			WIN32_FIND_DATAA find_data;
+			const HANDLE find_handle = FindFirstFileA((dir + "\\*" + AMX_FILE_EXT).c_str(), &find_data);
+			if (find_handle == INVALID_HANDLE_VALUE)
+				return;
+			do
+			{
+				if (HasAmxExt(find_data.cFileName))
+					paths.push_back(dir + "/" + find_data.cFileName);
+			} while (FindNextFileA(find_handle, &find_data));
+			FindClose(find_handle);
+#else
+			DIR *dir_handle = opendir(dir.c_str());
+			if (dir_handle == NULL)
+				return;
+			while (struct dirent *entry = readdir(dir_handle))
+				if (HasAmxExt(entry->d_name))
+					paths.push_back(dir + "/" + entry->d_name);
+			closedir(dir_handle);
+#endif
+		}
+
+		template <typename T>
+		const T *FindLast(const std::vector<T> &entries, ucell address, ucell T::*start)
+		{
+			typename std::vector<T>::const_iterator it = std::upper_bound(entries.begin(), entries.end(), address,
+				[start](ucell value, const T &entry) { return value < entry.*start; });
+			return (it == entries.begin()) ? NULL : &*(it - 1);
+		}
+
+	}
+
+	bool Load(AMX *amx, DebugInfo &info)
+	{
+		std::vector<std::string> paths;
+		for (size_t i = 0; i < sizeof(SCRIPT_DIRS) / sizeof(SCRIPT_DIRS[0]); ++i)
+			ListScripts(SCRIPT_DIRS[i], paths);
+		bool found = false;
+		for (size_t i = 0; i < paths.size(); ++i)
+		{
+			MappedFile file;
+			if (!file.Open(paths[i].c_str()))
+				continue;
+			const char *data = (const char *)file.GetData();
+			if (!IsScriptFile(amx, data, file.GetSize()))
+				continue;
+			// E.g. a copy of the gamemode in filterscripts: there's no telling
+			// which one was loaded, and they may have been built differently.
+			if (found)
+				return info = DebugInfo(), false;
+			found = true;
+			const AMX_HEADER *hdr = (const AMX_HEADER *)(const void *)data;
+			if ((hdr->flags & AMX_FLAG_DEBUG) == 0)
+				continue;
+			const size_t offset = (size_t)hdr->size;
+			if (!Parse(data + offset, file.GetSize() - offset, info))
+				info = DebugInfo();
+		}
+		return !info.functions.empty();
+	}
+
+	const Function *FindFunction(const DebugInfo &info, cell address)
+	{
+		const Function *func = FindLast(info.functions, (ucell)address, &Function::start);
+		return (func != NULL && (ucell)address < func->end) ? func : NULL;
+	}
+
+	const Line *FindLine(const DebugInfo &info, cell address)
+	{
+		return FindLast(info.lines, (ucell)address, &Line::address);
+	}
+
+	const File *FindFile(const DebugInfo &info, cell address)
+	{
+		return FindLast(info.files, (ucell)address, &File::address);
+	}
+
+}
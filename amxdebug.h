@@ -0,0 +1,67 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _AMXDEBUG_H
+#define _AMXDEBUG_H
+
+#include <string>
+#include <vector>
+#include "SDK/amx/amx.h"
+
+
+/*
+	The symbolic information the compiler appends to a .amx file when it's
+	built with -d1 or higher: the functions (including stocks and static
+	ones, unlike the publics table), the source files and the line table.
+
+	The server doesn't keep it in memory, so the file of a loaded script is
+	looked for in gamemodes/, filterscripts/ and npcmodes/: a file matches
+	if its header and public function table are the same as the script's.
+	If several files match, none is used, as the names could be wrong.
+*/
+namespace amxdebug
+{
+
+	struct Function
+	{
+		ucell start, end; // [start, end) in the code section.
+		std::string name;
+	};
+
+	struct Line
+	{
+		ucell address;
+		int32_t line; // Counted from 0.
+	};
+
+	struct File
+	{
+		ucell address; // Where the code of the file starts.
+		std::string name;
+	};
+
+	struct DebugInfo
+	{
+		std::vector<Function> functions; // Sorted by address.
+		std::vector<Line> lines;
+		std::vector<File> files;
+	};
+
+	/*
+		Returns false if the script's file isn't found or has no debug info.
+		Reads files from disk, so it's not meant for every call.
+	*/
+	bool Load(AMX *amx, DebugInfo &info);
+
+	/*
+		NULL if the address isn't in any function (or line, or file).
+	*/
+	const Function *FindFunction(const DebugInfo &info, cell address);
+	const Line *FindLine(const DebugInfo &info, cell address);
+	const File *FindFile(const DebugInfo &info, cell address);
+
+}
+
+
+#endif // _AMXDEBUG_H
@@ -0,0 +1,246 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _AMXOPCODES_H
+#define _AMXOPCODES_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Opcodes of the AMX instruction set the plugin is built for (CUR_FILE_VERSION).
+
+	The whole instruction set is only listed for file versions 6 to 8 (Pawn 3.x,
+	the version used by the server), so the code can be decoded: see
+	AMXOPCODES_HAVE_OPERANDS and GetNumOperands. For the later versions only
+	the native call instructions are known.
+
+	After amx_Init the interpreter may have replaced the opcodes in the code
+	with the addresses of its instruction handlers ("threaded" code), see
+	pluginutils::GetOpcodeJumpTable.
+*/
+namespace amxopcodes
+{
+
+#if (6 <= CUR_FILE_VERSION) && (CUR_FILE_VERSION <= 8)
+
+	#define AMXOPCODES_HAVE_OPERANDS
+
+	enum Opcode
+	{
+		OP_NONE,
+		OP_LOAD_PRI,
+		OP_LOAD_ALT,
+		OP_LOAD_S_PRI,
+		OP_LOAD_S_ALT,
+		OP_LREF_PRI,
+		OP_LREF_ALT,
+		OP_LREF_S_PRI,
+		OP_LREF_S_ALT,
+		OP_LOAD_I,
+		OP_LODB_I,
+		OP_CONST_PRI,
+		OP_CONST_ALT,
+		OP_ADDR_PRI,
+		OP_ADDR_ALT,
+		OP_STOR_PRI,
+		OP_STOR_ALT,
+		OP_STOR_S_PRI,
+		OP_STOR_S_ALT,
+		OP_SREF_PRI,
+		OP_SREF_ALT,
+		OP_SREF_S_PRI,
+		OP_SREF_S_ALT,
+		OP_STOR_I,
+		OP_STRB_I,
+		OP_LIDX,
+		OP_LIDX_B,
+		OP_IDXADDR,
+		OP_IDXADDR_B,
+		OP_ALIGN_PRI,
+		OP_ALIGN_ALT,
+		OP_LCTRL,
+		OP_SCTRL,
+		OP_MOVE_PRI,
+		OP_MOVE_ALT,
+		OP_XCHG,
+		OP_PUSH_PRI,
+		OP_PUSH_ALT,
+		OP_PUSH_R,
+		OP_PUSH_C,
+		OP_PUSH,
+		OP_PUSH_S,
+		OP_POP_PRI,
+		OP_POP_ALT,
+		OP_STACK,
+		OP_HEAP,
+		OP_PROC,
+		OP_RET,
+		OP_RETN,
+		OP_CALL,
+		OP_CALL_PRI,
+		OP_JUMP,
+		OP_JREL,
+		OP_JZER,
+		OP_JNZ,
+		OP_JEQ,
+		OP_JNEQ,
+		OP_JLESS,
+		OP_JLEQ,
+		OP_JGRTR,
+		OP_JGEQ,
+		OP_JSLESS,
+		OP_JSLEQ,
+		OP_JSGRTR,
+		OP_JSGEQ,
+		OP_SHL,
+		OP_SHR,
+		OP_SSHR,
+		OP_SHL_C_PRI,
+		OP_SHL_C_ALT,
+		OP_SHR_C_PRI,
+		OP_SHR_C_ALT,
+		OP_SMUL,
+		OP_SDIV,
+		OP_SDIV_ALT,
+		OP_UMUL,
+		OP_UDIV,
+		OP_UDIV_ALT,
+		OP_ADD,
+		OP_SUB,
+		OP_SUB_ALT,
+		OP_AND,
+		OP_OR,
+		OP_XOR,
+		OP_NOT,
+		OP_NEG,
+		OP_INVERT,
+		OP_ADD_C,
+		OP_SMUL_C,
+		OP_ZERO_PRI,
+		OP_ZERO_ALT,
+		OP_ZERO,
+		OP_ZERO_S,
+		OP_SIGN_PRI,
+		OP_SIGN_ALT,
+		OP_EQ,
+		OP_NEQ,
+		OP_LESS,
+		OP_LEQ,
+		OP_GRTR,
+		OP_GEQ,
+		OP_SLESS,
+		OP_SLEQ,
+		OP_SGRTR,
+		OP_SGEQ,
+		OP_EQ_C_PRI,
+		OP_EQ_C_ALT,
+		OP_INC_PRI,
+		OP_INC_ALT,
+		OP_INC,
+		OP_INC_S,
+		OP_INC_I,
+		OP_DEC_PRI,
+		OP_DEC_ALT,
+		OP_DEC,
+		OP_DEC_S,
+		OP_DEC_I,
+		OP_MOVS,
+		OP_CMPS,
+		OP_FILL,
+		OP_HALT,
+		OP_BOUNDS,
+		OP_SYSREQ_PRI,
+		OP_SYSREQ_C,
+		OP_FILE,
+		OP_LINE,
+		OP_SYMBOL,
+		OP_SRANGE,
+		OP_JUMP_PRI,
+		OP_SWITCH,
+		OP_CASETBL,
+		OP_SWAP_PRI,
+		OP_SWAP_ALT,
+		OP_PUSH_ADR,
+		OP_NOP,
+		OP_SYSREQ_D,
+		OP_SYMTAG,
+		OP_BREAK,
+		NUM_OPCODES
+	};
+
+	/*
+		Returns the number of operands (cells) that follow the opcode at 'cip',
+		or -1 if the opcode is invalid or its operands don't fit in 'code_size'.
+		'opcode' is the opcode at 'cip' after translating it from threaded code.
+	*/
+	inline cell GetNumOperands(cell opcode, const unsigned char *code, cell code_size, cell cip)
+	{
+		// -1: depends on the first operand.
+		static const signed char num_operands[NUM_OPCODES] =
+		{
+			0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1, 1, 1, 1,     // OP_NONE - OP_STOR_PRI
+			1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0, 1, 1, 1, 1,     // OP_STOR_ALT - OP_LCTRL
+			1, 0, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 1, 1, 0, 0,     // OP_SCTRL - OP_RET
+			0, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,     // OP_RETN - OP_JSGRTR
+			1, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,     // OP_JSGEQ - OP_SUB
+			0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 0,     // OP_SUB_ALT - OP_EQ
+			0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 1, 0,     // OP_NEQ - OP_INC_I
+			0, 0, 1, 1, 0, 1, 1, 1, 1, 1, 0, 1, -1, 2, -1, 2,   // OP_DEC_PRI - OP_SRANGE
+			0, 1, -1, 0, 0, 1, 0, 1, 1, 0                       // OP_JUMP_PRI - OP_BREAK
+		};
+
+		if ((ucell)opcode >= (ucell)NUM_OPCODES)
+			return -1;
+		cell count = num_operands[opcode];
+		if (count < 0)
+		{
+			if (cip + 2 * (cell)sizeof(cell) > code_size)
+				return -1;
+			const cell first = *(const cell *)(const void *)(code + (size_t)cip + sizeof(cell));
+			if (opcode == OP_CASETBL)
+			{
+				// casetbl <number of cases> <default address> followed by the
+				// value and address of each case.
+				if ((ucell)first > (ucell)(code_size / (cell)sizeof(cell)))
+					return -1;
+				count = 2 * first + 2;
+			}
+			else
+			{
+				// The obsolete debug instructions: the size of the data (in bytes)
+				// followed by the data.
+				if ((ucell)first > (ucell)code_size)
+					return -1;
+				count = 1 + (first + (cell)sizeof(cell) - 1) / (cell)sizeof(cell);
+			}
+		}
+		if ((ucell)(cip + (1 + count) * (cell)sizeof(cell)) > (ucell)code_size)
+			return -1;
+		return count;
+	}
+
+#elif CUR_FILE_VERSION == 9
+
+	const cell OP_SYSREQ_C = 123, OP_SYSREQ_D = 158, OP_SYSREQ_ND = 159;
+	const cell OP_SYSREQ_N = 135;
+
+#elif CUR_FILE_VERSION == 10
+
+	const cell OP_SYSREQ_C = 123, OP_SYSREQ_D = 213, OP_SYSREQ_ND = 214;
+	const cell OP_SYSREQ_N = 135;
+
+#elif CUR_FILE_VERSION == 11
+
+	const cell OP_SYSREQ_C = 69, OP_SYSREQ_D = 75, OP_SYSREQ_ND = 76;
+	const cell OP_SYSREQ_N = 112;
+
+#else
+	#error Unsupported version of AMX instruction set.
+#endif
+
+}
+
+
+#endif // _AMXOPCODES_H
@@ -0,0 +1,139 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <unordered_map>
+#include "batch.h"
+#include "pluginutils.h"
+
+
+namespace batch
+{
+
+	namespace
+	{
+
+		// Natives don't take more than a few dozen arguments,
+		// so the argument list is built on the stack.
+		const cell MAX_BATCH_ARGS = 64;
+
+		struct NativeTable
+		{
+			unsigned char *first;
+			size_t defsize;
+			cell num_natives;
+		};
+
+		std::unordered_map<AMX *, NativeTable> tables;
+
+		/*
+			Returns the native at the given index. The address is read from the
+			table on every call, as natives of plugins loaded after this one are
+			registered (and some natives are hooked) after our AmxLoad.
+		*/
+		FORCE_INLINE AMX_NATIVE GetNative(const NativeTable &table, cell index)
+		{
+			const AMX_FUNCSTUB *func =
+				(const AMX_FUNCSTUB *)(table.first + (size_t)index * table.defsize);
+			return (AMX_NATIVE)(size_t)func->address;
+		}
+
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		AMX_HEADER *hdr = (AMX_HEADER *)amx->base;
+		NativeTable &table = tables[amx];
+		table.first = (unsigned char *)hdr + (size_t)hdr->natives;
+		table.defsize = (size_t)hdr->defsize;
+		table.num_natives = (cell)(hdr->libraries - hdr->natives) / (cell)hdr->defsize;
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		tables.erase(amx);
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_GetNativeIndex(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_name,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	int error;
+	const std::string name = pluginutils::GetCXXString(amx, params[arg_name], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), -1;
+	int index;
+	if (amx_FindNative(amx, name.c_str(), &index) != AMX_ERR_NONE)
+		return -1;
+	return (cell)index;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_BatchCall(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_calls,
+		arg_size,
+		arg_results,
+		arg_results_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell size = params[arg_size];
+	if (size <= 0)
+		return 0;
+	std::unordered_map<AMX *, batch::NativeTable>::const_iterator it = batch::tables.find(amx);
+	if (it == batch::tables.end())
+		return 0;
+	const batch::NativeTable &table = it->second;
+	int error;
+	const pluginutils::ArrayView<const cell> calls(amx, params[arg_calls], (size_t)size);
+	if (!calls.IsValid())
+		return amx_RaiseError(amx, calls.GetError()), 0;
+	const cell results_size = params[arg_results_size];
+	cell *results = NULL;
+	if (results_size > 0 &&
+		(results = pluginutils::GetArrayAddr(amx, params[arg_results], (size_t)results_size, error)) == NULL)
+		return amx_RaiseError(amx, error), 0;
+
+	cell args[1 + batch::MAX_BATCH_ARGS];
+	cell num_calls = 0;
+	for (cell pos = 0; pos < size; ++num_calls)
+	{
+		// Each record is (native index, number of arguments, arguments...).
+		if (size - pos < 2)
+			return amx_RaiseError(amx, AMX_ERR_BOUNDS), num_calls;
+		const cell index = calls[pos], argc = calls[pos + 1];
+		if (argc < 0 || argc > batch::MAX_BATCH_ARGS || argc > size - pos - 2)
+			return amx_RaiseError(amx, AMX_ERR_BOUNDS), num_calls;
+		if (index < 0 || index >= table.num_natives)
+			return amx_RaiseError(amx, AMX_ERR_INDEX), num_calls;
+		const AMX_NATIVE native = batch::GetNative(table, index);
+		if (native == NULL)
+			return amx_RaiseError(amx, AMX_ERR_NOTFOUND), num_calls;
+		args[0] = argc * (cell)sizeof(cell);
+		for (cell i = 0; i < argc; ++i)
+			args[1 + i] = calls[pos + 2 + i];
+		pos += 2 + argc;
+
+		const cell result = native(amx, args);
+		if (num_calls < results_size)
+			results[num_calls] = result;
+		// Stop at the first native that raised an error, it will be reported
+		// when we return to the script.
+		if (amx->error != AMX_ERR_NONE)
+			return num_calls + 1;
+	}
+	return num_calls;
+}
@@ -0,0 +1,32 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Runs a list of native calls stored in an array, so that a script setting
+	up lots of objects or textdraws enters the plugin once instead of once
+	per call. See HelloWorld_BatchCall in the include for the array layout.
+*/
+namespace batch
+{
+
+	/*
+		Locates the native table of the script.
+	*/
+	void AmxLoad(AMX *amx);
+	void AmxUnload(AMX *amx);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_GetNativeIndex(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_BatchCall(AMX *amx, cell *params);
+
+
+#endif // _BATCH_H
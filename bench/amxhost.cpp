@@ -0,0 +1,688 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include "amxhost.h"
+
+
+namespace amxhost
+{
+
+	namespace
+	{
+
+#if (6 <= CUR_FILE_VERSION) && (CUR_FILE_VERSION <= 8)
+		const cell OP_SYSREQ_C = 123, OP_SYSREQ_D = 135;
+#else
+		#error Unsupported version of AMX instruction set.
+#endif
+
+		const size_t NUM_EXPORTS = PLUGIN_AMX_EXPORT_UTF8Put + 1;
+
+		// Room for the public variables at the start of the data section.
+		const size_t MAX_PUBVARS = 64;
+
+		bool log_muted = false;
+		size_t log_count = 0;
+		std::vector<AMX_NATIVE_INFO> registered_natives;
+
+		size_t AlignSize(size_t size)
+		{
+			return (size + sizeof(cell) - 1) & ~(sizeof(cell) - 1);
+		}
+
+		AMX_HEADER *GetHeader(AMX *amx)
+		{
+			return (AMX_HEADER *)amx->base;
+		}
+
+		unsigned char *GetData(AMX *amx)
+		{
+			return (amx->data != NULL) ? amx->data : amx->base + (size_t)GetHeader(amx)->dat;
+		}
+
+		/*
+			Stub tables (publics, natives, public variables) all have the same layout.
+		*/
+		AMX_FUNCSTUB *GetStub(AMX *amx, int32_t table_offset, int index)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			return (AMX_FUNCSTUB *)(amx->base + (size_t)table_offset + (size_t)index * (size_t)hdr->defsize);
+		}
+
+		int GetNumStubs(AMX *amx, int32_t table_offset, int32_t next_table_offset)
+		{
+			return (int)((next_table_offset - table_offset) / GetHeader(amx)->defsize);
+		}
+
+		const char *GetStubName(AMX *amx, const AMX_FUNCSTUB *stub)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			if (hdr->defsize == (int16_t)sizeof(AMX_FUNCSTUB))
+				return stub->name;
+			return (const char *)(amx->base + (size_t)((const AMX_FUNCSTUBNT *)stub)->nameofs);
+		}
+
+		int FindStub(AMX *amx, int32_t table_offset, int32_t next_table_offset, const char *name)
+		{
+			const int count = GetNumStubs(amx, table_offset, next_table_offset);
+			for (int i = 0; i < count; ++i)
+				if (strcmp(GetStubName(amx, GetStub(amx, table_offset, i)), name) == 0)
+					return i;
+			return -1;
+		}
+
+		unsigned char GetPackedChar(const cell *str, size_t index)
+		{
+			const ucell c = (ucell)str[index / sizeof(cell)];
+			return (unsigned char)(c >> ((sizeof(cell) - 1 - index % sizeof(cell)) * 8));
+		}
+
+		uint16_t *AMXAPI Align16(uint16_t *v) { return v; }
+		uint32_t *AMXAPI Align32(uint32_t *v) { return v; }
+		uint64_t *AMXAPI Align64(uint64_t *v) { return v; }
+
+		int AMXAPI Allot(AMX *amx, int cells, cell *amx_addr, cell **phys_addr)
+		{
+			const cell size = (cell)cells * (cell)sizeof(cell);
+			if (cells < 0 || amx->stk - amx->hea - size < (cell)(16 * sizeof(cell)))
+				return AMX_ERR_MEMORY;
+			if (amx_addr != NULL)
+				*amx_addr = amx->hea;
+			if (phys_addr != NULL)
+				*phys_addr = (cell *)(void *)(GetData(amx) + (size_t)amx->hea);
+			amx->hea += size;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI Exec(AMX *amx, cell *retval, int index)
+		{
+			// There's no jump table to find when browsing (like the ANSI C core).
+			if ((amx->flags & AMX_FLAG_BROWSE) != 0)
+				return AMX_ERR_NONE;
+			amx->stk += (cell)amx->paramcount * (cell)sizeof(cell);
+			amx->paramcount = 0;
+			if (retval != NULL)
+				*retval = 0;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI FindNative(AMX *amx, const char *name, int *index)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			*index = FindStub(amx, hdr->natives, hdr->libraries, name);
+			return (*index < 0) ? AMX_ERR_NOTFOUND : AMX_ERR_NONE;
+		}
+
+		int AMXAPI FindPublic(AMX *amx, const char *name, int *index)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			*index = FindStub(amx, hdr->publics, hdr->natives, name);
+			return (*index < 0) ? AMX_ERR_NOTFOUND : AMX_ERR_NONE;
+		}
+
+		int AMXAPI FindPubVar(AMX *amx, const char *name, cell *amx_addr)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			const int index = FindStub(amx, hdr->pubvars, hdr->tags, name);
+			if (index < 0)
+				return AMX_ERR_NOTFOUND;
+			*amx_addr = (cell)GetStub(amx, hdr->pubvars, index)->address;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI Flags(AMX *amx, uint16_t *flags)
+		{
+			*flags = (uint16_t)GetHeader(amx)->flags;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI GetAddr(AMX *amx, cell amx_addr, cell **phys_addr)
+		{
+			if ((amx_addr >= amx->hea && amx_addr < amx->stk) || amx_addr < 0 || amx_addr >= amx->stp)
+			{
+				*phys_addr = NULL;
+				return AMX_ERR_MEMACCESS;
+			}
+			*phys_addr = (cell *)(void *)(GetData(amx) + (size_t)amx_addr);
+			return AMX_ERR_NONE;
+		}
+
+		int GetStubNameAt(AMX *amx, int32_t table_offset, int32_t next_table_offset, int index, char *name)
+		{
+			if (index < 0 || index >= GetNumStubs(amx, table_offset, next_table_offset))
+				return AMX_ERR_INDEX;
+			strcpy(name, GetStubName(amx, GetStub(amx, table_offset, index)));
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI GetNative(AMX *amx, int index, char *name)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			return GetStubNameAt(amx, hdr->natives, hdr->libraries, index, name);
+		}
+
+		int AMXAPI GetPublic(AMX *amx, int index, char *name)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			return GetStubNameAt(amx, hdr->publics, hdr->natives, index, name);
+		}
+
+		int AMXAPI GetPubVar(AMX *amx, int index, char *name, cell *amx_addr)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			const int error = GetStubNameAt(amx, hdr->pubvars, hdr->tags, index, name);
+			if (error == AMX_ERR_NONE)
+				*amx_addr = (cell)GetStub(amx, hdr->pubvars, index)->address;
+			return error;
+		}
+
+		int AMXAPI GetString(char *dest, const cell *source, int use_wchar, size_t size)
+		{
+			if (size == 0)
+				return AMX_ERR_NONE;
+			size_t i = 0;
+			if ((ucell)source[0] > UNPACKEDMAX)
+			{
+				for (unsigned char c; i + 1 < size && (c = GetPackedChar(source, i)) != 0; ++i)
+					dest[i] = (char)c;
+			}
+			else
+			{
+				for (; i + 1 < size && source[i] != 0; ++i)
+					dest[i] = (char)source[i];
+			}
+			dest[i] = '\0';
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI MemInfo(AMX *amx, long *codesize, long *datasize, long *stackheap)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			if (codesize != NULL)
+				*codesize = (long)(hdr->dat - hdr->cod);
+			if (datasize != NULL)
+				*datasize = (long)(hdr->hea - hdr->dat);
+			if (stackheap != NULL)
+				*stackheap = (long)(hdr->stp - hdr->hea);
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI NameLength(AMX *amx, int *length)
+		{
+			*length = sNAMEMAX;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI NumNatives(AMX *amx, int *number)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			*number = GetNumStubs(amx, hdr->natives, hdr->libraries);
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI NumPublics(AMX *amx, int *number)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			*number = GetNumStubs(amx, hdr->publics, hdr->natives);
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI NumPubVars(AMX *amx, int *number)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			*number = GetNumStubs(amx, hdr->pubvars, hdr->tags);
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI Push(AMX *amx, cell value)
+		{
+			if (amx->stk - amx->hea < (cell)(16 * sizeof(cell)))
+				return AMX_ERR_STACKERR;
+			amx->stk -= (cell)sizeof(cell);
+			*(cell *)(void *)(GetData(amx) + (size_t)amx->stk) = value;
+			++amx->paramcount;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI PushArray(AMX *amx, cell *amx_addr, cell **phys_addr, const cell array[], int numcells)
+		{
+			cell address, *ptr;
+			int error = Allot(amx, numcells, &address, &ptr);
+			if (error != AMX_ERR_NONE)
+				return error;
+			if (array != NULL)
+				memcpy(ptr, array, (size_t)numcells * sizeof(cell));
+			if (amx_addr != NULL)
+				*amx_addr = address;
+			if (phys_addr != NULL)
+				*phys_addr = ptr;
+			return Push(amx, address);
+		}
+
+		int AMXAPI SetString(cell *dest, const char *source, int pack, int use_wchar, size_t size)
+		{
+			size_t len = strlen(source);
+			if (pack)
+			{
+				if (len >= size * sizeof(cell))
+					len = size * sizeof(cell) - 1;
+				memset(dest, 0, (len / sizeof(cell) + 1) * sizeof(cell));
+				for (size_t i = 0; i < len; ++i)
+					dest[i / sizeof(cell)] |=
+						(cell)((ucell)(unsigned char)source[i] << ((sizeof(cell) - 1 - i % sizeof(cell)) * 8));
+				return AMX_ERR_NONE;
+			}
+			if (len >= size)
+				len = size - 1;
+			for (size_t i = 0; i < len; ++i)
+				dest[i] = (cell)(unsigned char)source[i];
+			dest[len] = 0;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI PushString(AMX *amx, cell *amx_addr, cell **phys_addr, const char *string, int pack, int use_wchar)
+		{
+			const size_t len = strlen(string);
+			const size_t num_cells = pack ? len / sizeof(cell) + 1 : len + 1;
+			cell address, *ptr;
+			int error = Allot(amx, (int)num_cells, &address, &ptr);
+			if (error != AMX_ERR_NONE)
+				return error;
+			SetString(ptr, string, pack, use_wchar, num_cells);
+			if (amx_addr != NULL)
+				*amx_addr = address;
+			if (phys_addr != NULL)
+				*phys_addr = ptr;
+			return Push(amx, address);
+		}
+
+		int AMXAPI RaiseError(AMX *amx, int error)
+		{
+			if (error != AMX_ERR_NONE)
+				amx->error = error;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI Register(AMX *amx, const AMX_NATIVE_INFO *list, int number)
+		{
+			AMX_HEADER *hdr = GetHeader(amx);
+			const int num_natives = GetNumStubs(amx, hdr->natives, hdr->libraries);
+			for (int i = 0; (number < 0) ? (list[i].name != NULL) : (i < number); ++i)
+			{
+				bool known = false;
+				for (size_t j = 0; j < registered_natives.size() && !known; ++j)
+					known = (strcmp(registered_natives[j].name, list[i].name) == 0);
+				if (!known)
+					registered_natives.push_back(list[i]);
+				const int index = FindStub(amx, hdr->natives, hdr->libraries, list[i].name);
+				if (index >= 0 && GetStub(amx, hdr->natives, index)->address == 0)
+					GetStub(amx, hdr->natives, index)->address = (ucell)(size_t)list[i].func;
+			}
+			for (int i = 0; i < num_natives; ++i)
+				if (GetStub(amx, hdr->natives, i)->address == 0)
+					return AMX_ERR_NOTFOUND;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI Release(AMX *amx, cell amx_addr)
+		{
+			if (amx->hlw < amx_addr && amx_addr < amx->hea)
+				amx->hea = amx_addr;
+			return AMX_ERR_NONE;
+		}
+
+		int AMXAPI StrLen(const cell *cstring, int *length)
+		{
+			size_t len = 0;
+			if ((ucell)cstring[0] > UNPACKEDMAX)
+			{
+				while (GetPackedChar(cstring, len) != 0)
+					++len;
+			}
+			else
+			{
+				while (cstring[len] != 0)
+					++len;
+			}
+			*length = (int)len;
+			return AMX_ERR_NONE;
+		}
+
+		/*
+			Called through all the other slots of the export table.
+		*/
+		int AMXAPI Unsupported()
+		{
+			fprintf(stderr, "amxhost: the plugin called an AMX function that isn't emulated\n");
+			abort();
+		}
+
+		cell AMX_NATIVE_CALL fake_IsPlayerConnected(AMX *amx, cell *params)
+		{
+			return (params[1] >= 0 && params[1] < 100) ? 1 : 0;
+		}
+
+		cell AMX_NATIVE_CALL fake_GetPlayerName(AMX *amx, cell *params)
+		{
+			cell *dest;
+			if (GetAddr(amx, params[2], &dest) != AMX_ERR_NONE || params[3] <= 0)
+				return 0;
+			if (!fake_IsPlayerConnected(amx, params))
+				return dest[0] = 0, 0;
+			char name[32];
+			snprintf(name, sizeof(name), "Player_%d", (int)params[1]);
+			SetString(dest, name, 0, 0, (size_t)params[3]);
+			int len;
+			StrLen(dest, &len);
+			return (cell)len;
+		}
+
+		cell AMX_NATIVE_CALL fake_SetPlayerName(AMX *amx, cell *params)
+		{
+			return fake_IsPlayerConnected(amx, params);
+		}
+
+	}
+
+	void **GetExports()
+	{
+		static void *exports[NUM_EXPORTS];
+		if (exports[0] == NULL)
+		{
+			for (size_t i = 0; i < NUM_EXPORTS; ++i)
+				exports[i] = (void *)Unsupported;
+			exports[PLUGIN_AMX_EXPORT_Align16] = (void *)Align16;
+			exports[PLUGIN_AMX_EXPORT_Align32] = (void *)Align32;
+			exports[PLUGIN_AMX_EXPORT_Align64] = (void *)Align64;
+			exports[PLUGIN_AMX_EXPORT_Allot] = (void *)Allot;
+			exports[PLUGIN_AMX_EXPORT_Exec] = (void *)Exec;
+			exports[PLUGIN_AMX_EXPORT_FindNative] = (void *)FindNative;
+			exports[PLUGIN_AMX_EXPORT_FindPublic] = (void *)FindPublic;
+			exports[PLUGIN_AMX_EXPORT_FindPubVar] = (void *)FindPubVar;
+			exports[PLUGIN_AMX_EXPORT_Flags] = (void *)Flags;
+			exports[PLUGIN_AMX_EXPORT_GetAddr] = (void *)GetAddr;
+			exports[PLUGIN_AMX_EXPORT_GetNative] = (void *)GetNative;
+			exports[PLUGIN_AMX_EXPORT_GetPublic] = (void *)GetPublic;
+			exports[PLUGIN_AMX_EXPORT_GetPubVar] = (void *)GetPubVar;
+			exports[PLUGIN_AMX_EXPORT_GetString] = (void *)GetString;
+			exports[PLUGIN_AMX_EXPORT_MemInfo] = (void *)MemInfo;
+			exports[PLUGIN_AMX_EXPORT_NameLength] = (void *)NameLength;
+			exports[PLUGIN_AMX_EXPORT_NumNatives] = (void *)NumNatives;
+			exports[PLUGIN_AMX_EXPORT_NumPublics] = (void *)NumPublics;
+			exports[PLUGIN_AMX_EXPORT_NumPubVars] = (void *)NumPubVars;
+			exports[PLUGIN_AMX_EXPORT_Push] = (void *)Push;
+			exports[PLUGIN_AMX_EXPORT_PushArray] = (void *)PushArray;
+			exports[PLUGIN_AMX_EXPORT_PushString] = (void *)PushString;
+			exports[PLUGIN_AMX_EXPORT_RaiseError] = (void *)RaiseError;
+			exports[PLUGIN_AMX_EXPORT_Register] = (void *)Register;
+			exports[PLUGIN_AMX_EXPORT_Release] = (void *)Release;
+			exports[PLUGIN_AMX_EXPORT_SetString] = (void *)SetString;
+			exports[PLUGIN_AMX_EXPORT_StrLen] = (void *)StrLen;
+		}
+		return exports;
+	}
+
+	void *Logprintf(const char *format, ...)
+	{
+		++log_count;
+		if (log_muted)
+			return NULL;
+		va_list args;
+		va_start(args, format);
+		vfprintf(stderr, format, args);
+		va_end(args);
+		fputc('\n', stderr);
+		return NULL;
+	}
+
+	void SetLogMuted(bool muted)
+	{
+		log_muted = muted;
+	}
+
+	size_t GetLogCount()
+	{
+		return log_count;
+	}
+
+	const std::vector<AMX_NATIVE_INFO> &GetRegisteredNatives()
+	{
+		return registered_natives;
+	}
+
+	Script::Script(const ScriptDesc &desc)
+		: num_natives((int)desc.natives.size())
+	{
+		const size_t defsize = desc.name_table ? sizeof(AMX_FUNCSTUBNT) : sizeof(AMX_FUNCSTUB);
+		const size_t num_stubs = desc.publics.size() + desc.natives.size() + desc.pubvars.size();
+		std::vector<const std::string *> names;
+		for (size_t i = 0; i < desc.publics.size(); ++i)
+			names.push_back(&desc.publics[i]);
+		for (size_t i = 0; i < desc.natives.size(); ++i)
+			names.push_back(&desc.natives[i]);
+		for (size_t i = 0; i < desc.pubvars.size(); ++i)
+			names.push_back(&desc.pubvars[i].first);
+
+		// Header, stub tables, name table, code (a SYSREQ.C and a SYSREQ.D per native), data.
+		const size_t publics = sizeof(AMX_HEADER);
+		const size_t natives = publics + desc.publics.size() * defsize;
+		const size_t libraries = natives + desc.natives.size() * defsize;
+		const size_t pubvars = libraries;
+		const size_t tags = pubvars + desc.pubvars.size() * defsize;
+		const size_t nametable = tags;
+		size_t names_size = sizeof(uint16_t);
+		if (desc.name_table)
+			for (size_t i = 0; i < names.size(); ++i)
+				names_size += names[i]->size() + 1;
+		const size_t cod = AlignSize(nametable + names_size);
+		const size_t code_size = 4 * desc.natives.size() * sizeof(cell);
+		const size_t dat = cod + code_size;
+		const size_t data_size = AlignSize(desc.data_size);
+		image.assign((dat + data_size) / sizeof(cell), 0);
+
+		unsigned char *base = (unsigned char *)&image[0];
+		AMX_HEADER *hdr = (AMX_HEADER *)base;
+		hdr->size = (int32_t)(dat + data_size);
+		hdr->magic = AMX_MAGIC;
+		hdr->file_version = CUR_FILE_VERSION;
+		hdr->amx_version = CUR_FILE_VERSION;
+		hdr->defsize = (int16_t)defsize;
+		hdr->cod = (int32_t)cod;
+		hdr->dat = (int32_t)dat;
+		// Like in an .amx file, hea and stp are offsets from the start of the image.
+		hdr->hea = (int32_t)(dat + MAX_PUBVARS * sizeof(cell));
+		hdr->stp = (int32_t)(dat + data_size);
+		hdr->cip = -1;
+		hdr->publics = (int32_t)publics;
+		hdr->natives = (int32_t)natives;
+		hdr->libraries = (int32_t)libraries;
+		hdr->pubvars = (int32_t)pubvars;
+		hdr->tags = (int32_t)tags;
+		hdr->nametable = (int32_t)nametable;
+
+		unsigned char *name_ptr = base + nametable;
+		*(uint16_t *)(void *)name_ptr = (uint16_t)sNAMEMAX;
+		name_ptr += sizeof(uint16_t);
+		for (size_t i = 0; i < num_stubs; ++i)
+		{
+			AMX_FUNCSTUB *stub = (AMX_FUNCSTUB *)(base + publics + i * defsize);
+			if (desc.name_table)
+			{
+				((AMX_FUNCSTUBNT *)stub)->nameofs = (uint32_t)(name_ptr - base);
+				memcpy(name_ptr, names[i]->c_str(), names[i]->size() + 1);
+				name_ptr += names[i]->size() + 1;
+			}
+			else
+			{
+				strncpy(stub->name, names[i]->c_str(), sEXPMAX);
+			}
+		}
+
+		cell *code = (cell *)(void *)(base + cod);
+		for (int i = 0; i < num_natives; ++i)
+		{
+			code[2 * i] = OP_SYSREQ_C;
+			code[2 * i + 1] = (cell)i;
+			code[2 * (num_natives + i)] = OP_SYSREQ_D;
+		}
+
+		cell *data = (cell *)(void *)(base + dat);
+		for (size_t i = 0; i < desc.pubvars.size() && i < MAX_PUBVARS; ++i)
+		{
+			data[i] = desc.pubvars[i].second;
+			((AMX_FUNCSTUB *)(base + pubvars + i * defsize))->address = (ucell)(i * sizeof(cell));
+		}
+
+		memset(&amx, 0, sizeof(amx));
+		amx.base = base;
+		amx.data = NULL;
+		amx.cip = hdr->cip;
+		amx.hlw = amx.hea = hdr->hea - hdr->dat;
+		amx.stp = amx.stk = amx.frm = hdr->stp - hdr->dat;
+		amx.flags = AMX_FLAG_NTVREG | AMX_FLAG_RELOC;
+		heap_start = amx.hea;
+	}
+
+	void Script::RegisterServerNatives()
+	{
+		static const AMX_NATIVE_INFO server_natives[] =
+		{
+			{ "IsPlayerConnected", fake_IsPlayerConnected },
+			{ "GetPlayerName", fake_GetPlayerName },
+			{ "SetPlayerName", fake_SetPlayerName }
+		};
+		AMX_HEADER *hdr = GetHeader(&amx);
+		for (size_t i = 0; i < sizeof(server_natives) / sizeof(server_natives[0]); ++i)
+		{
+			const int index = FindStub(&amx, hdr->natives, hdr->libraries, server_natives[i].name);
+			if (index >= 0)
+				GetStub(&amx, hdr->natives, index)->address = (ucell)(size_t)server_natives[i].func;
+		}
+	}
+
+	cell Script::Alloc(size_t num_cells)
+	{
+		cell address;
+		if (Allot(&amx, (int)num_cells, &address, NULL) != AMX_ERR_NONE)
+		{
+			fprintf(stderr, "amxhost: out of heap space\n");
+			abort();
+		}
+		memset(GetPhysAddr(address), 0, num_cells * sizeof(cell));
+		return address;
+	}
+
+	cell Script::AllocArray(const cell *values, size_t num_cells)
+	{
+		const cell address = Alloc(num_cells);
+		memcpy(GetPhysAddr(address), values, num_cells * sizeof(cell));
+		return address;
+	}
+
+	cell Script::AllocString(const char *str, bool packed)
+	{
+		const size_t len = strlen(str);
+		const size_t num_cells = packed ? len / sizeof(cell) + 1 : len + 1;
+		const cell address = Alloc(num_cells);
+		SetString(GetPhysAddr(address), str, packed ? 1 : 0, 0, num_cells);
+		return address;
+	}
+
+	void Script::ResetHeap()
+	{
+		amx.hea = heap_start;
+	}
+
+	cell *Script::GetPhysAddr(cell address)
+	{
+		return (cell *)(void *)(GetData(&amx) + (size_t)address);
+	}
+
+	void Script::SetCurrentNative(int index, bool sysreq_d)
+	{
+		AMX_HEADER *hdr = GetHeader(&amx);
+		cell *code = (cell *)(void *)(amx.base + (size_t)hdr->cod);
+		int op_index = 2 * index;
+		if (sysreq_d)
+		{
+			op_index = 2 * (num_natives + index);
+			code[op_index + 1] = (cell)GetStub(&amx, hdr->natives, index)->address;
+		}
+		amx.cip = (cell)((op_index + 2) * sizeof(cell));
+	}
+
+	AMX_NATIVE Script::GetNative(int index)
+	{
+		return (AMX_NATIVE)(size_t)GetStub(&amx, GetHeader(&amx)->natives, index)->address;
+	}
+
+	Plugin::Plugin()
+		: handle(NULL), loaded(false), unload(NULL), amx_load(NULL), amx_unload(NULL), process_tick(NULL)
+	{
+	}
+
+	Plugin::~Plugin()
+	{
+		if (loaded)
+			unload();
+		if (handle != NULL)
+			dlclose(handle);
+	}
+
+	bool Plugin::Load(const char *path)
+	{
+		handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+		if (handle == NULL)
+		{
+			fprintf(stderr, "Can't load %s: %s\n", path, dlerror());
+			return false;
+		}
+		Supports_t supports = (Supports_t)dlsym(handle, "Supports");
+		Load_t load = (Load_t)dlsym(handle, "Load");
+		unload = (Unload_t)dlsym(handle, "Unload");
+		amx_load = (AmxLoad_t)dlsym(handle, "AmxLoad");
+		amx_unload = (AmxUnload_t)dlsym(handle, "AmxUnload");
+		process_tick = (ProcessTick_t)dlsym(handle, "ProcessTick");
+		if (supports == NULL || load == NULL || unload == NULL || amx_load == NULL || amx_unload == NULL)
+		{
+			fprintf(stderr, "%s is not a SA-MP plugin\n", path);
+			return false;
+		}
+
+		void *data[256] = { NULL };
+		data[PLUGIN_DATA_LOGPRINTF] = (void *)Logprintf;
+		data[PLUGIN_DATA_AMX_EXPORTS] = GetExports();
+		mkdir("scriptfiles", 0755);
+		if ((supports() & SUPPORTS_VERSION_MASK) > SUPPORTS_VERSION || !load(data))
+		{
+			fprintf(stderr, "The plugin failed to load\n");
+			return false;
+		}
+		loaded = true;
+		return true;
+	}
+
+	int Plugin::AmxLoad(AMX *amx)
+	{
+		return amx_load(amx);
+	}
+
+	int Plugin::AmxUnload(AMX *amx)
+	{
+		return amx_unload(amx);
+	}
+
+	void Plugin::ProcessTick()
+	{
+		if (process_tick != NULL)
+			process_tick();
+	}
+
+}
@@ -0,0 +1,160 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _AMXHOST_H
+#define _AMXHOST_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "SDK/amx/amx.h"
+#include "SDK/plugincommon.h"
+
+
+/*
+	A stand-in for the parts of the SA-MP server a plugin talks to, so that
+	plugins and pluginutils can be run (and timed) on a plain Linux box.
+
+	It provides an AMX export table and logprintf, and builds synthetic
+	scripts: an AMX image with the requested natives, publics and public
+	variables, and a code section that only holds a SYSREQ.C and a SYSREQ.D
+	instruction per native, so that a native can be made "current" for
+	functions like GetCurrentNativeFunctionName. Nothing is interpreted:
+	amx_Exec pops the arguments and returns 0.
+
+	Like the plugin itself, this must be built as 32-bit code: native
+	addresses are stored in the script's native table as cells.
+*/
+namespace amxhost
+{
+
+	/*
+		The export table to pass to the plugin in ppData[PLUGIN_DATA_AMX_EXPORTS].
+	*/
+	void **GetExports();
+
+	/*
+		Prints to stderr, unless muted (while benchmarks run).
+		Returns the number of lines printed or swallowed so far.
+	*/
+	void *Logprintf(const char *format, ...);
+	void SetLogMuted(bool muted);
+	size_t GetLogCount();
+
+	/*
+		All natives registered with amx_Register through the export table,
+		whether the script used them or not (i.e. the plugin's natives).
+	*/
+	const std::vector<AMX_NATIVE_INFO> &GetRegisteredNatives();
+
+	struct ScriptDesc
+	{
+		ScriptDesc() : name_table(true), data_size(1024 * 1024) {}
+
+		std::vector<std::string> natives;
+		std::vector<std::string> publics;
+		std::vector<std::pair<std::string, cell> > pubvars;
+
+		// Use AMX_FUNCSTUBNT records and a name table (as the SA-MP compiler does)
+		// instead of AMX_FUNCSTUB records with names of up to sEXPMAX characters.
+		bool name_table;
+
+		// Size of the data section, heap and stack together, in bytes.
+		size_t data_size;
+	};
+
+	class Script
+	{
+	public:
+		explicit Script(const ScriptDesc &desc);
+
+		AMX *GetAmx() { return &amx; }
+
+		/*
+			Resolves the script's server natives (IsPlayerConnected, GetPlayerName
+			and SetPlayerName) with simple fakes. Call it before the plugin's AmxLoad,
+			as the server registers its natives first.
+		*/
+		void RegisterServerNatives();
+
+		/*
+			Allocates memory on the heap and returns its address in the script.
+			ResetHeap frees everything allocated since the script was created.
+		*/
+		cell Alloc(size_t num_cells);
+		cell AllocArray(const cell *values, size_t num_cells);
+		cell AllocString(const char *str, bool packed = false);
+		void ResetHeap();
+
+		cell *GetPhysAddr(cell address);
+
+		/*
+			The function in the script's native table (0 if it's unresolved).
+		*/
+		AMX_NATIVE GetNative(int index);
+
+		/*
+			Points 'cip' past the SYSREQ.C (or SYSREQ.D) instruction calling the native.
+		*/
+		void SetCurrentNative(int index, bool sysreq_d = false);
+
+	private:
+		Script(const Script &);
+		Script &operator=(const Script &);
+
+		std::vector<cell> image;
+		AMX amx;
+		cell heap_start;
+		int num_natives;
+	};
+
+	/*
+		A plugin loaded the way the server loads it: dlopen, Supports and Load
+		with the export table and Logprintf above. Run it from a scratch
+		directory: like on a server, plugins read and write files under
+		scriptfiles/ (which Load creates).
+	*/
+	class Plugin
+	{
+	public:
+		Plugin();
+		~Plugin(); // Unloads the plugin if Load succeeded.
+
+		/*
+			Prints the reason to stderr on failure.
+		*/
+		bool Load(const char *path);
+
+		int AmxLoad(AMX *amx);
+		int AmxUnload(AMX *amx);
+
+		/*
+			Does nothing if the plugin doesn't export ProcessTick.
+		*/
+		void ProcessTick();
+
+	private:
+		Plugin(const Plugin &);
+		Plugin &operator=(const Plugin &);
+
+		typedef unsigned int (PLUGIN_CALL *Supports_t)();
+		typedef bool (PLUGIN_CALL *Load_t)(void **ppData);
+		typedef void (PLUGIN_CALL *Unload_t)();
+		typedef int (PLUGIN_CALL *AmxLoad_t)(AMX *amx);
+		typedef int (PLUGIN_CALL *AmxUnload_t)(AMX *amx);
+		typedef void (PLUGIN_CALL *ProcessTick_t)();
+
+		void *handle;
+		bool loaded;
+		Unload_t unload;
+		AmxLoad_t amx_load;
+		AmxUnload_t amx_unload;
+		ProcessTick_t process_tick;
+	};
+
+}
+
+
+#endif // _AMXHOST_H
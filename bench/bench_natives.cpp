@@ -0,0 +1,618 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+/*
+	Loads the plugin the way the server does (Supports, Load, AmxLoad) into
+	the amxhost stand-in and reports the time per call of every native it
+	registers and of a few pluginutils helpers.
+
+	Usage: bench_natives [path to the plugin] [name filter]
+
+	Run it from a scratch directory: like on a server, the plugin reads and
+	writes files under scriptfiles/.
+*/
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "amxhost.h"
+#include "benchutils.h"
+#include "pluginutils.h"
+
+
+extern void *pAMXFunctions;
+void *(*logprintf)(const char *fmt, ...);
+
+namespace
+{
+
+	struct Context
+	{
+		amxhost::Plugin *plugin;
+		amxhost::Script *script;
+		std::map<std::string, AMX_NATIVE> natives;
+
+		/*
+			Lets the plugin finish the work it defers to the next server tick.
+		*/
+		void Tick()
+		{
+			plugin->ProcessTick();
+		}
+
+		cell Str(const char *str, bool packed = false)
+		{
+			return script->AllocString(str, packed);
+		}
+
+		cell Ref(cell value)
+		{
+			return script->AllocArray(&value, 1);
+		}
+
+		cell Array(const std::vector<cell> &values)
+		{
+			return script->AllocArray(&values[0], values.size());
+		}
+
+		cell Call(const char *name, const std::vector<cell> &args)
+		{
+			std::vector<cell> params(1, (cell)(args.size() * sizeof(cell)));
+			params.insert(params.end(), args.begin(), args.end());
+			return natives[name](script->GetAmx(), &params[0]);
+		}
+	};
+
+	/*
+		Fills the arguments of a native. Returns false if the benchmark
+		can't be run (e.g. it needs a file that doesn't exist).
+	*/
+	typedef bool (*SetupFunc)(Context &ctx, std::vector<cell> &args);
+
+	/*
+		Called before each call, for natives that change their arguments.
+	*/
+	typedef void (*BeforeCallFunc)(cell *params, size_t iteration);
+
+	struct NativeCase
+	{
+		const char *native;
+		const char *description;
+		SetupFunc setup;
+		BeforeCallFunc before_call;
+	};
+
+	std::vector<cell> Sequence(size_t count, cell start, cell step)
+	{
+		std::vector<cell> values(count);
+		for (size_t i = 0; i < count; ++i)
+			values[i] = start + (cell)i * step;
+		return values;
+	}
+
+	std::vector<cell> FloatSequence(size_t count)
+	{
+		std::vector<cell> values(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const float f = (float)i * 0.5f;
+			memcpy(&values[i], &f, sizeof(f));
+		}
+		return values;
+	}
+
+	cell Float(float f)
+	{
+		cell c;
+		memcpy(&c, &f, sizeof(c));
+		return c;
+	}
+
+	// Alternates the sort order, so that every call has to reverse the array.
+	void FlipThirdArg(cell *params, size_t iteration)
+	{
+		params[3] = (cell)(iteration & 1);
+	}
+
+	cell *str_token_index;
+
+	void ResetTokenIndex(cell *params, size_t iteration)
+	{
+		*str_token_index = 0;
+	}
+
+	const NativeCase native_cases[] =
+	{
+		{ "HelloWorld", "logprintf (muted)",
+			[](Context &ctx, std::vector<cell> &args) { return true; }, NULL },
+		{ "HelloWorld_PrintNumber", "logprintf (muted)",
+			[](Context &ctx, std::vector<cell> &args) { args = { 42 }; return true; }, NULL },
+		{ "HelloWorld_PrintString", "logprintf (muted)",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("Hello, world!") }; return true; }, NULL },
+		{ "HelloWorld_CheckArgsTest", "argument count error",
+			[](Context &ctx, std::vector<cell> &args) { return true; }, NULL },
+		{ "HelloWorld_SortArray", "1000 cells, reversed",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Array(Sequence(1000, 0, 7)), 1000, 0 };
+				return true;
+			}, FlipThirdArg },
+		{ "HelloWorld_SortFloatArray", "1000 cells, reversed",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Array(FloatSequence(1000)), 1000, 0 };
+				return true;
+			}, FlipThirdArg },
+		{ "HelloWorld_SortArrayRows", "100 rows x 4 columns, reversed",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				// Two-dimensional arrays start with a vector of offsets to the rows.
+				const size_t num_rows = 100, row_size = 4;
+				std::vector<cell> array(num_rows + num_rows * row_size);
+				for (size_t i = 0; i < num_rows; ++i)
+				{
+					array[i] = (cell)((num_rows - i + i * row_size) * sizeof(cell));
+					for (size_t j = 0; j < row_size; ++j)
+						array[num_rows + i * row_size + j] = (cell)(i * 31 % 97 + j);
+				}
+				args = { ctx.Array(array), 1, 0, 0, (cell)num_rows, (cell)row_size };
+				return true;
+			}, FlipThirdArg },
+		{ "HelloWorld_BinarySearch", "1000 cells",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Array(Sequence(1000, 0, 3)), 2097, 1000 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_BinarySearchFloat", "1000 cells",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Array(FloatSequence(1000)), Float(349.5f), 1000 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_LinearSearch", "1000 cells, last one matches",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Array(Sequence(1000, 0, 1)), 999, 1000, 0 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_StrCompare", "64 characters, equal",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const std::string str(64, 'a');
+				args = { ctx.Str(str.c_str()), ctx.Str(str.c_str()), 0, (cell)0x7FFFFFFF };
+				return true;
+			}, NULL },
+		{ "HelloWorld_StrEqual", "64 characters, ignore case",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const std::string str(64, 'a'), upper(64, 'A');
+				args = { ctx.Str(str.c_str()), ctx.Str(upper.c_str()), 1 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_StrFind", "44 characters",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Str("The quick brown fox jumps over the lazy dog."), ctx.Str("lazy"), 0, 0 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_StrToken", "first token",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell index = ctx.Ref(0);
+				str_token_index = ctx.script->GetPhysAddr(index);
+				args = { ctx.Str("give 12 Some_Player"), index, ctx.script->Alloc(32), ' ', 32 };
+				return true;
+			}, ResetTokenIndex },
+		{ "HelloWorld_DispatchCommand", "\"/test 123\"",
+			[](Context &ctx, std::vector<cell> &args) { args = { 0, ctx.Str("/test 123") }; return true; }, NULL },
+		{ "HelloWorld_Intern", "existing string",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("bench_interned_string") }; return true; }, NULL },
+		{ "HelloWorld_InternFind", "existing string",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Str("bench_interned_string") };
+				ctx.Call("HelloWorld_Intern", args);
+				return true;
+			}, NULL },
+		{ "HelloWorld_InternGet", "21 characters",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell id = ctx.Call("HelloWorld_Intern", { ctx.Str("bench_interned_string") });
+				args = { id, ctx.script->Alloc(64), 64 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_InternLength", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Call("HelloWorld_Intern", { ctx.Str("bench_interned_string") }) };
+				return true;
+			}, NULL },
+		{ "HelloWorld_SegmentAttach", "existing segment",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("bench"), 1024, 0, 0 }; return true; }, NULL },
+		{ "HelloWorld_SegmentSize", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Call("HelloWorld_SegmentAttach", { ctx.Str("bench"), 1024, 0, 0 }) };
+				return true;
+			}, NULL },
+		{ "HelloWorld_SegmentVersion", "versioned segment",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Call("HelloWorld_SegmentAttach", { ctx.Str("bench_versioned"), 1024, 0, 1 }) };
+				return true;
+			}, NULL },
+		{ "HelloWorld_SegmentRead", "256 cells, versioned segment",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell segment = ctx.Call("HelloWorld_SegmentAttach", { ctx.Str("bench_versioned"), 1024, 0, 1 });
+				args = { segment, 0, ctx.script->Alloc(256), 256 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_SegmentWrite", "256 cells, versioned segment",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell segment = ctx.Call("HelloWorld_SegmentAttach", { ctx.Str("bench_versioned"), 1024, 0, 1 });
+				args = { segment, 0, ctx.Array(Sequence(256, 0, 1)), 256 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_SegmentGet", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Call("HelloWorld_SegmentAttach", { ctx.Str("bench"), 1024, 0, 0 }), 100 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_SegmentSet", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Call("HelloWorld_SegmentAttach", { ctx.Str("bench"), 1024, 0, 0 }), 100, 5 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_RemoteRef", "",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("OnBenchRemote") }; return true; }, NULL },
+		{ "HelloWorld_CallRemoteRef", "2 integers",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell ref = ctx.Call("HelloWorld_RemoteRef", { ctx.Str("OnBenchRemote") });
+				args = { ref, ctx.Str("ii"), ctx.Ref(1), ctx.Ref(2) };
+				return true;
+			}, NULL },
+		{ "HelloWorld_CallRemote", "integer and string",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Str("OnBenchRemote"), ctx.Str("is"), ctx.Ref(1), ctx.Str("text") };
+				return true;
+			}, NULL },
+		{ "HelloWorld_TableFind", "missing table",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("no_such_table") }; return true; }, NULL },
+		{ "HelloWorld_KVSet", "",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("bench_key"), ctx.Str("bench_value") }; return true; }, NULL },
+		{ "HelloWorld_KVGet", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				ctx.Call("HelloWorld_KVSet", { ctx.Str("bench_key"), ctx.Str("bench_value") });
+				args = { ctx.Str("bench_key"), ctx.script->Alloc(64), 64 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_KVSetInt", "",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("bench_int"), 12345 }; return true; }, NULL },
+		{ "HelloWorld_KVGetInt", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				ctx.Call("HelloWorld_KVSetInt", { ctx.Str("bench_int"), 12345 });
+				args = { ctx.Str("bench_int"), 0 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_KVExists", "",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("bench_key") }; return true; }, NULL },
+		{ "HelloWorld_KVDelete", "missing key",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("bench_no_such_key") }; return true; }, NULL },
+		{ "HelloWorld_SerialSchema", "cached schema",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("i[4] f[2] s[24]") }; return true; }, NULL },
+		{ "HelloWorld_SerialSchemaSize", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Call("HelloWorld_SerialSchema", { ctx.Str("i[4] f[2] s[24]") }) };
+				return true;
+			}, NULL },
+		{ "HelloWorld_Serialize", "i[4] f[2] s[24]",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell schema = ctx.Call("HelloWorld_SerialSchema", { ctx.Str("i[4] f[2] s[24]") });
+				args = { schema, ctx.Array(Sequence(30, 32, 1)), ctx.script->Alloc(64), 30, 64 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_Deserialize", "i[4] f[2] s[24]",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell schema = ctx.Call("HelloWorld_SerialSchema", { ctx.Str("i[4] f[2] s[24]") });
+				const cell buffer = ctx.script->Alloc(64);
+				const cell num_bytes = ctx.Call("HelloWorld_Serialize",
+					{ schema, ctx.Array(Sequence(30, 32, 1)), buffer, 30, 64 });
+				args = { schema, buffer, num_bytes, ctx.script->Alloc(30), 30 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_Format", "\"%d %s %.2f\"",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.script->Alloc(128), 128, ctx.Str("%d %s %.2f"),
+					ctx.Ref(1234), ctx.Str("Some_Player"), ctx.Ref(Float(3.14159f)) };
+				return true;
+			}, NULL },
+		{ "HelloWorld_RegexCompile", "cached pattern",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("^[a-z]+_[0-9]+$"), 0 }; return true; }, NULL },
+		{ "HelloWorld_RegexGroups", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Call("HelloWorld_RegexCompile", { ctx.Str("^([a-z]+)_([0-9]+)$"), 0 }) };
+				return true;
+			}, NULL },
+		{ "HelloWorld_RegexMatch", "10 characters",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell regex = ctx.Call("HelloWorld_RegexCompile", { ctx.Str("^[a-z]+_[0-9]+$"), 0 });
+				args = { regex, ctx.Str("player_123") };
+				return true;
+			}, NULL },
+		{ "HelloWorld_RegexSearch", "2 groups",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell regex = ctx.Call("HelloWorld_RegexCompile", { ctx.Str("([a-z]+)_([0-9]+)"), 0 });
+				args = { regex, ctx.Str("name: player_123"), ctx.script->Alloc(6), 6, 0 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_RegexMatchAny", "4 patterns, none match",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const char *const patterns[] = { "spam+", "bad(word|thing)", "^!", "[0-9]{5}" };
+				std::vector<cell> regexes;
+				for (size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); ++i)
+					regexes.push_back(ctx.Call("HelloWorld_RegexCompile", { ctx.Str(patterns[i]), 1 }));
+				args = { ctx.Str("an ordinary chat message of some length"), ctx.Array(regexes), (cell)regexes.size() };
+				return true;
+			}, NULL },
+		{ "HelloWorld_InvalidatePlayer", "",
+			[](Context &ctx, std::vector<cell> &args) { args = { 5 }; return true; }, NULL },
+		{ "HelloWorld_GetNativeIndex", "",
+			[](Context &ctx, std::vector<cell> &args) { args = { ctx.Str("HelloWorld_Format") }; return true; }, NULL },
+		{ "HelloWorld_BatchCall", "10 x InternLength",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				const cell index = ctx.Call("HelloWorld_GetNativeIndex", { ctx.Str("HelloWorld_InternLength") });
+				const cell id = ctx.Call("HelloWorld_Intern", { ctx.Str("bench_interned_string") });
+				if (index < 0)
+					return false;
+				std::vector<cell> calls;
+				for (int i = 0; i < 10; ++i)
+				{
+					calls.push_back(index);
+					calls.push_back(1);
+					calls.push_back(id);
+				}
+				args = { ctx.Array(calls), (cell)calls.size(), ctx.script->Alloc(10), 10 };
+				return true;
+			}, NULL },
+		{ "HelloWorld_GetMemoryUsage", "",
+			[](Context &ctx, std::vector<cell> &args)
+			{
+				args = { ctx.Ref(0), ctx.Ref(0), ctx.Ref(0), ctx.Ref(0) };
+				return true;
+			}, NULL },
+		{ "HelloWorld_ResetMemoryUsage", "",
+			[](Context &ctx, std::vector<cell> &args) { args = {}; return true; }, NULL },
+	};
+
+	const char *const server_natives[] =
+	{
+		"IsPlayerConnected",
+		"GetPlayerName",
+		"SetPlayerName"
+	};
+
+	void Report(const char *name, const char *description, double ns)
+	{
+		printf("%-36s %10.1f ns/call  %s\n", name, ns, description);
+		fflush(stdout);
+	}
+
+	void Report(const char *name, const char *note)
+	{
+		printf("%-36s %10s          %s\n", name, "-", note);
+		fflush(stdout);
+	}
+
+	bool Matches(const char *name, const char *filter)
+	{
+		return filter == NULL || strstr(name, filter) != NULL;
+	}
+
+	void RunNativeBenchmarks(Context &ctx, const char *filter)
+	{
+		AMX *amx = ctx.script->GetAmx();
+		for (size_t i = 0; i < sizeof(native_cases) / sizeof(native_cases[0]); ++i)
+		{
+			const NativeCase &c = native_cases[i];
+			if (!Matches(c.native, filter))
+				continue;
+			if (ctx.natives.count(c.native) == 0)
+			{
+				Report(c.native, "not registered by the plugin");
+				continue;
+			}
+			ctx.script->ResetHeap();
+			std::vector<cell> args;
+			if (!c.setup(ctx, args))
+			{
+				Report(c.native, "skipped");
+				continue;
+			}
+			ctx.Tick();
+			std::vector<cell> params(1, (cell)(args.size() * sizeof(cell)));
+			params.insert(params.end(), args.begin(), args.end());
+			const AMX_NATIVE native = ctx.natives[c.native];
+			int native_index = -1;
+			amx_FindNative(amx, c.native, &native_index);
+			ctx.script->SetCurrentNative(native_index);
+			const double ns = benchutils::MeasureNs([&](size_t iterations)
+			{
+				cell *p = &params[0];
+				for (size_t n = 0; n < iterations; ++n)
+				{
+					if (c.before_call != NULL)
+						c.before_call(p, n);
+					native(amx, p);
+				}
+			});
+			amx->error = AMX_ERR_NONE;
+			Report(c.native, c.description, ns);
+		}
+		for (std::map<std::string, AMX_NATIVE>::const_iterator it = ctx.natives.begin(); it != ctx.natives.end(); ++it)
+		{
+			bool found = false;
+			for (size_t i = 0; i < sizeof(native_cases) / sizeof(native_cases[0]) && !found; ++i)
+				found = (it->first == native_cases[i].native);
+			if (!found && Matches(it->first.c_str(), filter))
+				Report(it->first.c_str(), "no benchmark for this native");
+		}
+	}
+
+	/*
+		The server natives as the scripts see them after AmxLoad,
+		i.e. including the hooks installed by the plugin.
+	*/
+	void RunHookBenchmarks(Context &ctx, const char *filter)
+	{
+		AMX *amx = ctx.script->GetAmx();
+		for (size_t i = 0; i < sizeof(server_natives) / sizeof(server_natives[0]); ++i)
+		{
+			const char *name = server_natives[i];
+			if (!Matches(name, filter))
+				continue;
+			int index;
+			if (amx_FindNative(amx, name, &index) != AMX_ERR_NONE)
+				continue;
+			AMX_HEADER *hdr = (AMX_HEADER *)amx->base;
+			const AMX_FUNCSTUB *func = (const AMX_FUNCSTUB *)(amx->base + (size_t)hdr->natives +
+				(size_t)index * (size_t)hdr->defsize);
+			const AMX_NATIVE native = (AMX_NATIVE)(size_t)func->address;
+			ctx.script->ResetHeap();
+			const cell params[] = { 3 * sizeof(cell), 5, ctx.script->Alloc(32), 32 };
+			const cell set_params[] = { 2 * sizeof(cell), 5, ctx.Str("Player_5") };
+			const cell *p = (strcmp(name, "SetPlayerName") == 0) ? set_params : params;
+			ctx.Tick();
+			const double ns = benchutils::MeasureNs([&](size_t iterations)
+			{
+				for (size_t n = 0; n < iterations; ++n)
+					native(amx, const_cast<cell *>(p));
+			});
+			Report(name, "server native as seen by scripts", ns);
+		}
+	}
+
+	void RunHelperBenchmarks(Context &ctx, const char *filter)
+	{
+		AMX *amx = ctx.script->GetAmx();
+		ctx.script->ResetHeap();
+		int index = 0;
+		amx_FindNative(amx, "HelloWorld_Format", &index);
+		if (Matches("GetCurrentNativeFunctionName", filter))
+		{
+			ctx.script->SetCurrentNative(index);
+			Report("GetCurrentNativeFunctionName", "SYSREQ.C", benchutils::MeasureNs([&](size_t iterations)
+			{
+				for (size_t n = 0; n < iterations; ++n)
+					pluginutils::GetCurrentNativeFunctionName(amx);
+			}));
+		}
+		const cell str = ctx.Str("The quick brown fox jumps over the lazy dog.");
+		int error;
+		if (Matches("GetCString", filter))
+		{
+			Report("GetCString", "44 characters", benchutils::MeasureNs([&](size_t iterations)
+			{
+				for (size_t n = 0; n < iterations; ++n)
+					free(pluginutils::GetCString(amx, str, error));
+			}));
+		}
+		if (Matches("GetCXXString", filter))
+		{
+			Report("GetCXXString", "44 characters", benchutils::MeasureNs([&](size_t iterations)
+			{
+				for (size_t n = 0; n < iterations; ++n)
+					pluginutils::GetCXXString(amx, str, error);
+			}));
+		}
+		const cell dest = ctx.script->Alloc(64);
+		if (Matches("SetCString", filter))
+		{
+			Report("SetCString", "44 characters", benchutils::MeasureNs([&](size_t iterations)
+			{
+				for (size_t n = 0; n < iterations; ++n)
+					pluginutils::SetCString(amx, dest, 64, "The quick brown fox jumps over the lazy dog.");
+			}));
+		}
+		if (Matches("GetArrayAddr", filter))
+		{
+			Report("GetArrayAddr", "64 cells", benchutils::MeasureNs([&](size_t iterations)
+			{
+				for (size_t n = 0; n < iterations; ++n)
+					pluginutils::GetArrayAddr(amx, dest, 64, error);
+			}));
+		}
+	}
+
+}
+
+
+int main(int argc, char *argv[])
+{
+	std::string default_path = "./";
+	for (const char *c = PLUGIN_NAME; *c != '\0'; ++c)
+		default_path += (char)tolower((unsigned char)*c);
+	default_path += ".so";
+	const char *plugin_path = (argc > 1) ? argv[1] : default_path.c_str();
+	const char *filter = (argc > 2) ? argv[2] : NULL;
+
+	pAMXFunctions = amxhost::GetExports();
+	logprintf = amxhost::Logprintf;
+	amxhost::Plugin plugin;
+	if (!plugin.Load(plugin_path))
+		return 1;
+
+	// The script uses every native that has a benchmark, and the publics they call.
+	amxhost::ScriptDesc desc;
+	for (size_t i = 0; i < sizeof(native_cases) / sizeof(native_cases[0]); ++i)
+		desc.natives.push_back(native_cases[i].native);
+	desc.natives.insert(desc.natives.end(), server_natives,
+		server_natives + sizeof(server_natives) / sizeof(server_natives[0]));
+	desc.publics.push_back(std::string(PLUGIN_COMMAND_PREFIX) + "test");
+	desc.publics.push_back("OnBenchRemote");
+	amxhost::Script script(desc);
+	script.RegisterServerNatives();
+	if (!plugin.AmxLoad(script.GetAmx()))
+	{
+		fprintf(stderr, "AmxLoad failed\n");
+		return 1;
+	}
+
+	Context ctx;
+	ctx.plugin = &plugin;
+	ctx.script = &script;
+	const std::vector<AMX_NATIVE_INFO> &natives = amxhost::GetRegisteredNatives();
+	for (size_t i = 0; i < natives.size(); ++i)
+		ctx.natives[natives[i].name] = natives[i].func;
+
+	amxhost::SetLogMuted(true);
+	RunNativeBenchmarks(ctx, filter);
+	RunHookBenchmarks(ctx, filter);
+	RunHelperBenchmarks(ctx, filter);
+	amxhost::SetLogMuted(false);
+
+	plugin.AmxUnload(script.GetAmx());
+	return 0;
+}
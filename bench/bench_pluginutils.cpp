@@ -0,0 +1,290 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+/*
+	Microbenchmarks of the pluginutils functions on synthetic scripts built
+	by amxhost, over a range of native counts, native table layouts, string
+	and array sizes.
+
+	Usage: bench_pluginutils [--json <file or ->] [--natives 16,256,...]
+	                         [--strings 8,64,...] [--arrays 16,1024,...]
+
+	The JSON output is meant to be kept and compared between builds.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <utility>
+#include <vector>
+#include "amxhost.h"
+#include "benchutils.h"
+#include "pluginutils.h"
+
+
+extern void *pAMXFunctions;
+void *(*logprintf)(const char *fmt, ...);
+
+namespace
+{
+
+	struct Result
+	{
+		std::string benchmark;
+		std::string variant;
+		std::vector<std::pair<std::string, long> > params;
+		double ns;
+	};
+
+	std::vector<Result> results;
+
+	// Where the results are printed as text (stderr when the JSON goes to stdout).
+	FILE *report = stdout;
+
+	void AddResult(const char *benchmark, const char *variant,
+		const std::vector<std::pair<std::string, long> > &params, double ns)
+	{
+		Result result = { benchmark, variant, params, ns };
+		results.push_back(result);
+		std::string params_str;
+		for (size_t i = 0; i < params.size(); ++i)
+		{
+			char buffer[64];
+			snprintf(buffer, sizeof(buffer), "%s%s=%ld", (i != 0) ? " " : "",
+				params[i].first.c_str(), params[i].second);
+			params_str += buffer;
+		}
+		fprintf(report, "%-30s %-10s %-28s %12.2f ns\n", benchmark, variant, params_str.c_str(), ns);
+		fflush(report);
+	}
+
+	std::vector<size_t> ParseList(const char *str)
+	{
+		std::vector<size_t> values;
+		for (char *end; *str != '\0'; str = (*end == ',') ? end + 1 : end)
+		{
+			values.push_back((size_t)strtoul(str, &end, 10));
+			if (end == str)
+				break;
+		}
+		return values;
+	}
+
+	void BenchNativeTable(size_t num_natives, bool name_table)
+	{
+		amxhost::ScriptDesc desc;
+		desc.name_table = name_table;
+		desc.data_size = 64 * 1024;
+		std::vector<AMX_NATIVE_INFO> natives(num_natives);
+		for (size_t i = 0; i < num_natives; ++i)
+		{
+			char name[sEXPMAX + 1];
+			snprintf(name, sizeof(name), "native_%05u", (unsigned)i);
+			desc.natives.push_back(name);
+		}
+		for (size_t i = 0; i < num_natives; ++i)
+		{
+			// The natives are never called, they only need distinct addresses.
+			natives[i].name = desc.natives[i].c_str();
+			natives[i].func = (AMX_NATIVE)(size_t)(0x10000 + i * 16);
+		}
+		amxhost::Script script(desc);
+		AMX *amx = script.GetAmx();
+		amx_Register(amx, &natives[0], (int)num_natives);
+
+		const int defsize = (int)((AMX_HEADER *)amx->base)->defsize;
+		const std::vector<std::pair<std::string, long> > params = {
+			{ "natives", (long)num_natives }, { "defsize", (long)defsize } };
+		const int last = (int)num_natives - 1;
+
+		// The current native is the last one, the worst case for a table search.
+		script.SetCurrentNative(last, false);
+		AddResult("GetCurrentNativeFunctionName", "SYSREQ.C", params, benchutils::MeasureNs([&](size_t iterations)
+		{
+			for (size_t n = 0; n < iterations; ++n)
+				benchutils::KeepResult(pluginutils::GetCurrentNativeFunctionName(amx));
+		}));
+		script.SetCurrentNative(last, true);
+		AddResult("GetCurrentNativeFunctionName", "SYSREQ.D", params, benchutils::MeasureNs([&](size_t iterations)
+		{
+			for (size_t n = 0; n < iterations; ++n)
+				benchutils::KeepResult(pluginutils::GetCurrentNativeFunctionName(amx));
+		}));
+
+		const char *name = natives[last].name;
+		AMX_NATIVE current = natives[last].func, other = natives[0].func;
+		AddResult("ReplaceNative", "last", params, benchutils::MeasureNs([&](size_t iterations)
+		{
+			for (size_t n = 0; n < iterations; ++n)
+			{
+				AMX_NATIVE orig;
+				pluginutils::ReplaceNative(amx, name, other, &orig);
+				other = current;
+				current = orig;
+			}
+		}));
+	}
+
+	void BenchStrings(size_t len, bool packed)
+	{
+		amxhost::ScriptDesc desc;
+		desc.data_size = (len + 1) * 3 * sizeof(cell) + 64 * 1024;
+		amxhost::Script script(desc);
+		AMX *amx = script.GetAmx();
+		std::string str(len, 'x');
+		for (size_t i = 0; i < len; ++i)
+			str[i] = (char)('a' + i % 26);
+		const cell address = script.AllocString(str.c_str(), packed);
+		const cell dest = script.Alloc(len + 1);
+		const char *variant = packed ? "packed" : "unpacked";
+		const std::vector<std::pair<std::string, long> > params = { { "length", (long)len } };
+		int error;
+
+		AddResult("GetCString", variant, params, benchutils::MeasureNs([&](size_t iterations)
+		{
+			for (size_t n = 0; n < iterations; ++n)
+				free(pluginutils::GetCString(amx, address, error));
+		}));
+		AddResult("GetCXXString", variant, params, benchutils::MeasureNs([&](size_t iterations)
+		{
+			for (size_t n = 0; n < iterations; ++n)
+				benchutils::KeepResult(pluginutils::GetCXXString(amx, address, error).size());
+		}));
+		AddResult("SetCString", variant, params, benchutils::MeasureNs([&](size_t iterations)
+		{
+			for (size_t n = 0; n < iterations; ++n)
+				pluginutils::SetCString(amx, dest, (cell)len + 1, str.c_str(), packed);
+		}));
+	}
+
+	void BenchArrays(size_t num_cells)
+	{
+		std::vector<cell> array(num_cells);
+		for (size_t i = 0; i < num_cells; ++i)
+			array[i] = (cell)(i * 0x01010101u);
+		const std::vector<std::pair<std::string, long> > params = { { "cells", (long)num_cells } };
+
+		AddResult("AlignCellArray", "", params, benchutils::MeasureNs([&](size_t iterations)
+		{
+			for (size_t n = 0; n < iterations; ++n)
+				pluginutils::AlignCellArray(&array[0], num_cells);
+			benchutils::KeepResult(array[0]);
+		}));
+		AddResult("GetPackedArrayCharAddr", "all chars", params, benchutils::MeasureNs([&](size_t iterations)
+		{
+			const cell num_chars = (cell)(num_cells * sizeof(cell));
+			for (size_t n = 0; n < iterations; ++n)
+			{
+				unsigned sum = 0;
+				for (cell i = 0; i < num_chars; ++i)
+					sum += *pluginutils::GetPackedArrayCharAddr(&array[0], i);
+				benchutils::KeepResult(sum);
+			}
+		}));
+	}
+
+	void WriteJsonString(FILE *file, const std::string &str)
+	{
+		fputc('"', file);
+		for (size_t i = 0; i < str.size(); ++i)
+		{
+			if (str[i] == '"' || str[i] == '\\')
+				fputc('\\', file);
+			fputc(str[i], file);
+		}
+		fputc('"', file);
+	}
+
+	void WriteJson(FILE *file)
+	{
+		char timestamp[32];
+		const time_t now = time(NULL);
+		strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+		fprintf(file, "{\n\t\"timestamp\": \"%s\",\n\t\"cell_size\": %u,\n\t\"results\": [", timestamp,
+			(unsigned)sizeof(cell));
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const Result &result = results[i];
+			fprintf(file, "%s\n\t\t{ \"benchmark\": ", (i != 0) ? "," : "");
+			WriteJsonString(file, result.benchmark);
+			fprintf(file, ", \"variant\": ");
+			WriteJsonString(file, result.variant);
+			for (size_t j = 0; j < result.params.size(); ++j)
+			{
+				fprintf(file, ", ");
+				WriteJsonString(file, result.params[j].first);
+				fprintf(file, ": %ld", result.params[j].second);
+			}
+			fprintf(file, ", \"ns_per_call\": %.3f }", result.ns);
+		}
+		fprintf(file, "\n\t]\n}\n");
+	}
+
+}
+
+
+int main(int argc, char *argv[])
+{
+	const char *json_path = NULL;
+	std::vector<size_t> native_counts = ParseList("16,128,1024");
+	std::vector<size_t> string_lengths = ParseList("8,64,512,4096");
+	std::vector<size_t> array_sizes = ParseList("16,256,4096,65536");
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool has_value = (i + 1 < argc);
+		if (strcmp(argv[i], "--json") == 0 && has_value)
+			json_path = argv[++i];
+		else if (strcmp(argv[i], "--natives") == 0 && has_value)
+			native_counts = ParseList(argv[++i]);
+		else if (strcmp(argv[i], "--strings") == 0 && has_value)
+			string_lengths = ParseList(argv[++i]);
+		else if (strcmp(argv[i], "--arrays") == 0 && has_value)
+			array_sizes = ParseList(argv[++i]);
+		else
+		{
+			fprintf(stderr, "Usage: %s [--json <file or ->] [--natives N,...] [--strings N,...] [--arrays N,...]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (json_path != NULL && strcmp(json_path, "-") == 0)
+		report = stderr;
+	pAMXFunctions = amxhost::GetExports();
+	logprintf = amxhost::Logprintf;
+
+	for (size_t i = 0; i < native_counts.size(); ++i)
+	{
+		if (native_counts[i] == 0)
+			continue;
+		BenchNativeTable(native_counts[i], false);
+		BenchNativeTable(native_counts[i], true);
+	}
+	for (size_t i = 0; i < string_lengths.size(); ++i)
+	{
+		BenchStrings(string_lengths[i], false);
+		BenchStrings(string_lengths[i], true);
+	}
+	for (size_t i = 0; i < array_sizes.size(); ++i)
+	{
+		if (array_sizes[i] != 0)
+			BenchArrays(array_sizes[i]);
+	}
+
+	if (json_path != NULL)
+	{
+		FILE *file = (strcmp(json_path, "-") == 0) ? stdout : fopen(json_path, "w");
+		if (file == NULL)
+		{
+			fprintf(stderr, "Can't open %s for writing\n", json_path);
+			return 1;
+		}
+		WriteJson(file);
+		if (file != stdout)
+			fclose(file);
+	}
+	return 0;
+}
@@ -0,0 +1,61 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _BENCHUTILS_H
+#define _BENCHUTILS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+
+
+namespace benchutils
+{
+
+	/*
+		Calls 'func(iterations)' with a growing number of iterations until a run
+		takes at least 'min_run_seconds', then returns the best time per iteration
+		(in nanoseconds) out of 'num_runs' runs of that length.
+	*/
+	template <typename Func>
+	double MeasureNs(Func func, double min_run_seconds = 0.05, int num_runs = 3)
+	{
+		typedef std::chrono::steady_clock clock;
+		size_t iterations = 1;
+		for (;;)
+		{
+			const clock::time_point start = clock::now();
+			func(iterations);
+			const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+			if (seconds >= min_run_seconds || iterations >= ((size_t)1 << 30))
+				break;
+			iterations *= (seconds < min_run_seconds / 16) ? 16 : 2;
+		}
+		double best = HUGE_VAL;
+		for (int run = 0; run < num_runs; ++run)
+		{
+			const clock::time_point start = clock::now();
+			func(iterations);
+			const double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+			best = std::min(best, ns / (double)iterations);
+		}
+		return best;
+	}
+
+	/*
+		Keeps the compiler from optimizing away a computation whose result isn't used.
+	*/
+	template <typename T>
+	inline void KeepResult(const T &value)
+	{
+		static volatile T sink;
+		sink = value;
+		(void)sink;
+	}
+
+}
+
+
+#endif // _BENCHUTILS_H
@@ -0,0 +1,327 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+/*
+	Replays a native call trace recorded on a server (a plugin built with
+	PLUGIN_ENABLE_RECORDER) against the plugin loaded into the amxhost
+	stand-in, and compares the time of every native with the recording.
+
+	Usage: replay <trace file> [path to the plugin] [--repeat N]
+
+	Every recorded script gets its own synthetic script. The memory the
+	arguments pointed to is put back at the same addresses before each call,
+	so the arguments are passed unchanged. Calls made from inside other
+	recorded calls (e.g. by HelloWorld_BatchCall) are not replayed on their
+	own, and ProcessTick is called every 5 ms of recorded time, the default
+	server tick.
+
+	Payloads are cut to PLUGIN_RECORDER_PAYLOAD_CELLS, so natives taking
+	longer strings or arrays are replayed with shortened data. Use a plugin
+	built without the recorder: a recording one writes a new trace over
+	the old one.
+
+	Run it from a scratch directory: like on a server, the plugin reads and
+	writes files under scriptfiles/.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "amxhost.h"
+#include "pluginconfig.h"
+#include "traceformat.h"
+
+
+extern void *pAMXFunctions;
+void *(*logprintf)(const char *fmt, ...);
+
+namespace
+{
+
+	typedef std::chrono::steady_clock Clock;
+
+	const uint64_t TICK_INTERVAL_NS = 5000000;
+	// Heap and stack space left to the natives above the recorded memory.
+	const size_t FREE_MEMORY_SIZE = 64 * 1024;
+
+	struct Call
+	{
+		const TraceCall *call;
+		const int32_t *args;
+		const char *payloads;
+		const char *end;
+	};
+
+	struct ScriptInfo
+	{
+		ScriptInfo() : memory_end(0) {}
+
+		size_t memory_end; // End of the highest payload.
+		std::unique_ptr<amxhost::Script> script;
+	};
+
+	struct NativeStats
+	{
+		NativeStats() : num_calls(0), recorded_ns(0), replayed_ns(0) {}
+
+		size_t num_calls;
+		double recorded_ns;
+		double replayed_ns;
+	};
+
+	bool ReadFile(const char *path, std::vector<char> &data)
+	{
+		FILE *file = fopen(path, "rb");
+		if (file == NULL)
+			return false;
+		char buffer[65536];
+		size_t size;
+		while ((size = fread(buffer, 1, sizeof(buffer), file)) != 0)
+			data.insert(data.end(), buffer, buffer + size);
+		const bool ok = ferror(file) == 0;
+		fclose(file);
+		return ok;
+	}
+
+	/*
+		Splits the trace into native names and top-level calls.
+	*/
+	bool ParseTrace(const std::vector<char> &data, std::vector<std::string> &natives, std::vector<Call> &calls,
+		std::map<uint32_t, ScriptInfo> &scripts, size_t &num_dropped)
+	{
+		const TraceHeader *header = (const TraceHeader *)data.data();
+		if (data.size() < sizeof(TraceHeader) || memcmp(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0)
+		{
+			fprintf(stderr, "Not a native call trace\n");
+			return false;
+		}
+		if (header->version != TRACE_FORMAT_VERSION || header->cell_size != sizeof(cell))
+		{
+			fprintf(stderr, "Unsupported trace version %u (cell size %u)\n", (unsigned)header->version,
+				(unsigned)header->cell_size);
+			return false;
+		}
+
+		size_t pos = sizeof(TraceHeader);
+		num_dropped = 0;
+		while (pos + sizeof(TraceRecordHeader) <= data.size())
+		{
+			const TraceRecordHeader *record = (const TraceRecordHeader *)&data[pos];
+			if (record->size < sizeof(TraceRecordHeader) || record->size > data.size() - pos)
+				break; // Cut off (the server was killed while writing).
+			const char *body = &data[pos] + sizeof(TraceRecordHeader);
+			const char *end = &data[pos] + record->size;
+			pos += record->size;
+			if (record->type == TRACE_RECORD_NATIVE && end - body > (ptrdiff_t)sizeof(uint32_t))
+			{
+				const uint32_t native_id = *(const uint32_t *)body;
+				if (natives.size() <= native_id)
+					natives.resize(native_id + 1);
+				natives[native_id].assign(body + sizeof(uint32_t), strnlen(body + sizeof(uint32_t),
+					end - body - sizeof(uint32_t)));
+			}
+			else if (record->type == TRACE_RECORD_DROPPED && end - body >= (ptrdiff_t)sizeof(uint32_t))
+			{
+				num_dropped += *(const uint32_t *)body;
+			}
+			else if (record->type == TRACE_RECORD_CALL && end - body >= (ptrdiff_t)sizeof(TraceCall))
+			{
+				Call call;
+				call.call = (const TraceCall *)body;
+				call.args = (const int32_t *)(body + sizeof(TraceCall));
+				call.payloads = (const char *)(call.args + call.call->num_args);
+				call.end = end;
+				if (call.call->depth != 0 || call.payloads > end)
+					continue;
+				ScriptInfo &script = scripts[call.call->script_id];
+				for (const char *p = call.payloads; p + sizeof(TracePayload) <= end; )
+				{
+					const TracePayload *payload = (const TracePayload *)p;
+					if (payload->arg_index < call.call->num_args)
+					{
+						const size_t payload_end = (size_t)(ucell)call.args[payload->arg_index]
+							+ (payload->num_cells + payload->num_zero_cells) * sizeof(cell);
+						script.memory_end = std::max(script.memory_end, payload_end);
+					}
+					p += sizeof(TracePayload) + payload->num_cells * sizeof(cell);
+				}
+				calls.push_back(call);
+			}
+		}
+		return true;
+	}
+
+	/*
+		Restores the memory the arguments pointed to. Returns false if
+		the record is malformed.
+	*/
+	bool WritePayloads(amxhost::Script &script, const Call &call)
+	{
+		for (const char *p = call.payloads; p < call.end; )
+		{
+			const TracePayload *payload = (const TracePayload *)p;
+			const cell *cells = (const cell *)(p + sizeof(TracePayload));
+			p += sizeof(TracePayload) + payload->num_cells * sizeof(cell);
+			if (p > call.end || payload->arg_index >= call.call->num_args)
+				return false;
+			cell *dest = script.GetPhysAddr(call.args[payload->arg_index]);
+			memcpy(dest, cells, payload->num_cells * sizeof(cell));
+			memset(dest + payload->num_cells, 0, payload->num_zero_cells * sizeof(cell));
+		}
+		return true;
+	}
+
+}
+
+
+int main(int argc, char *argv[])
+{
+	const char *trace_path = NULL;
+	std::string plugin_path = "./";
+	for (const char *c = PLUGIN_NAME; *c != '\0'; ++c)
+		plugin_path += (char)tolower((unsigned char)*c);
+	plugin_path += ".so";
+	int repeat = 1;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+			repeat = std::max(atoi(argv[++i]), 1);
+		else if (trace_path == NULL)
+			trace_path = argv[i];
+		else
+			plugin_path = argv[i];
+	}
+	if (trace_path == NULL)
+	{
+		fprintf(stderr, "Usage: %s <trace file> [path to the plugin] [--repeat N]\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<char> data;
+	if (!ReadFile(trace_path, data))
+	{
+		fprintf(stderr, "Can't read %s\n", trace_path);
+		return 1;
+	}
+	std::vector<std::string> natives;
+	std::vector<Call> calls;
+	std::map<uint32_t, ScriptInfo> scripts;
+	size_t num_dropped;
+	if (!ParseTrace(data, natives, calls, scripts, num_dropped))
+		return 1;
+	for (size_t i = 0; i < natives.size(); ++i)
+	{
+		if (natives[i].empty())
+			natives[i] = "unknown_native_" + std::to_string(i);
+	}
+
+	pAMXFunctions = amxhost::GetExports();
+	logprintf = amxhost::Logprintf;
+	amxhost::Plugin plugin;
+	if (!plugin.Load(plugin_path.c_str()))
+		return 1;
+
+	// The scripts use every recorded native, the server natives among them
+	// are hooked by the plugin.
+	amxhost::ScriptDesc desc;
+	desc.natives = natives;
+	for (std::map<uint32_t, ScriptInfo>::iterator it = scripts.begin(); it != scripts.end(); ++it)
+	{
+		ScriptInfo &info = it->second;
+		desc.data_size = info.memory_end + FREE_MEMORY_SIZE;
+		info.script.reset(new amxhost::Script(desc));
+		info.script->RegisterServerNatives();
+		if (!plugin.AmxLoad(info.script->GetAmx()))
+		{
+			fprintf(stderr, "AmxLoad failed\n");
+			return 1;
+		}
+		// Make all the recorded addresses valid: data, heap and stack alike.
+		const AMX *amx = info.script->GetAmx();
+		if ((size_t)amx->hea < info.memory_end)
+			info.script->Alloc((info.memory_end - (size_t)amx->hea + sizeof(cell) - 1) / sizeof(cell));
+	}
+
+	std::vector<NativeStats> stats(natives.size());
+	std::vector<cell> params;
+	size_t num_skipped = 0;
+	amxhost::SetLogMuted(true);
+	for (int n = 0; n < repeat; ++n)
+	{
+		uint64_t next_tick = TICK_INTERVAL_NS;
+		for (size_t i = 0; i < calls.size(); ++i)
+		{
+			const Call &call = calls[i];
+			if (call.call->start_ns >= next_tick)
+			{
+				plugin.ProcessTick();
+				next_tick = (call.call->start_ns / TICK_INTERVAL_NS + 1) * TICK_INTERVAL_NS;
+			}
+			amxhost::Script &script = *scripts[call.call->script_id].script;
+			const int index = (int)call.call->native_id;
+			const AMX_NATIVE func = (index < (int)natives.size()) ? script.GetNative(index) : NULL;
+			if (func == NULL || !WritePayloads(script, call))
+			{
+				num_skipped += (n == 0) ? 1 : 0;
+				continue;
+			}
+			params.assign(1, (cell)(call.call->num_args * sizeof(cell)));
+			params.insert(params.end(), call.args, call.args + call.call->num_args);
+			script.SetCurrentNative(index);
+			script.GetAmx()->error = AMX_ERR_NONE;
+
+			const Clock::time_point start = Clock::now();
+			func(script.GetAmx(), &params[0]);
+			const Clock::time_point end = Clock::now();
+
+			NativeStats &native_stats = stats[index];
+			native_stats.num_calls += 1;
+			native_stats.recorded_ns += call.call->duration_ns;
+			native_stats.replayed_ns += std::chrono::duration<double, std::nano>(end - start).count();
+		}
+		plugin.ProcessTick();
+	}
+	amxhost::SetLogMuted(false);
+	for (std::map<uint32_t, ScriptInfo>::iterator it = scripts.begin(); it != scripts.end(); ++it)
+		plugin.AmxUnload(it->second.script->GetAmx());
+
+	// Most time consuming natives first.
+	std::vector<size_t> order;
+	for (size_t i = 0; i < stats.size(); ++i)
+	{
+		if (stats[i].num_calls != 0)
+			order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+	{
+		return stats[a].replayed_ns > stats[b].replayed_ns;
+	});
+	printf("%-32s %10s %14s %14s %8s\n", "native", "calls", "recorded ns", "replayed ns", "ratio");
+	double total_recorded = 0, total_replayed = 0;
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const NativeStats &native_stats = stats[order[i]];
+		const double recorded = native_stats.recorded_ns / native_stats.num_calls;
+		const double replayed = native_stats.replayed_ns / native_stats.num_calls;
+		printf("%-32s %10u %14.1f %14.1f %8.2f\n", natives[order[i]].c_str(), (unsigned)native_stats.num_calls,
+			recorded, replayed, (recorded > 0) ? replayed / recorded : 0.0);
+		total_recorded += native_stats.recorded_ns;
+		total_replayed += native_stats.replayed_ns;
+	}
+	printf("\n%u calls in %u scripts replayed %d time(s): %.3f ms per replay (%.3f ms recorded)\n",
+		(unsigned)calls.size(), (unsigned)scripts.size(), repeat, total_replayed / repeat / 1e6,
+		total_recorded / repeat / 1e6);
+	if (num_skipped != 0)
+		printf("%u calls skipped (natives the plugin doesn't provide, or malformed records)\n", (unsigned)num_skipped);
+	if (num_dropped != 0)
+		printf("%u calls were dropped while recording\n", (unsigned)num_dropped);
+	return 0;
+}
@@ -0,0 +1,233 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "callbackfilter.h"
+#include "metrics.h"
+#include "pluginutils.h"
+
+
+namespace callbackfilter
+{
+
+	namespace
+	{
+
+		typedef std::chrono::steady_clock Clock;
+
+		struct ArgsHash
+		{
+			size_t operator()(const std::vector<cell> &args) const
+			{
+				size_t hash = 2166136261u;
+				for (size_t i = 0; i < args.size(); ++i)
+					hash = (hash ^ (size_t)(ucell)args[i]) * 16777619u;
+				return hash;
+			}
+		};
+
+		struct Rule
+		{
+			Rule() : interval(0), key_arg(0), coalesce(false), default_value(1) {}
+
+			// Throttling, off if 'interval' is 0.
+			Clock::duration interval;
+			int key_arg; // 1-based, 0 - one limit for all calls.
+			std::unordered_map<cell, Clock::time_point> last_calls; // By the value of the key argument.
+
+			// Coalescing: the arguments of the calls made in this tick.
+			bool coalesce;
+			std::unordered_set<std::vector<cell>, ArgsHash> seen_args;
+
+			cell default_value;
+		};
+
+		typedef std::unordered_map<int, Rule> RuleMap; // By public index.
+
+		std::unordered_map<AMX *, RuleMap> rules;
+		std::vector<cell> args; // Reused to look up the arguments without allocating.
+
+		MetricsEntry *suppressed;
+
+		/*
+			Checks the rule and records the call if it's let through.
+		*/
+		bool Suppress(Rule &rule, const cell *call_args, int num_args)
+		{
+			if (rule.coalesce)
+			{
+				args.assign(call_args, call_args + num_args);
+				if (rule.seen_args.find(args) != rule.seen_args.end())
+					return true;
+			}
+			if (rule.interval != Clock::duration::zero() && rule.key_arg <= num_args)
+			{
+				const cell key = (rule.key_arg > 0) ? call_args[rule.key_arg - 1] : 0;
+				const Clock::time_point now = Clock::now();
+				const std::unordered_map<cell, Clock::time_point>::iterator it = rule.last_calls.find(key);
+				if (it != rule.last_calls.end() && now - it->second < rule.interval)
+					return true;
+				rule.last_calls[key] = now;
+			}
+			if (rule.coalesce)
+				rule.seen_args.insert(args);
+			return false;
+		}
+
+		Rule &GetRule(AMX *amx, int index)
+		{
+			if (suppressed == NULL)
+				suppressed = metrics::AddCounter("callbacks.suppressed");
+			return rules[amx][index];
+		}
+
+		/*
+			Returns the index of the public named by a native's argument, or -1.
+		*/
+		int FindPublic(AMX *amx, cell name_address, int &error)
+		{
+			const std::string name = pluginutils::GetCXXString(amx, name_address, error);
+			int index;
+			if (error != AMX_ERR_NONE || amx_FindPublic(amx, name.c_str(), &index) != AMX_ERR_NONE)
+				return -1;
+			return index;
+		}
+
+	}
+
+	bool Filter(AMX *amx, int index, cell *retval)
+	{
+		if (rules.empty() || index < 0)
+			return false;
+		const std::unordered_map<AMX *, RuleMap>::iterator script = rules.find(amx);
+		if (script == rules.end())
+			return false;
+		const RuleMap::iterator rule = script->second.find(index);
+		if (rule == script->second.end())
+			return false;
+
+		const int num_args = amx->paramcount;
+		int error;
+		const cell *call_args = pluginutils::GetArrayAddr(amx, amx->stk, (size_t)num_args, error);
+		if (call_args == NULL || !Suppress(rule->second, call_args, num_args))
+			return false;
+		// What amx_Exec does with the arguments when the public returns.
+		amx->stk += num_args * (cell)sizeof(cell);
+		amx->paramcount = 0;
+		if (retval != NULL)
+			*retval = rule->second.default_value;
+		metrics::Increment(suppressed);
+		return true;
+	}
+
+	void Throttle(AMX *amx, int index, unsigned interval, int key_arg, cell default_value)
+	{
+		Rule &rule = GetRule(amx, index);
+		rule.interval = std::chrono::milliseconds(interval);
+		rule.key_arg = key_arg;
+		rule.last_calls.clear();
+		rule.default_value = default_value;
+	}
+
+	void Coalesce(AMX *amx, int index, cell default_value)
+	{
+		Rule &rule = GetRule(amx, index);
+		rule.coalesce = true;
+		rule.default_value = default_value;
+	}
+
+	bool RemoveRule(AMX *amx, int index)
+	{
+		const std::unordered_map<AMX *, RuleMap>::iterator script = rules.find(amx);
+		if (script == rules.end() || script->second.erase(index) == 0)
+			return false;
+		if (script->second.empty())
+			rules.erase(script);
+		return true;
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		rules.erase(amx);
+	}
+
+	void ProcessTick()
+	{
+		for (std::unordered_map<AMX *, RuleMap>::iterator script = rules.begin(); script != rules.end(); ++script)
+		{
+			for (RuleMap::iterator rule = script->second.begin(); rule != script->second.end(); ++rule)
+			{
+				if (!rule->second.seen_args.empty())
+					rule->second.seen_args.clear();
+			}
+		}
+	}
+
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_ThrottleCallback(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_function,
+		arg_interval,
+		arg_keyarg,
+		arg_defaultvalue,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	const int index = callbackfilter::FindPublic(amx, params[arg_function], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	if (index < 0 || params[arg_interval] <= 0 || params[arg_keyarg] < 0)
+		return 0;
+	callbackfilter::Throttle(amx, index, (unsigned)params[arg_interval], (int)params[arg_keyarg],
+		params[arg_defaultvalue]);
+	return 1;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_CoalesceCallback(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_function,
+		arg_defaultvalue,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	const int index = callbackfilter::FindPublic(amx, params[arg_function], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	if (index < 0)
+		return 0;
+	callbackfilter::Coalesce(amx, index, params[arg_defaultvalue]);
+	return 1;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_RemoveCallbackFilter(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_function,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	const int index = callbackfilter::FindPublic(amx, params[arg_function], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	return (index >= 0 && callbackfilter::RemoveRule(amx, index)) ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _CALLBACKFILTER_H
+#define _CALLBACKFILTER_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Rules set by the scripts that let exechook skip calls of their publics:
+	throttling (at most one call every so many milliseconds for each value
+	of an argument, e.g. the player) and coalescing (calls with the same
+	arguments as a call already made in the same server tick). A skipped
+	call returns the default value of the rule without entering the VM.
+	This applies to the callbacks called by the server (e.g. OnPlayerUpdate)
+	as well as to the publics called by plugins, see exechook.h.
+*/
+namespace callbackfilter
+{
+
+	/*
+		Called by exechook before executing a public. Returns true if the call
+		is to be skipped, in which case the arguments have been popped off the
+		stack (as amx_Exec does) and '*retval' is set.
+	*/
+	bool Filter(AMX *amx, int index, cell *retval);
+
+	/*
+		Lets at most one call of the public through every 'interval' milliseconds
+		for each value of argument number 'key_arg' (1-based, 0 - for all calls).
+	*/
+	void Throttle(AMX *amx, int index, unsigned interval, int key_arg, cell default_value);
+
+	/*
+		Skips the calls of the public with the same arguments as a call already
+		made in the same tick. The arguments are compared as they are, so
+		strings and arrays are compared by address, not by contents.
+	*/
+	void Coalesce(AMX *amx, int index, cell default_value);
+
+	/*
+		Returns false if the public has no rule.
+	*/
+	bool RemoveRule(AMX *amx, int index);
+
+	void AmxUnload(AMX *amx);
+	void ProcessTick();
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_ThrottleCallback(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_CoalesceCallback(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_RemoveCallbackFilter(AMX *amx, cell *params);
+
+
+#endif // _CALLBACKFILTER_H
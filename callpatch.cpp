@@ -0,0 +1,97 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include "callpatch.h"
+
+#ifdef PLUGIN_ENABLE_SYSREQ_D
+
+#include <algorithm>
+#include <vector>
+#include "amxopcodes.h"
+#include "codeanalysis.h"
+#include "nativethunks.h"
+#include "pluginutils.h"
+#include "scripts.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace callpatch
+{
+
+	namespace
+	{
+
+		// Loaded since the last tick.
+		std::vector<AMX *> pending;
+
+		size_t Patch(AMX *amx)
+		{
+#ifdef AMXOPCODES_HAVE_OPERANDS
+			const codeanalysis::Analysis *analysis = codeanalysis::Get(amx);
+			if (analysis == NULL)
+				return 0;
+			AMX_HEADER *hdr = (AMX_HEADER *)amx->base;
+			unsigned char *code = amx->base + (size_t)hdr->cod;
+			const unsigned char *natives = amx->base + (size_t)hdr->natives;
+			const cell *jump_table = pluginutils::GetOpcodeJumpTable(amx);
+			const cell sysreq_c = (jump_table != NULL)
+				? jump_table[amxopcodes::OP_SYSREQ_C] : (cell)amxopcodes::OP_SYSREQ_C;
+			const cell sysreq_d = (jump_table != NULL)
+				? jump_table[amxopcodes::OP_SYSREQ_D] : (cell)amxopcodes::OP_SYSREQ_D;
+			size_t num_patched = 0;
+			for (size_t i = 0; i < analysis->call_sites.size(); ++i)
+			{
+				const codeanalysis::CallSite &call_site = analysis->call_sites[i];
+				cell *instruction = (cell *)(void *)(code + (size_t)call_site.address);
+				if (instruction[0] != sysreq_c)
+					continue;
+				const AMX_FUNCSTUB *func = (const AMX_FUNCSTUB *)(const void *)(natives +
+					(size_t)call_site.native * (size_t)hdr->defsize);
+				const AMX_NATIVE native = (AMX_NATIVE)(size_t)func->address;
+				// The address must fit in the operand, which isn't the case on 64-bit hosts.
+				if (!nativethunks::IsThunk(native) || (size_t)(ucell)(size_t)native != (size_t)native)
+					continue;
+				instruction[1] = (cell)func->address;
+				instruction[0] = sysreq_d;
+				++num_patched;
+			}
+			return num_patched;
+#else
+			return 0;
+#endif // AMXOPCODES_HAVE_OPERANDS
+		}
+
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		pending.push_back(amx);
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		pending.erase(std::remove(pending.begin(), pending.end(), amx), pending.end());
+	}
+
+	void ProcessTick()
+	{
+		if (pending.empty())
+			return;
+		const std::vector<AMX *> &all = scripts::GetAll();
+		for (size_t i = 0; i < pending.size(); ++i)
+		{
+			const size_t num_patched = Patch(pending[i]);
+			if (num_patched != 0)
+			{
+				logprintf("%s: Script #%d calls the plugin's natives directly in %u places.", PLUGIN_NAME,
+					(int)(std::find(all.begin(), all.end(), pending[i]) - all.begin()), (unsigned)num_patched);
+			}
+		}
+		pending.clear();
+	}
+
+}
+
+#endif // PLUGIN_ENABLE_SYSREQ_D
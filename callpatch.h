@@ -0,0 +1,47 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _CALLPATCH_H
+#define _CALLPATCH_H
+
+#include "SDK/amx/amx.h"
+#include "pluginconfig.h"
+
+
+/*
+	Rewrites the SYSREQ.C instructions that call the plugin's natives and
+	hooks to SYSREQ.D with the address of the function, so the interpreter
+	calls it directly instead of looking the native up by its index on
+	every call (see codeanalysis.h for how the calls are found).
+
+	The code is patched on the first server tick after the script is loaded,
+	when all plugins have registered and hooked their natives, and only for
+	the natives that are still ours in the native table. A native hooked by
+	another plugin after that isn't seen by the patched calls, neither are
+	plugins that watch native calls through amx->callback, so this is only
+	built in when PLUGIN_ENABLE_SYSREQ_D is set.
+	GetCurrentNativeFunctionName finds the name of a native called through
+	SYSREQ.D by its address, so it keeps working.
+*/
+namespace callpatch
+{
+
+#ifdef PLUGIN_ENABLE_SYSREQ_D
+
+	void AmxLoad(AMX *amx);
+	void AmxUnload(AMX *amx);
+	void ProcessTick();
+
+#else
+
+	inline void AmxLoad(AMX *) {}
+	inline void AmxUnload(AMX *) {}
+	inline void ProcessTick() {}
+
+#endif
+
+}
+
+
+#endif // _CALLPATCH_H
@@ -0,0 +1,388 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+#include "cellformat.h"
+#include "cellstring.h"
+#include "pluginutils.h"
+
+
+namespace cellformat
+{
+
+	namespace
+	{
+
+		// Formats built from strings on the stack or heap get a new address or
+		// contents all the time; drop the cache if it grows past this.
+		const size_t MAX_CACHED_FORMATS = 4096;
+
+		const int MAX_FLOAT_PRECISION = 30;
+		// Sign, the integer digits of FLT_MAX, point, fraction and terminator.
+		const size_t MAX_FLOAT_CHARS = 1 + (FLT_MAX_10_EXP + 1) + 1 + MAX_FLOAT_PRECISION + 1;
+
+		struct Spec
+		{
+			cell conversion;  // 0 for literal text
+			size_t literal_start, literal_len;
+			int width;
+			int precision;    // -1 if not specified
+			bool left_align;
+			bool zero_pad;
+		};
+
+		struct CompiledFormat
+		{
+			std::vector<cell> text;      // Raw cells of the format string, to validate the cache.
+			std::vector<cell> literals;
+			std::vector<Spec> specs;
+			size_t num_args;
+		};
+
+		typedef std::unordered_map<cell, CompiledFormat> FormatCache;
+		std::unordered_map<AMX *, FormatCache> caches;
+
+		// The result is built here when an argument is inside the destination array.
+		std::vector<cell> scratch;
+
+		class Output
+		{
+		public:
+			Output(cell *dest, size_t max_len) : dest(dest), pos(0), max_len(max_len) {}
+
+			FORCE_INLINE void Put(cell c)
+			{
+				if (pos < max_len)
+					dest[pos++] = c;
+			}
+
+			FORCE_INLINE void Fill(cell c, size_t count)
+			{
+				count = std::min(count, max_len - pos);
+				std::fill(&dest[pos], &dest[pos + count], c);
+				pos += count;
+			}
+
+			FORCE_INLINE void Write(const cell *str, size_t len)
+			{
+				len = std::min(len, max_len - pos);
+				std::copy(str, str + len, &dest[pos]);
+				pos += len;
+			}
+
+			size_t Finish()
+			{
+				dest[pos] = 0;
+				return pos;
+			}
+
+		private:
+			cell *dest;
+			size_t pos;
+			size_t max_len;
+		};
+
+		void Compile(const cell *format, size_t len, CompiledFormat &compiled)
+		{
+			compiled.literals.clear();
+			compiled.specs.clear();
+			compiled.num_args = 0;
+			Spec literal = { 0, 0, 0, 0, -1, false, false };
+			for (size_t i = 0; i < len; )
+			{
+				if (format[i] != '%' || i + 1 == len)
+				{
+					compiled.literals.push_back(format[i++]);
+					continue;
+				}
+				if (format[i + 1] == '%')
+				{
+					compiled.literals.push_back('%');
+					i += 2;
+					continue;
+				}
+				Spec spec = { 0, 0, 0, 0, -1, false, false };
+				size_t j = i + 1;
+				for (; j < len && (format[j] == '-' || format[j] == '0'); ++j)
+				{
+					if (format[j] == '-')
+						spec.left_align = true;
+					else
+						spec.zero_pad = true;
+				}
+				for (; j < len && format[j] >= '0' && format[j] <= '9'; ++j)
+					spec.width = spec.width * 10 + (int)(format[j] - '0');
+				if (j < len && format[j] == '.')
+				{
+					spec.precision = 0;
+					for (++j; j < len && format[j] >= '0' && format[j] <= '9'; ++j)
+						spec.precision = spec.precision * 10 + (int)(format[j] - '0');
+				}
+				if (j == len)
+				{
+					// An incomplete specifier at the end is printed as is.
+					compiled.literals.insert(compiled.literals.end(), &format[i], &format[len]);
+					break;
+				}
+				switch (format[j])
+				{
+				case 'd': case 'i': case 'x': case 'X': case 'c': case 's': case 'f':
+					break;
+				default:
+					compiled.literals.insert(compiled.literals.end(), &format[i], &format[j + 1]);
+					i = j + 1;
+					continue;
+				}
+				spec.conversion = format[j];
+				i = j + 1;
+
+				// Flush the literal text collected so far.
+				literal.literal_len = compiled.literals.size() - literal.literal_start;
+				if (literal.literal_len != 0)
+					compiled.specs.push_back(literal);
+				literal.literal_start = compiled.literals.size();
+				compiled.specs.push_back(spec);
+				++compiled.num_args;
+			}
+			literal.literal_len = compiled.literals.size() - literal.literal_start;
+			if (literal.literal_len != 0)
+				compiled.specs.push_back(literal);
+		}
+
+		/*
+			Returns the number of cells a string occupies, including the terminator.
+		*/
+		size_t GetStringCells(const cell *str)
+		{
+			if ((ucell)str[0] <= UNPACKEDMAX)
+				return cellstring::Length(str) + 1;
+			int len;
+			amx_StrLen(str, &len);
+			return (size_t)len / sizeof(cell) + 1;
+		}
+
+		const CompiledFormat *GetCompiledFormat(AMX *amx, cell address, int &error)
+		{
+			cell *format;
+			if ((error = amx_GetAddr(amx, address, &format)) != AMX_ERR_NONE)
+				return NULL;
+			FormatCache &cache = caches[amx];
+			FormatCache::iterator it = cache.find(address);
+			if (it != cache.end())
+			{
+				// The same address may hold a different string, e.g. a local array.
+				const std::vector<cell> &text = it->second.text;
+				if (std::equal(text.begin(), text.end(), format))
+					return &it->second;
+			}
+			else if (cache.size() >= MAX_CACHED_FORMATS)
+			{
+				cache.clear();
+			}
+			cellstring::StringArg str;
+			if (!cellstring::GetStringArg(amx, address, str, error))
+				return NULL;
+			CompiledFormat &compiled = cache[address];
+			compiled.text.assign(format, format + GetStringCells(format));
+			Compile(str.str, str.len, compiled);
+			return &compiled;
+		}
+
+		/*
+			Checks whether any argument lies in the destination array, like in
+			Format(msg, sizeof msg, "[%d] %s", x, msg): writing the result straight
+			into 'dest' would then overwrite the argument before it's read.
+		*/
+		bool ArgsOverlap(AMX *amx, const cell *params, int first_arg, const CompiledFormat &format,
+			const cell *dest, size_t size, int &error)
+		{
+			error = AMX_ERR_NONE;
+			int arg = first_arg;
+			for (size_t i = 0; i < format.specs.size(); ++i)
+			{
+				const Spec &spec = format.specs[i];
+				if (spec.conversion == 0)
+					continue;
+				cell *value;
+				if ((error = amx_GetAddr(amx, params[arg++], &value)) != AMX_ERR_NONE)
+					return false;
+				const size_t num_cells = (spec.conversion == 's') ? GetStringCells(value) : 1;
+				if (value < dest + size && dest < value + num_cells)
+					return true;
+			}
+			return false;
+		}
+
+		void Pad(Output &out, const Spec &spec, size_t len, cell c)
+		{
+			if ((size_t)spec.width > len)
+				out.Fill(c, (size_t)spec.width - len);
+		}
+
+		void WriteAligned(Output &out, const Spec &spec, const cell *str, size_t len)
+		{
+			if (!spec.left_align)
+				Pad(out, spec, len, ' ');
+			out.Write(str, len);
+			if (spec.left_align)
+				Pad(out, spec, len, ' ');
+		}
+
+		void WriteInteger(Output &out, const Spec &spec, cell value)
+		{
+			cell digits[16];
+			size_t num_digits = 0;
+			const bool hex = (spec.conversion == 'x' || spec.conversion == 'X');
+			const bool negative = !hex && value < 0;
+			ucell uvalue = (negative) ? (ucell)0 - (ucell)value : (ucell)value;
+			const ucell base = hex ? 16 : 10;
+			do
+			{
+				digits[num_digits++] = "0123456789ABCDEF"[uvalue % base];
+				uvalue /= base;
+			} while (uvalue != 0);
+			const size_t len = num_digits + (negative ? 1 : 0);
+			if (!spec.left_align && !spec.zero_pad)
+				Pad(out, spec, len, ' ');
+			if (negative)
+				out.Put('-');
+			if (!spec.left_align && spec.zero_pad)
+				Pad(out, spec, len, '0');
+			while (num_digits != 0)
+				out.Put(digits[--num_digits]);
+			if (spec.left_align)
+				Pad(out, spec, len, ' ');
+		}
+
+		void WriteFloat(Output &out, const Spec &spec, cell value)
+		{
+			float f;
+			memcpy(&f, &value, sizeof(f));
+			char buffer[MAX_FLOAT_CHARS];
+			const int len = snprintf(buffer, sizeof(buffer), "%.*f",
+				(spec.precision < 0) ? 6 : std::min(spec.precision, MAX_FLOAT_PRECISION), (double)f);
+			cell str[sizeof(buffer)];
+			const size_t num_chars = (len < 0) ? 0 : std::min((size_t)len, sizeof(buffer) - 1);
+			for (size_t i = 0; i < num_chars; ++i)
+				str[i] = (cell)(unsigned char)buffer[i];
+			if (spec.zero_pad && !spec.left_align && num_chars != 0)
+			{
+				const size_t sign = (str[0] == '-') ? 1 : 0;
+				out.Write(str, sign);
+				Pad(out, spec, num_chars, '0');
+				out.Write(&str[sign], num_chars - sign);
+				return;
+			}
+			WriteAligned(out, spec, str, num_chars);
+		}
+
+		bool WriteString(Output &out, const Spec &spec, const cell *str)
+		{
+			const size_t max_len = (spec.precision < 0) ? (size_t)-1 : (size_t)spec.precision;
+			if ((ucell)str[0] <= UNPACKEDMAX)
+			{
+				// Unpacked strings are copied straight from the script's memory.
+				size_t len = 0;
+				while (len < max_len && str[len] != 0)
+					++len;
+				WriteAligned(out, spec, str, len);
+				return true;
+			}
+			int packed_len;
+			if (amx_StrLen(str, &packed_len) != AMX_ERR_NONE)
+				return false;
+			const size_t len = std::min((size_t)packed_len, max_len);
+			if (!spec.left_align)
+				Pad(out, spec, len, ' ');
+			for (size_t i = 0; i < len; ++i)
+				out.Put((cell)*pluginutils::GetPackedArrayCharAddr(const_cast<cell *>(str), (cell)i));
+			if (spec.left_align)
+				Pad(out, spec, len, ' ');
+			return true;
+		}
+
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		caches.erase(amx);
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_Format(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_dest,
+		arg_size,
+		arg_format,
+		arg_first_vararg,
+		num_args_expected = arg_format
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell size = params[arg_size];
+	if (size <= 0)
+		return 0;
+	int error;
+	cell *dest = pluginutils::GetArrayAddr(amx, params[arg_dest], (size_t)size, error);
+	if (dest == NULL)
+		return amx_RaiseError(amx, error), 0;
+	const cellformat::CompiledFormat *format =
+		cellformat::GetCompiledFormat(amx, params[arg_format], error);
+	if (format == NULL)
+		return amx_RaiseError(amx, error), 0;
+	if ((size_t)(params[0] / (cell)sizeof(cell)) < (size_t)arg_format + format->num_args)
+		return amx_RaiseError(amx, AMX_ERR_PARAMS), 0;
+	const bool overlap = cellformat::ArgsOverlap(amx, params, arg_first_vararg, *format, dest, (size_t)size, error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	if (overlap)
+		cellformat::scratch.resize((size_t)size);
+
+	cellformat::Output out(overlap ? &cellformat::scratch[0] : dest, (size_t)size - 1);
+	int arg = arg_first_vararg;
+	for (size_t i = 0; i < format->specs.size(); ++i)
+	{
+		const cellformat::Spec &spec = format->specs[i];
+		if (spec.conversion == 0)
+		{
+			out.Write(&format->literals[spec.literal_start], spec.literal_len);
+			continue;
+		}
+		// Variadic arguments are passed by reference.
+		cell *value;
+		if ((error = amx_GetAddr(amx, params[arg++], &value)) != AMX_ERR_NONE)
+			return amx_RaiseError(amx, error), 0;
+		switch (spec.conversion)
+		{
+		case 'd': case 'i': case 'x': case 'X':
+			cellformat::WriteInteger(out, spec, *value);
+			break;
+		case 'c':
+			cellformat::WriteAligned(out, spec, value, 1);
+			break;
+		case 'f':
+			cellformat::WriteFloat(out, spec, *value);
+			break;
+		case 's':
+			if (!cellformat::WriteString(out, spec, value))
+				return amx_RaiseError(amx, AMX_ERR_NATIVE), 0;
+			break;
+		}
+	}
+	const size_t len = out.Finish();
+	if (overlap)
+		std::copy(&cellformat::scratch[0], &cellformat::scratch[len + 1], dest);
+	return (cell)len;
+}
@@ -0,0 +1,25 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _CELLFORMAT_H
+#define _CELLFORMAT_H
+
+#include "SDK/amx/amx.h"
+
+
+namespace cellformat
+{
+
+	/*
+		Drops the compiled format strings of a script.
+	*/
+	void AmxUnload(AMX *amx);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_Format(AMX *amx, cell *params);
+
+
+#endif // _CELLFORMAT_H
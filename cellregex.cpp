@@ -0,0 +1,1071 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "cellregex.h"
+#include "cellstring.h"
+#include "pluginutils.h"
+
+
+namespace cellregex
+{
+
+	namespace
+	{
+
+		enum Flags
+		{
+			FLAG_IGNORECASE = 1
+		};
+
+		// Limits that keep pathological patterns from eating all the memory.
+		const size_t MAX_PROGRAM_SIZE = 10000;
+		const int MAX_REPEAT = 1000;
+		const int MAX_NESTING = 256; // Depth of groups and repeats, as the parser and compiler recurse.
+		const size_t MAX_DFA_STATES = 2048;
+
+		// Number of characters that get a transition table entry in DFA states,
+		// the rest are computed on every use.
+		const size_t DFA_ALPHABET_SIZE = 256;
+
+		FORCE_INLINE cell FoldCase(cell c)
+		{
+			return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+		}
+
+		FORCE_INLINE cell UpperCase(cell c)
+		{
+			return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+		}
+
+		struct CharClass
+		{
+			std::vector<std::pair<cell, cell> > ranges;
+			bool negated;
+
+			bool Contains(cell c) const
+			{
+				bool found = false;
+				for (size_t i = 0; i < ranges.size() && !found; ++i)
+					found = (c >= ranges[i].first && c <= ranges[i].second);
+				return found != negated;
+			}
+		};
+
+		enum NodeType
+		{
+			NODE_EMPTY,
+			NODE_CHAR,
+			NODE_ANY,
+			NODE_CLASS,
+			NODE_BOL,
+			NODE_EOL,
+			NODE_CONCAT,
+			NODE_ALTERNATE,
+			NODE_REPEAT,
+			NODE_GROUP
+		};
+
+		struct Node
+		{
+			NodeType type;
+			cell c;           // NODE_CHAR
+			int index;        // NODE_CLASS: class, NODE_GROUP: group number or -1
+			int min, max;     // NODE_REPEAT, max is -1 if unbounded
+			bool greedy;
+			int height;       // Of the subtree, at most MAX_NESTING.
+			std::vector<int> children;
+		};
+
+		enum OpCode
+		{
+			OP_CHAR,
+			OP_ANY,
+			OP_CLASS,
+			OP_SPLIT,  // Try x first, then y.
+			OP_JMP,
+			OP_SAVE,
+			OP_BOL,
+			OP_EOL,
+			OP_MATCH
+		};
+
+		struct Inst
+		{
+			OpCode op;
+			cell c;
+			int x, y;
+		};
+
+		class Parser
+		{
+		public:
+			Parser(const cell *pattern, size_t len, bool ignorecase,
+					std::vector<Node> &nodes, std::vector<CharClass> &classes)
+				: p(pattern), end(pattern + len), ignorecase(ignorecase),
+					nodes(nodes), classes(classes), num_groups(0), depth(0), ok(true)
+			{
+			}
+
+			bool Parse(int &root)
+			{
+				root = ParseAlternation();
+				return ok && p == end;
+			}
+
+			int GetNumGroups() const { return num_groups; }
+
+		private:
+			int NewNode(NodeType type)
+			{
+				Node node;
+				node.type = type;
+				node.c = 0;
+				node.index = -1;
+				node.min = node.max = 0;
+				node.greedy = true;
+				node.height = 1;
+				nodes.push_back(node);
+				return (int)nodes.size() - 1;
+			}
+
+			void AddChild(int parent, int child)
+			{
+				nodes[parent].children.push_back(child);
+				if (nodes[parent].height <= nodes[child].height)
+					nodes[parent].height = nodes[child].height + 1;
+				if (nodes[parent].height > MAX_NESTING)
+					Fail();
+			}
+
+			int ParseAlternation()
+			{
+				int node = ParseConcatenation();
+				if (p == end || *p != '|')
+					return node;
+				const int alt = NewNode(NODE_ALTERNATE);
+				AddChild(alt, node);
+				while (ok && p != end && *p == '|')
+				{
+					++p;
+					node = ParseConcatenation();
+					AddChild(alt, node);
+				}
+				return alt;
+			}
+
+			int ParseConcatenation()
+			{
+				const int concat = NewNode(NODE_CONCAT);
+				while (ok && p != end && *p != '|' && *p != ')')
+				{
+					const int node = ParseRepeat();
+					AddChild(concat, node);
+				}
+				return concat;
+			}
+
+			bool ParseNumber(int &value)
+			{
+				if (p == end || *p < '0' || *p > '9')
+					return false;
+				value = 0;
+				for (; p != end && *p >= '0' && *p <= '9'; ++p)
+				{
+					value = value * 10 + (int)(*p - '0');
+					if (value > MAX_REPEAT)
+						return false;
+				}
+				return true;
+			}
+
+			int ParseRepeat()
+			{
+				int node = ParseAtom();
+				while (ok && p != end)
+				{
+					int min, max;
+					switch (*p)
+					{
+					case '*': min = 0; max = -1; ++p; break;
+					case '+': min = 1; max = -1; ++p; break;
+					case '?': min = 0; max = 1; ++p; break;
+					case '{':
+						++p;
+						if (!ParseNumber(min))
+							return Fail();
+						max = min;
+						if (p != end && *p == ',')
+						{
+							++p;
+							max = -1;
+							if (p != end && *p != '}' && (!ParseNumber(max) || max < min))
+								return Fail();
+						}
+						if (p == end || *p != '}')
+							return Fail();
+						++p;
+						break;
+					default:
+						return node;
+					}
+					const int repeat = NewNode(NODE_REPEAT);
+					nodes[repeat].min = min;
+					nodes[repeat].max = max;
+					if (p != end && *p == '?')
+					{
+						nodes[repeat].greedy = false;
+						++p;
+					}
+					AddChild(repeat, node);
+					node = repeat;
+				}
+				return node;
+			}
+
+			int ParseAtom()
+			{
+				const cell c = *p++;
+				switch (c)
+				{
+				case '(':
+				{
+					if (++depth > MAX_NESTING)
+						return Fail();
+					const int group = NewNode(NODE_GROUP);
+					if (end - p >= 2 && p[0] == '?' && p[1] == ':')
+						p += 2;
+					else
+						nodes[group].index = ++num_groups;
+					const int node = ParseAlternation();
+					AddChild(group, node);
+					if (p == end || *p != ')')
+						return Fail();
+					++p;
+					--depth;
+					return group;
+				}
+				case '.':
+					return NewNode(NODE_ANY);
+				case '^':
+					return NewNode(NODE_BOL);
+				case '$':
+					return NewNode(NODE_EOL);
+				case '[':
+					return ParseClass();
+				case '\\':
+					return ParseEscape();
+				case '*': case '+': case '?': case '{': case ')':
+					return Fail();
+				default:
+					return NewChar(c);
+				}
+			}
+
+			int NewChar(cell c)
+			{
+				const int node = NewNode(NODE_CHAR);
+				nodes[node].c = ignorecase ? FoldCase(c) : c;
+				return node;
+			}
+
+			/*
+				Adds the ranges of \d, \w or \s (or their negation) to a class.
+				Returns false if 'c' isn't one of those.
+			*/
+			static bool AddShorthandClass(cell c, CharClass &cls)
+			{
+				switch (c)
+				{
+				case 'd': case 'D':
+					cls.ranges.push_back(std::make_pair((cell)'0', (cell)'9'));
+					break;
+				case 'w': case 'W':
+					cls.ranges.push_back(std::make_pair((cell)'0', (cell)'9'));
+					cls.ranges.push_back(std::make_pair((cell)'A', (cell)'Z'));
+					cls.ranges.push_back(std::make_pair((cell)'_', (cell)'_'));
+					cls.ranges.push_back(std::make_pair((cell)'a', (cell)'z'));
+					break;
+				case 's': case 'S':
+					cls.ranges.push_back(std::make_pair((cell)'\t', (cell)'\r'));
+					cls.ranges.push_back(std::make_pair((cell)' ', (cell)' '));
+					break;
+				default:
+					return false;
+				}
+				return true;
+			}
+
+			static cell GetEscapedChar(cell c)
+			{
+				switch (c)
+				{
+				case 'n': return '\n';
+				case 'r': return '\r';
+				case 't': return '\t';
+				default: return c;
+				}
+			}
+
+			int ParseEscape()
+			{
+				if (p == end)
+					return Fail();
+				const cell c = *p++;
+				CharClass cls;
+				cls.negated = (c == 'D' || c == 'W' || c == 'S');
+				if (!AddShorthandClass(c, cls))
+					return NewChar(GetEscapedChar(c));
+				classes.push_back(cls);
+				const int node = NewNode(NODE_CLASS);
+				nodes[node].index = (int)classes.size() - 1;
+				return node;
+			}
+
+			int ParseClass()
+			{
+				CharClass cls;
+				cls.negated = (p != end && *p == '^');
+				if (cls.negated)
+					++p;
+				bool first = true;
+				while (p != end && (*p != ']' || first))
+				{
+					first = false;
+					cell lo = *p++;
+					if (lo == '\\')
+					{
+						if (p == end)
+							return Fail();
+						lo = *p++;
+						CharClass shorthand;
+						shorthand.negated = false;
+						if (lo != 'D' && lo != 'W' && lo != 'S' && AddShorthandClass(lo, shorthand))
+						{
+							cls.ranges.insert(cls.ranges.end(), shorthand.ranges.begin(), shorthand.ranges.end());
+							continue;
+						}
+						lo = GetEscapedChar(lo);
+					}
+					cell hi = lo;
+					if (end - p >= 2 && p[0] == '-' && p[1] != ']')
+					{
+						++p;
+						hi = *p++;
+						if (hi == '\\')
+						{
+							if (p == end)
+								return Fail();
+							hi = GetEscapedChar(*p++);
+						}
+						if (hi < lo)
+							return Fail();
+					}
+					cls.ranges.push_back(std::make_pair(lo, hi));
+				}
+				if (p == end)
+					return Fail();
+				++p;
+				classes.push_back(cls);
+				const int node = NewNode(NODE_CLASS);
+				nodes[node].index = (int)classes.size() - 1;
+				return node;
+			}
+
+			int Fail()
+			{
+				ok = false;
+				p = end;
+				return NewNode(NODE_EMPTY);
+			}
+
+			const cell *p;
+			const cell *end;
+			bool ignorecase;
+			std::vector<Node> &nodes;
+			std::vector<CharClass> &classes;
+			int num_groups;
+			int depth; // Of the groups being parsed.
+			bool ok;
+		};
+
+		class Compiler
+		{
+		public:
+			Compiler(const std::vector<Node> &nodes, std::vector<Inst> &program)
+				: nodes(nodes), program(program)
+			{
+			}
+
+			bool Compile(int root)
+			{
+				Emit(OP_SAVE, 0, 0);
+				if (!CompileNode(root))
+					return false;
+				Emit(OP_SAVE, 0, 1);
+				Emit(OP_MATCH);
+				return program.size() <= MAX_PROGRAM_SIZE;
+			}
+
+		private:
+			int Emit(OpCode op, cell c = 0, int x = 0, int y = 0)
+			{
+				const Inst inst = { op, c, x, y };
+				program.push_back(inst);
+				return (int)program.size() - 1;
+			}
+
+			int Here() const
+			{
+				return (int)program.size();
+			}
+
+			bool CompileNode(int index)
+			{
+				if (program.size() > MAX_PROGRAM_SIZE)
+					return false;
+				const Node &node = nodes[index];
+				switch (node.type)
+				{
+				case NODE_EMPTY:
+					break;
+				case NODE_CHAR:
+					Emit(OP_CHAR, node.c);
+					break;
+				case NODE_ANY:
+					Emit(OP_ANY);
+					break;
+				case NODE_CLASS:
+					Emit(OP_CLASS, 0, node.index);
+					break;
+				case NODE_BOL:
+					Emit(OP_BOL);
+					break;
+				case NODE_EOL:
+					Emit(OP_EOL);
+					break;
+				case NODE_CONCAT:
+					for (size_t i = 0; i < node.children.size(); ++i)
+					{
+						if (!CompileNode(node.children[i]))
+							return false;
+					}
+					break;
+				case NODE_ALTERNATE:
+				{
+					std::vector<int> jumps;
+					for (size_t i = 0; i < node.children.size(); ++i)
+					{
+						int split = -1;
+						if (i + 1 < node.children.size())
+							split = Emit(OP_SPLIT);
+						if (!CompileNode(node.children[i]))
+							return false;
+						if (split != -1)
+						{
+							jumps.push_back(Emit(OP_JMP));
+							program[split].x = split + 1;
+							program[split].y = Here();
+						}
+					}
+					for (size_t i = 0; i < jumps.size(); ++i)
+						program[jumps[i]].x = Here();
+					break;
+				}
+				case NODE_GROUP:
+					if (node.index != -1)
+						Emit(OP_SAVE, 0, node.index * 2);
+					if (!CompileNode(node.children[0]))
+						return false;
+					if (node.index != -1)
+						Emit(OP_SAVE, 0, node.index * 2 + 1);
+					break;
+				case NODE_REPEAT:
+					return CompileRepeat(node);
+				}
+				return true;
+			}
+
+			void SetSplit(int split, int body, int exit, bool greedy)
+			{
+				program[split].x = greedy ? body : exit;
+				program[split].y = greedy ? exit : body;
+			}
+
+			bool CompileRepeat(const Node &node)
+			{
+				const int child = node.children[0];
+				for (int i = 0; i < node.min; ++i)
+				{
+					if (!CompileNode(child))
+						return false;
+				}
+				if (node.max == -1)
+				{
+					const int split = Emit(OP_SPLIT);
+					if (!CompileNode(child))
+						return false;
+					Emit(OP_JMP, 0, split);
+					SetSplit(split, split + 1, Here(), node.greedy);
+					return true;
+				}
+				std::vector<int> splits;
+				for (int i = node.min; i < node.max; ++i)
+				{
+					splits.push_back(Emit(OP_SPLIT));
+					if (!CompileNode(child))
+						return false;
+				}
+				for (size_t i = 0; i < splits.size(); ++i)
+					SetSplit(splits[i], splits[i] + 1, Here(), node.greedy);
+				return true;
+			}
+
+			const std::vector<Node> &nodes;
+			std::vector<Inst> &program;
+		};
+
+		struct Regex;
+
+		/*
+			A DFA built lazily from the program, one state (a set of instructions)
+			at a time. The states are thrown away when there are too many of them.
+		*/
+		class Dfa
+		{
+		public:
+			enum
+			{
+				DEAD_STATE = 0,
+				UNKNOWN_STATE = -1
+			};
+
+			Dfa(const Regex &regex, bool unanchored) : regex(regex), unanchored(unanchored)
+			{
+				Reset();
+			}
+
+			int GetStartState(bool at_start)
+			{
+				int &state = start_states[at_start ? 1 : 0];
+				if (state == UNKNOWN_STATE)
+				{
+					std::vector<int> insts;
+					AddClosure(std::vector<int>(1, 0), at_start, false, insts);
+					state = AddState(insts, at_start);
+				}
+				return state;
+			}
+
+			FORCE_INLINE int Next(int state, cell c)
+			{
+				if ((ucell)c < DFA_ALPHABET_SIZE)
+				{
+					const int next = states[state].next[c];
+					if (next != UNKNOWN_STATE)
+						return next;
+				}
+				return ComputeNext(state, c);
+			}
+
+			bool IsMatch(int state) const { return states[state].match; }
+			bool IsMatchAtEnd(int state) const { return states[state].match_at_end; }
+
+		private:
+			struct State
+			{
+				std::vector<int> insts;
+				bool match;
+				bool match_at_end;
+				std::vector<int> next;
+			};
+
+			void Reset()
+			{
+				states.clear();
+				state_ids.clear();
+				start_states[0] = start_states[1] = UNKNOWN_STATE;
+				AddState(std::vector<int>(), false);
+			}
+
+			void AddClosure(const std::vector<int> &roots, bool at_start, bool at_end,
+				std::vector<int> &insts) const;
+			bool Matches(const Inst &inst, cell c) const;
+
+			int AddState(const std::vector<int> &insts, bool at_start)
+			{
+				std::map<std::vector<int>, int>::const_iterator it = state_ids.find(insts);
+				if (it != state_ids.end())
+					return it->second;
+				State state;
+				state.insts = insts;
+				state.match = false;
+				state.match_at_end = false;
+				state.next.assign(DFA_ALPHABET_SIZE, UNKNOWN_STATE);
+				CheckMatch(state, at_start);
+				states.push_back(state);
+				const int id = (int)states.size() - 1;
+				state_ids[insts] = id;
+				return id;
+			}
+
+			void CheckMatch(State &state, bool at_start) const;
+
+			int ComputeNext(int state, cell c)
+			{
+				std::vector<int> roots, insts;
+				const std::vector<int> &current = states[state].insts;
+				for (size_t i = 0; i < current.size(); ++i)
+				{
+					if (Matches(GetInst(current[i]), c))
+						roots.push_back(current[i] + 1);
+				}
+				if (unanchored)
+					roots.push_back(0);
+				AddClosure(roots, false, false, insts);
+				if (states.size() >= MAX_DFA_STATES)
+				{
+					// The caller only keeps the returned state, so it's safe to start over.
+					Reset();
+					return AddState(insts, false);
+				}
+				const int next = AddState(insts, false);
+				if ((ucell)c < DFA_ALPHABET_SIZE)
+					states[state].next[c] = next;
+				return next;
+			}
+
+			const Inst &GetInst(int pc) const;
+
+			const Regex &regex;
+			bool unanchored;
+			std::vector<State> states;
+			std::map<std::vector<int>, int> state_ids;
+			int start_states[2];
+		};
+
+		struct Regex
+		{
+			std::vector<Inst> program;
+			std::vector<CharClass> classes;
+			int num_groups;
+			bool ignorecase;
+			std::unique_ptr<Dfa> match_dfa;   // Anchored at both ends
+			std::unique_ptr<Dfa> search_dfa;  // Matches anywhere
+
+			FORCE_INLINE bool Matches(const Inst &inst, cell c) const
+			{
+				switch (inst.op)
+				{
+				case OP_CHAR:
+					return inst.c == c;
+				case OP_ANY:
+					return c != '\n';
+				case OP_CLASS:
+					return classes[inst.x].Contains(c) || (ignorecase && classes[inst.x].Contains(UpperCase(c)));
+				default:
+					return false;
+				}
+			}
+		};
+
+		/*
+			Adds the instructions reachable from 'roots' without consuming
+			a character. '^' and '$' are only passed at the start or the end.
+		*/
+		void Dfa::AddClosure(const std::vector<int> &roots, bool at_start, bool at_end,
+			std::vector<int> &insts) const
+		{
+			std::vector<bool> visited(regex.program.size(), false);
+			std::vector<int> stack(roots.rbegin(), roots.rend());
+			while (!stack.empty())
+			{
+				const int pc = stack.back();
+				stack.pop_back();
+				if (visited[pc])
+					continue;
+				visited[pc] = true;
+				const Inst &inst = regex.program[pc];
+				switch (inst.op)
+				{
+				case OP_JMP:
+					stack.push_back(inst.x);
+					break;
+				case OP_SPLIT:
+					stack.push_back(inst.y);
+					stack.push_back(inst.x);
+					break;
+				case OP_SAVE:
+					stack.push_back(pc + 1);
+					break;
+				case OP_BOL:
+					if (at_start)
+						stack.push_back(pc + 1);
+					break;
+				case OP_EOL:
+					// Kept in the set until it's known whether the input ends here.
+					if (at_end)
+						stack.push_back(pc + 1);
+					else
+						insts.push_back(pc);
+					break;
+				default:
+					insts.push_back(pc);
+					break;
+				}
+			}
+			std::sort(insts.begin(), insts.end());
+		}
+
+		void Dfa::CheckMatch(State &state, bool at_start) const
+		{
+			std::vector<int> roots;
+			for (size_t i = 0; i < state.insts.size(); ++i)
+			{
+				const Inst &inst = regex.program[state.insts[i]];
+				if (inst.op == OP_MATCH)
+					state.match = state.match_at_end = true;
+				else if (inst.op == OP_EOL)
+					roots.push_back(state.insts[i] + 1);
+			}
+			if (state.match_at_end || roots.empty())
+				return;
+			std::vector<int> at_end;
+			AddClosure(roots, at_start, true, at_end);
+			for (size_t i = 0; i < at_end.size() && !state.match_at_end; ++i)
+				state.match_at_end = (regex.program[at_end[i]].op == OP_MATCH);
+		}
+
+		bool Dfa::Matches(const Inst &inst, cell c) const
+		{
+			return regex.Matches(inst, c);
+		}
+
+		const Inst &Dfa::GetInst(int pc) const
+		{
+			return regex.program[pc];
+		}
+
+		/*
+			NFA simulation that tracks capture positions (Pike VM).
+			Threads are kept in priority order, so the leftmost match is the one
+			a backtracking engine would have found.
+		*/
+		class PikeVm
+		{
+		public:
+			PikeVm(const Regex &regex, const cell *str, size_t len)
+				: regex(regex), str(str), len(len), num_slots((size_t)(regex.num_groups + 1) * 2)
+			{
+			}
+
+			bool Search(size_t start, std::vector<cell> &captures)
+			{
+				const size_t num_insts = regex.program.size();
+				std::vector<Thread> current, next;
+				std::vector<size_t> on_list(num_insts, 0);
+				std::vector<cell> slots(num_slots, -1);
+				bool matched = false;
+				for (size_t pos = start; ; ++pos)
+				{
+					if (!matched)
+						AddThread(current, on_list, pos + 1, 0, pos, slots);
+					if (current.empty())
+						break;
+					const cell c = (pos < len) ? FoldIfNeeded(str[pos]) : 0;
+					for (size_t i = 0; i < current.size(); ++i)
+					{
+						Thread &thread = current[i];
+						const Inst &inst = regex.program[thread.pc];
+						if (inst.op == OP_MATCH)
+						{
+							captures.swap(thread.slots);
+							matched = true;
+							// Lower priority threads can't win anymore.
+							break;
+						}
+						if (pos < len && regex.Matches(inst, c))
+							AddThread(next, on_list, pos + 2, thread.pc + 1, pos + 1, thread.slots);
+					}
+					if (pos >= len)
+						break;
+					current.swap(next);
+					next.clear();
+				}
+				return matched;
+			}
+
+		private:
+			struct Thread
+			{
+				int pc;
+				std::vector<cell> slots;
+			};
+
+			FORCE_INLINE cell FoldIfNeeded(cell c) const
+			{
+				return regex.ignorecase ? FoldCase(c) : c;
+			}
+
+			/*
+				Follows the empty transitions from 'pc' and adds the threads
+				that wait for a character (or a match) to the list.
+				'generation' (the position plus one) makes sure every instruction
+				is added once per position.
+			*/
+			void AddThread(std::vector<Thread> &list, std::vector<size_t> &on_list, size_t generation,
+				int pc, size_t pos, const std::vector<cell> &slots)
+			{
+				if (on_list[pc] == generation)
+					return;
+				on_list[pc] = generation;
+				const Inst &inst = regex.program[pc];
+				switch (inst.op)
+				{
+				case OP_JMP:
+					AddThread(list, on_list, generation, inst.x, pos, slots);
+					break;
+				case OP_SPLIT:
+					AddThread(list, on_list, generation, inst.x, pos, slots);
+					AddThread(list, on_list, generation, inst.y, pos, slots);
+					break;
+				case OP_SAVE:
+				{
+					std::vector<cell> new_slots(slots);
+					if ((size_t)inst.x < num_slots)
+						new_slots[inst.x] = (cell)pos;
+					AddThread(list, on_list, generation, pc + 1, pos, new_slots);
+					break;
+				}
+				case OP_BOL:
+					if (pos == 0)
+						AddThread(list, on_list, generation, pc + 1, pos, slots);
+					break;
+				case OP_EOL:
+					if (pos == len)
+						AddThread(list, on_list, generation, pc + 1, pos, slots);
+					break;
+				default:
+					Thread thread;
+					thread.pc = pc;
+					thread.slots = slots;
+					list.push_back(thread);
+					break;
+				}
+			}
+
+			const Regex &regex;
+			const cell *str;
+			size_t len;
+			size_t num_slots;
+		};
+
+		std::vector<std::unique_ptr<Regex> > regexes;
+		std::unordered_map<std::string, cell> regexes_by_pattern;
+
+		Regex *Compile(const cell *pattern, size_t len, bool ignorecase)
+		{
+			std::unique_ptr<Regex> regex(new Regex);
+			std::vector<Node> nodes;
+			Parser parser(pattern, len, ignorecase, nodes, regex->classes);
+			int root;
+			if (!parser.Parse(root))
+				return NULL;
+			Compiler compiler(nodes, regex->program);
+			if (!compiler.Compile(root))
+				return NULL;
+			regex->num_groups = parser.GetNumGroups();
+			regex->ignorecase = ignorecase;
+			regex->match_dfa.reset(new Dfa(*regex, false));
+			regex->search_dfa.reset(new Dfa(*regex, true));
+			return regex.release();
+		}
+
+		Regex *GetRegex(cell handle)
+		{
+			if (handle <= 0 || (size_t)handle > regexes.size())
+				return NULL;
+			return regexes[handle - 1].get();
+		}
+
+		bool FullMatch(Regex &regex, const cell *str, size_t len)
+		{
+			Dfa &dfa = *regex.match_dfa;
+			int state = dfa.GetStartState(true);
+			for (size_t i = 0; i < len && state != Dfa::DEAD_STATE; ++i)
+				state = dfa.Next(state, regex.ignorecase ? FoldCase(str[i]) : str[i]);
+			return dfa.IsMatchAtEnd(state);
+		}
+
+		bool ContainsMatch(Regex &regex, const cell *str, size_t len, size_t start)
+		{
+			Dfa &dfa = *regex.search_dfa;
+			int state = dfa.GetStartState(start == 0);
+			for (size_t i = start; i < len; ++i)
+			{
+				if (dfa.IsMatch(state))
+					return true;
+				state = dfa.Next(state, regex.ignorecase ? FoldCase(str[i]) : str[i]);
+			}
+			return dfa.IsMatchAtEnd(state);
+		}
+
+		std::string GetCacheKey(const cellstring::StringArg &pattern, cell flags)
+		{
+			std::string key;
+			key.reserve(pattern.len * sizeof(cell) + sizeof(cell));
+			key.append((const char *)(const void *)&flags, sizeof(flags));
+			key.append((const char *)(const void *)pattern.str, pattern.len * sizeof(cell));
+			return key;
+		}
+
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_RegexCompile(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_pattern,
+		arg_flags,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	cellstring::StringArg pattern;
+	if (!cellstring::GetStringArg(amx, params[arg_pattern], pattern, error))
+		return amx_RaiseError(amx, error), 0;
+	const cell flags = params[arg_flags];
+	const std::string key = cellregex::GetCacheKey(pattern, flags);
+	std::unordered_map<std::string, cell>::const_iterator it = cellregex::regexes_by_pattern.find(key);
+	if (it != cellregex::regexes_by_pattern.end())
+		return it->second;
+	cellregex::Regex *regex = cellregex::Compile(pattern.str, pattern.len,
+		(flags & cellregex::FLAG_IGNORECASE) != 0);
+	if (regex == NULL)
+		return 0;
+	cellregex::regexes.push_back(std::unique_ptr<cellregex::Regex>(regex));
+	const cell handle = (cell)cellregex::regexes.size();
+	cellregex::regexes_by_pattern[key] = handle;
+	return handle;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_RegexGroups(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_regex,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	const cellregex::Regex *regex = cellregex::GetRegex(params[arg_regex]);
+	return (regex != NULL) ? (cell)regex->num_groups : -1;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_RegexMatch(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_regex,
+		arg_string,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	cellregex::Regex *regex = cellregex::GetRegex(params[arg_regex]);
+	if (regex == NULL)
+		return 0;
+	int error;
+	cellstring::StringArg str;
+	if (!cellstring::GetStringArg(amx, params[arg_string], str, error))
+		return amx_RaiseError(amx, error), 0;
+	return cellregex::FullMatch(*regex, str.str, str.len) ? 1 : 0;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_RegexSearch(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_regex,
+		arg_string,
+		arg_captures,
+		arg_size,
+		arg_offset,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	cellregex::Regex *regex = cellregex::GetRegex(params[arg_regex]);
+	if (regex == NULL)
+		return -1;
+	int error;
+	cellstring::StringArg str;
+	if (!cellstring::GetStringArg(amx, params[arg_string], str, error))
+		return amx_RaiseError(amx, error), -1;
+	const cell offset = params[arg_offset];
+	if (offset < 0 || (size_t)offset > str.len)
+		return -1;
+
+	// Most strings don't match at all, and the DFA can tell that much faster.
+	if (!cellregex::ContainsMatch(*regex, str.str, str.len, (size_t)offset))
+		return -1;
+	std::vector<cell> captures;
+	cellregex::PikeVm vm(*regex, str.str, str.len);
+	if (!vm.Search((size_t)offset, captures))
+		return -1;
+
+	const cell size = params[arg_size];
+	if (size > 0)
+	{
+		const size_t num_slots = std::min((size_t)size, captures.size());
+		if (!pluginutils::SetArray(amx, params[arg_captures], &captures[0], num_slots, error))
+			return amx_RaiseError(amx, error), -1;
+	}
+	return captures[0];
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_RegexMatchAny(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_string,
+		arg_regexes,
+		arg_count,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	const cell count = params[arg_count];
+	if (count <= 0)
+		return -1;
+	int error;
+	const pluginutils::ArrayView<const cell> handles(amx, params[arg_regexes], (size_t)count);
+	if (!handles.IsValid())
+		return amx_RaiseError(amx, handles.GetError()), -1;
+	cellstring::StringArg str;
+	if (!cellstring::GetStringArg(amx, params[arg_string], str, error))
+		return amx_RaiseError(amx, error), -1;
+	for (size_t i = 0; i < handles.GetSize(); ++i)
+	{
+		cellregex::Regex *regex = cellregex::GetRegex(handles[i]);
+		if (regex != NULL && cellregex::ContainsMatch(*regex, str.str, str.len, 0))
+			return (cell)i;
+	}
+	return -1;
+}
@@ -0,0 +1,27 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _CELLREGEX_H
+#define _CELLREGEX_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Regular expression natives. Patterns are compiled once and shared by
+	all scripts. Matching runs on a lazily built DFA; capture groups are
+	only resolved (with a slower backtrack-free NFA simulation) when asked for.
+
+	Syntax: literals, '.', [classes] with ranges and negation, \d \w \s (and
+	\D \W \S), '^', '$', groups (capturing and '(?:...)'), '|', and the
+	quantifiers '*', '+', '?' and '{n}', '{n,}', '{n,m}' (all may be lazy).
+*/
+cell AMX_NATIVE_CALL n_HelloWorld_RegexCompile(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_RegexGroups(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_RegexMatch(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_RegexSearch(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_RegexMatchAny(AMX *amx, cell *params);
+
+
+#endif // _CELLREGEX_H
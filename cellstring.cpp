@@ -0,0 +1,306 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <cstring>
+#include <vector>
+#include "cellstring.h"
+#include "pluginutils.h"
+
+#ifdef USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+namespace cellstring
+{
+
+	namespace
+	{
+
+		FORCE_INLINE cell FoldCase(cell c)
+		{
+			return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+		}
+
+#ifdef USE_SSE2
+		FORCE_INLINE __m128i FoldCase(__m128i v)
+		{
+			const __m128i is_upper = _mm_and_si128(
+				_mm_cmpgt_epi32(v, _mm_set1_epi32('A' - 1)),
+				_mm_cmplt_epi32(v, _mm_set1_epi32('Z' + 1)));
+			return _mm_add_epi32(v, _mm_and_si128(is_upper, _mm_set1_epi32('a' - 'A')));
+		}
+#endif
+
+		/*
+			Returns the index of the first mismatching character
+			within the first 'len' characters, or 'len' if there's none.
+		*/
+		template <bool ignorecase>
+		size_t Mismatch(const cell str1[], const cell str2[], size_t len)
+		{
+			size_t i = 0;
+#ifdef USE_SSE2
+			for (; i + 4 <= len; i += 4)
+			{
+				__m128i v1 = _mm_loadu_si128((const __m128i *)(const void *)&str1[i]);
+				__m128i v2 = _mm_loadu_si128((const __m128i *)(const void *)&str2[i]);
+				if (ignorecase)
+					v1 = FoldCase(v1), v2 = FoldCase(v2);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(v1, v2)) != 0xFFFF)
+					break;
+			}
+#endif
+			for (; i < len; ++i)
+			{
+				if (ignorecase ? (FoldCase(str1[i]) != FoldCase(str2[i])) : (str1[i] != str2[i]))
+					break;
+			}
+			return i;
+		}
+
+		template <bool ignorecase>
+		cell FindImpl(const cell str[], size_t len, const cell sub[], size_t sub_len, size_t pos)
+		{
+			const size_t last = len - sub_len;
+			const cell first = ignorecase ? FoldCase(sub[0]) : sub[0];
+			size_t i = pos;
+#ifdef USE_SSE2
+			// Look for the first character of the substring in 4 positions at once,
+			// then verify the candidates.
+			const __m128i needle = _mm_set1_epi32((int)first);
+			for (; i + 4 <= last + 1; i += 4)
+			{
+				__m128i v = _mm_loadu_si128((const __m128i *)(const void *)&str[i]);
+				if (ignorecase)
+					v = FoldCase(v);
+				int mask = _mm_movemask_epi8(_mm_cmpeq_epi32(v, needle));
+				for (size_t lane = 0; mask != 0; ++lane, mask >>= 4)
+				{
+					if ((mask & 0xF) == 0)
+						continue;
+					if (Mismatch<ignorecase>(&str[i + lane + 1], &sub[1], sub_len - 1) == sub_len - 1)
+						return (cell)(i + lane);
+				}
+			}
+#endif
+			for (; i <= last; ++i)
+			{
+				if ((ignorecase ? FoldCase(str[i]) : str[i]) != first)
+					continue;
+				if (Mismatch<ignorecase>(&str[i + 1], &sub[1], sub_len - 1) == sub_len - 1)
+					return (cell)i;
+			}
+			return -1;
+		}
+
+	}
+
+	size_t Length(const cell str[])
+	{
+		const cell *ptr = str;
+#ifdef USE_SSE2
+		// Aligned loads never cross a page boundary, so it's safe to read
+		// a few cells past the terminating zero.
+		while (((size_t)ptr & 15) != 0)
+		{
+			if (*ptr == 0)
+				return (size_t)(ptr - str);
+			++ptr;
+		}
+		const __m128i zero = _mm_setzero_si128();
+		while (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_load_si128((const __m128i *)(const void *)ptr), zero)) == 0)
+			ptr += 4;
+#endif
+		while (*ptr != 0)
+			++ptr;
+		return (size_t)(ptr - str);
+	}
+
+	int Compare(const cell str1[], size_t len1, const cell str2[], size_t len2,
+		size_t max_len, bool ignorecase)
+	{
+		size_t len = (len1 < len2) ? len1 : len2;
+		if (len > max_len)
+			len = max_len;
+		const size_t i = ignorecase
+			? Mismatch<true>(str1, str2, len) : Mismatch<false>(str1, str2, len);
+		if (i < len)
+		{
+			const cell c1 = ignorecase ? FoldCase(str1[i]) : str1[i];
+			const cell c2 = ignorecase ? FoldCase(str2[i]) : str2[i];
+			return (c1 < c2) ? -1 : 1;
+		}
+		if (len == max_len || len1 == len2)
+			return 0;
+		return (len1 < len2) ? -1 : 1;
+	}
+
+	cell Find(const cell str[], size_t len, const cell sub[], size_t sub_len,
+		size_t pos, bool ignorecase)
+	{
+		if (sub_len == 0 || sub_len > len || pos > len - sub_len)
+			return -1;
+		return ignorecase
+			? FindImpl<true>(str, len, sub, sub_len, pos)
+			: FindImpl<false>(str, len, sub, sub_len, pos);
+	}
+
+	size_t FindChar(const cell str[], size_t len, size_t pos, cell delimiter)
+	{
+		size_t i = pos;
+#ifdef USE_SSE2
+		const __m128i needle = _mm_set1_epi32((int)delimiter);
+		for (; i + 4 <= len; i += 4)
+		{
+			const __m128i v = _mm_loadu_si128((const __m128i *)(const void *)&str[i]);
+			if (_mm_movemask_epi8(_mm_cmpeq_epi32(v, needle)) != 0)
+				break;
+		}
+#endif
+		for (; i < len; ++i)
+			if (str[i] == delimiter)
+				break;
+		return i;
+	}
+
+	bool GetStringArg(AMX *amx, cell address, StringArg &arg, int &error)
+	{
+		cell *cptr;
+		error = amx_GetAddr(amx, address, &cptr);
+		if (error != AMX_ERR_NONE)
+			return false;
+		if ((ucell)cptr[0] <= UNPACKEDMAX)
+		{
+			arg.str = cptr;
+			arg.len = Length(cptr);
+			return true;
+		}
+		// Packed strings are rare, so they're simply unpacked into a temporary buffer.
+		int len;
+		error = amx_StrLen(cptr, &len);
+		if (error != AMX_ERR_NONE)
+			return false;
+		arg.buffer.resize((size_t)len + 1);
+		for (int i = 0; i < len; ++i)
+			arg.buffer[i] = (cell)*pluginutils::GetPackedArrayCharAddr(cptr, (cell)i);
+		arg.buffer[len] = 0;
+		arg.str = &arg.buffer[0];
+		arg.len = (size_t)len;
+		return true;
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_StrCompare(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_string1,
+		arg_string2,
+		arg_ignorecase,
+		arg_length,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	cellstring::StringArg str1, str2;
+	if (!cellstring::GetStringArg(amx, params[arg_string1], str1, error) ||
+		!cellstring::GetStringArg(amx, params[arg_string2], str2, error))
+		return amx_RaiseError(amx, error), 0;
+	const size_t max_len = (params[arg_length] < 0) ? 0 : (size_t)params[arg_length];
+	return (cell)cellstring::Compare(
+		str1.str, str1.len, str2.str, str2.len, max_len, params[arg_ignorecase] != 0);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_StrEqual(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_string1,
+		arg_string2,
+		arg_ignorecase,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	cellstring::StringArg str1, str2;
+	if (!cellstring::GetStringArg(amx, params[arg_string1], str1, error) ||
+		!cellstring::GetStringArg(amx, params[arg_string2], str2, error))
+		return amx_RaiseError(amx, error), 0;
+	if (str1.len != str2.len)
+		return 0;
+	return (cellstring::Compare(str1.str, str1.len, str2.str, str2.len,
+		str1.len, params[arg_ignorecase] != 0) == 0) ? 1 : 0;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_StrFind(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_string,
+		arg_sub,
+		arg_ignorecase,
+		arg_pos,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	if (params[arg_pos] < 0)
+		return -1;
+	int error;
+	cellstring::StringArg str, sub;
+	if (!cellstring::GetStringArg(amx, params[arg_string], str, error) ||
+		!cellstring::GetStringArg(amx, params[arg_sub], sub, error))
+		return amx_RaiseError(amx, error), -1;
+	return cellstring::Find(str.str, str.len, sub.str, sub.len,
+		(size_t)params[arg_pos], params[arg_ignorecase] != 0);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_StrToken(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_string,
+		arg_index,
+		arg_dest,
+		arg_delimiter,
+		arg_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	cellstring::StringArg str;
+	cell *index_ptr, *dest;
+	if (!cellstring::GetStringArg(amx, params[arg_string], str, error))
+		return amx_RaiseError(amx, error), 0;
+	const cell size = params[arg_size];
+	if (size <= 0)
+		return 0;
+	if ((error = amx_GetAddr(amx, params[arg_index], &index_ptr)) != AMX_ERR_NONE ||
+		(dest = pluginutils::GetArrayAddr(amx, params[arg_dest], (size_t)size, error)) == NULL)
+		return amx_RaiseError(amx, error), 0;
+
+	const cell delimiter = params[arg_delimiter];
+	size_t begin = (*index_ptr < 0) ? 0 : (size_t)*index_ptr;
+	while (begin < str.len && str.str[begin] == delimiter)
+		++begin;
+	const size_t end = cellstring::FindChar(str.str, str.len, begin, delimiter);
+	size_t token_len = end - begin;
+	if (token_len > (size_t)size - 1)
+		token_len = (size_t)size - 1;
+	// 'dest' may be (a part of) the string being tokenized.
+	memmove(dest, &str.str[begin], token_len * sizeof(cell));
+	dest[token_len] = 0;
+	*index_ptr = (cell)end;
+	return (cell)token_len;
+}
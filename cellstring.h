@@ -0,0 +1,67 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _CELLSTRING_H
+#define _CELLSTRING_H
+
+#include <cstddef>
+#include <vector>
+#include "SDK/amx/amx.h"
+
+
+namespace cellstring
+{
+
+	/*
+		Returns the length of an unpacked string.
+	*/
+	size_t Length(const cell str[]);
+
+	/*
+		Compares two unpacked strings of known lengths (at most 'max_len' characters).
+		Returns a negative value, zero or a positive value, just like 'strcmp()'.
+		Case-insensitive comparison only folds ASCII letters.
+	*/
+	int Compare(const cell str1[], size_t len1, const cell str2[], size_t len2,
+		size_t max_len, bool ignorecase);
+
+	/*
+		Searches for 'sub' in 'str' starting from position 'pos'.
+		Returns the position of the substring or -1 if it's not found.
+	*/
+	cell Find(const cell str[], size_t len, const cell sub[], size_t sub_len,
+		size_t pos, bool ignorecase);
+
+	/*
+		Returns the position of the first 'delimiter' at or after 'pos',
+		or 'len' if there's none.
+	*/
+	size_t FindChar(const cell str[], size_t len, size_t pos, cell delimiter);
+
+	/*
+		A string argument of a native function in unpacked form.
+		If the string is unpacked, 'str' points directly to script memory.
+	*/
+	struct StringArg
+	{
+		const cell *str;
+		size_t len;
+		std::vector<cell> buffer;
+	};
+
+	/*
+		Obtains a string argument. Packed strings are unpacked into 'arg.buffer'.
+	*/
+	bool GetStringArg(AMX *amx, cell address, StringArg &arg, int &error);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_StrCompare(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_StrEqual(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_StrFind(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_StrToken(AMX *amx, cell *params);
+
+
+#endif // _CELLSTRING_H
@@ -0,0 +1,265 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include "codeanalysis.h"
+#include "amxopcodes.h"
+#include "pluginconfig.h"
+#include "pluginutils.h"
+#include "scripts.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace codeanalysis
+{
+
+	namespace
+	{
+
+		std::unordered_map<AMX *, Analysis> analyses;
+
+		bool CompareCallSites(const CallSite &a, const CallSite &b)
+		{
+			return a.address < b.address;
+		}
+
+#ifdef AMXOPCODES_HAVE_OPERANDS
+
+		const char *GetNativeName(const AMX_HEADER *hdr, cell index)
+		{
+			const AMX_FUNCSTUB *func = (const AMX_FUNCSTUB *)(const void *)((const unsigned char *)hdr +
+				(size_t)hdr->natives + (size_t)index * (size_t)hdr->defsize);
+			if (hdr->defsize == (int16_t)sizeof(AMX_FUNCSTUB))
+				return (const char *)func->name;
+			return (const char *)((size_t)hdr + (size_t)((const AMX_FUNCSTUBNT *)func)->nameofs);
+		}
+
+		cell FindNativeByAddress(const AMX_HEADER *hdr, ucell address)
+		{
+			const cell num_natives = (cell)(hdr->libraries - hdr->natives) / (cell)hdr->defsize;
+			for (cell i = 0; i < num_natives; ++i)
+			{
+				const AMX_FUNCSTUB *func = (const AMX_FUNCSTUB *)(const void *)((const unsigned char *)hdr +
+					(size_t)hdr->natives + (size_t)i * (size_t)hdr->defsize);
+				if (func->address == address)
+					return i;
+			}
+			return -1;
+		}
+
+		const char *const opcode_names[amxopcodes::NUM_OPCODES] =
+		{
+			"none", "load.pri", "load.alt", "load.s.pri", "load.s.alt", "lref.pri", "lref.alt",
+			"lref.s.pri", "lref.s.alt", "load.i", "lodb.i", "const.pri", "const.alt",
+			"addr.pri", "addr.alt", "stor.pri", "stor.alt", "stor.s.pri", "stor.s.alt",
+			"sref.pri", "sref.alt", "sref.s.pri", "sref.s.alt", "stor.i", "strb.i", "lidx",
+			"lidx.b", "idxaddr", "idxaddr.b", "align.pri", "align.alt", "lctrl", "sctrl",
+			"move.pri", "move.alt", "xchg", "push.pri", "push.alt", "push.r", "push.c", "push",
+			"push.s", "pop.pri", "pop.alt", "stack", "heap", "proc", "ret", "retn", "call",
+			"call.pri", "jump", "jrel", "jzer", "jnz", "jeq", "jneq", "jless", "jleq", "jgrtr",
+			"jgeq", "jsless", "jsleq", "jsgrtr", "jsgeq", "shl", "shr", "sshr", "shl.c.pri",
+			"shl.c.alt", "shr.c.pri", "shr.c.alt", "smul", "sdiv", "sdiv.alt", "umul", "udiv",
+			"udiv.alt", "add", "sub", "sub.alt", "and", "or", "xor", "not", "neg", "invert",
+			"add.c", "smul.c", "zero.pri", "zero.alt", "zero", "zero.s", "sign.pri",
+			"sign.alt", "eq", "neq", "less", "leq", "grtr", "geq", "sless", "sleq", "sgrtr",
+			"sgeq", "eq.c.pri", "eq.c.alt", "inc.pri", "inc.alt", "inc", "inc.s", "inc.i",
+			"dec.pri", "dec.alt", "dec", "dec.s", "dec.i", "movs", "cmps", "fill", "halt",
+			"bounds", "sysreq.pri", "sysreq.c", "file", "line", "symbol", "srange", "jump.pri",
+			"switch", "casetbl", "swap.pri", "swap.alt", "push.adr", "nop", "sysreq.d",
+			"symtag", "break"
+		};
+
+		/*
+			Maps the values in threaded code back to the opcodes.
+		*/
+		typedef std::unordered_map<cell, cell> OpcodeMap;
+
+		const OpcodeMap &GetOpcodeMap(const cell *jump_table)
+		{
+			static OpcodeMap opcode_map;
+			if (opcode_map.empty())
+			{
+				for (cell i = 0; i < amxopcodes::NUM_OPCODES; ++i)
+					opcode_map.insert(std::make_pair(jump_table[i], i));
+			}
+			return opcode_map;
+		}
+
+#endif // AMXOPCODES_HAVE_OPERANDS
+
+	}
+
+	bool Analyze(AMX *amx, Analysis &analysis)
+	{
+#ifdef AMXOPCODES_HAVE_OPERANDS
+		using namespace amxopcodes;
+
+		// The JIT compiler leaves nothing to decode.
+		if ((amx->flags & AMX_FLAG_JITC) != 0)
+			return false;
+		const AMX_HEADER *hdr = (const AMX_HEADER *)amx->base;
+		const unsigned char *code = amx->base + (size_t)hdr->cod;
+		const cell code_size = hdr->dat - hdr->cod;
+		const cell num_natives = (cell)(hdr->libraries - hdr->natives) / (cell)hdr->defsize;
+		const cell *jump_table = pluginutils::GetOpcodeJumpTable(amx);
+		const OpcodeMap *opcode_map = (jump_table != NULL) ? &GetOpcodeMap(jump_table) : NULL;
+
+		analysis.complete = false;
+		analysis.code_size = code_size;
+		analysis.num_instructions = 0;
+		analysis.opcode_counts.assign(NUM_OPCODES, 0);
+		analysis.call_sites.clear();
+		analysis.native_calls.assign((size_t)num_natives, 0);
+
+		cell cip = 0;
+		while (cip + (cell)sizeof(cell) <= code_size)
+		{
+			cell opcode = *(const cell *)(const void *)(code + (size_t)cip);
+			if (opcode_map != NULL)
+			{
+				const OpcodeMap::const_iterator it = opcode_map->find(opcode);
+				if (it == opcode_map->end())
+					break;
+				opcode = it->second;
+			}
+			const cell num_operands = GetNumOperands(opcode, code, code_size, cip);
+			if (num_operands < 0)
+				break;
+			++analysis.opcode_counts[(size_t)opcode];
+			++analysis.num_instructions;
+			if (opcode == OP_SYSREQ_C || opcode == OP_SYSREQ_D)
+			{
+				const cell operand = *(const cell *)(const void *)(code + (size_t)cip + sizeof(cell));
+				const cell native = (opcode == OP_SYSREQ_C)
+					? operand : FindNativeByAddress(hdr, (ucell)operand);
+				if (native >= 0 && native < num_natives)
+				{
+					const CallSite call_site = { cip, native };
+					analysis.call_sites.push_back(call_site);
+					++analysis.native_calls[(size_t)native];
+				}
+			}
+			cip += (1 + num_operands) * (cell)sizeof(cell);
+		}
+		analysis.complete = (cip == code_size);
+		return true;
+#else
+		return false;
+#endif // AMXOPCODES_HAVE_OPERANDS
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		Analysis analysis;
+		if (!Analyze(amx, analysis))
+			return;
+		if (!analysis.complete)
+		{
+			const std::vector<AMX *> &all = scripts::GetAll();
+			logprintf("%s: Only %u instructions of script #%d could be decoded, its native calls may be missed.",
+				PLUGIN_NAME, (unsigned)analysis.num_instructions,
+				(int)(std::find(all.begin(), all.end(), amx) - all.begin()));
+		}
+		std::swap(analyses[amx], analysis);
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		analyses.erase(amx);
+	}
+
+	const Analysis *Get(AMX *amx)
+	{
+		const std::unordered_map<AMX *, Analysis>::const_iterator it = analyses.find(amx);
+		return (it != analyses.end()) ? &it->second : NULL;
+	}
+
+	cell FindCallSite(const Analysis &analysis, cell address)
+	{
+		const CallSite key = { address, 0 };
+		const std::vector<CallSite>::const_iterator it = std::lower_bound(
+			analysis.call_sites.begin(), analysis.call_sites.end(), key, CompareCallSites);
+		return (it != analysis.call_sites.end() && it->address == address) ? it->native : -1;
+	}
+
+	bool WriteReport(AMX *amx, const char *path)
+	{
+#ifdef AMXOPCODES_HAVE_OPERANDS
+		const Analysis *analysis = Get(amx);
+		if (analysis == NULL)
+			return false;
+		FILE *file = fopen(path, "w");
+		if (file == NULL)
+			return false;
+		const AMX_HEADER *hdr = (const AMX_HEADER *)amx->base;
+
+		fprintf(file, "code size: %d bytes, instructions: %u%s\n", (int)analysis->code_size,
+			(unsigned)analysis->num_instructions, analysis->complete ? "" : " (incomplete)");
+
+		std::vector<std::pair<size_t, cell> > natives;
+		for (size_t i = 0; i < analysis->native_calls.size(); ++i)
+			natives.push_back(std::make_pair(analysis->native_calls[i], (cell)i));
+		std::stable_sort(natives.begin(), natives.end(),
+			[](const std::pair<size_t, cell> &a, const std::pair<size_t, cell> &b) { return a.first > b.first; });
+		fprintf(file, "\nnatives (call sites, index, name):\n");
+		for (size_t i = 0; i < natives.size(); ++i)
+		{
+			fprintf(file, "%10u  %5d  %s\n", (unsigned)natives[i].first, (int)natives[i].second,
+				GetNativeName(hdr, natives[i].second));
+		}
+
+		std::vector<std::pair<size_t, size_t> > opcodes;
+		for (size_t i = 0; i < analysis->opcode_counts.size(); ++i)
+		{
+			if (analysis->opcode_counts[i] != 0)
+				opcodes.push_back(std::make_pair(analysis->opcode_counts[i], i));
+		}
+		std::stable_sort(opcodes.begin(), opcodes.end(),
+			[](const std::pair<size_t, size_t> &a, const std::pair<size_t, size_t> &b) { return a.first > b.first; });
+		fprintf(file, "\ninstructions (count, opcode, name):\n");
+		for (size_t i = 0; i < opcodes.size(); ++i)
+		{
+			fprintf(file, "%10u  %5u  %s\n", (unsigned)opcodes[i].first, (unsigned)opcodes[i].second,
+				opcode_names[opcodes[i].second]);
+		}
+
+		fprintf(file, "\ncall sites (address, native):\n");
+		for (size_t i = 0; i < analysis->call_sites.size(); ++i)
+		{
+			const CallSite &call_site = analysis->call_sites[i];
+			fprintf(file, "0x%08X  %s\n", (unsigned)call_site.address, GetNativeName(hdr, call_site.native));
+		}
+		const bool ok = (ferror(file) == 0);
+		return (fclose(file) == 0) && ok;
+#else
+		return false;
+#endif // AMXOPCODES_HAVE_OPERANDS
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_WriteCodeReport(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_file,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	const std::string file = pluginutils::GetCXXString(amx, params[arg_file], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	// Like the file functions of the server, only allow the files in scriptfiles.
+	if (file.empty() || file.find("..") != std::string::npos)
+		return 0;
+	return codeanalysis::WriteReport(amx, ("scriptfiles/" + file).c_str()) ? 1 : 0;
+}
@@ -0,0 +1,70 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _CODEANALYSIS_H
+#define _CODEANALYSIS_H
+
+#include <cstddef>
+#include <vector>
+#include "SDK/amx/amx.h"
+
+
+/*
+	Decodes the code of every script when it's loaded: where the natives are
+	called from, how many call sites each native has and how often each
+	instruction occurs in the code. Decoding the code takes the threaded
+	code of the interpreter into account (see amxopcodes.h), and is only
+	supported for the instruction set of the server (file versions 6 to 8).
+*/
+namespace codeanalysis
+{
+
+	struct CallSite
+	{
+		cell address; // Of the SYSREQ.C/SYSREQ.D instruction, relative to the code section.
+		cell native;  // Index in the native table of the script.
+	};
+
+	struct Analysis
+	{
+		bool complete; // Whether all of the code could be decoded.
+		cell code_size;
+		size_t num_instructions;
+		std::vector<size_t> opcode_counts; // By opcode.
+		std::vector<CallSite> call_sites;  // Sorted by address.
+		std::vector<size_t> native_calls;  // Number of call sites by native index.
+	};
+
+	/*
+		Decodes the code of a script. Only from the server thread.
+	*/
+	bool Analyze(AMX *amx, Analysis &analysis);
+
+	void AmxLoad(AMX *amx);
+	void AmxUnload(AMX *amx);
+
+	/*
+		Returns NULL if the code of the script couldn't be analyzed.
+	*/
+	const Analysis *Get(AMX *amx);
+
+	/*
+		Returns the index of the native called by the instruction at 'address',
+		or -1 if there's no native call there.
+	*/
+	cell FindCallSite(const Analysis &analysis, cell address);
+
+	/*
+		Writes the results as text: the natives by number of call sites,
+		the instructions by number of occurrences and the call sites.
+	*/
+	bool WriteReport(AMX *amx, const char *path);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_WriteCodeReport(AMX *amx, cell *params);
+
+
+#endif // _CODEANALYSIS_H
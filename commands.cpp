@@ -0,0 +1,325 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "commands.h"
+#include "loadcache.h"
+#include "pluginconfig.h"
+#include "pluginutils.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace commands
+{
+
+	namespace
+	{
+
+		// Give up on a bucket after this many seeds and rebuild
+		// the table with another primary seed.
+		const uint32_t MAX_BUCKET_SEED = 1u << 16;
+		const uint32_t MAX_PRIMARY_SEED = 16;
+
+		/*
+			A minimal perfect hash built with the "hash and displace" method:
+			the first hash selects a bucket, and each bucket stores the seed
+			for the second hash that maps all of its keys to free slots.
+		*/
+		struct CommandTable
+		{
+			uint32_t primary_seed;
+			std::vector<uint32_t> bucket_seeds;
+			std::vector<std::string> names;
+			std::vector<int> public_indices;
+		};
+
+		std::map<AMX *, CommandTable> tables;
+
+		FORCE_INLINE uint32_t ToLower(uint32_t c)
+		{
+			return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+		}
+
+		/*
+			FNV-1a with a seed and a final avalanche step.
+			Works on both C strings and cell strings, so commands can be
+			looked up without converting the text first.
+		*/
+		template <typename Char>
+		uint32_t Hash(const Char str[], size_t len, uint32_t seed)
+		{
+			uint32_t hash = 2166136261u ^ (seed * 0x9E3779B1u);
+			for (size_t i = 0; i < len; ++i)
+			{
+				hash ^= ToLower((uint32_t)(unsigned char)str[i]);
+				hash *= 16777619u;
+			}
+			hash ^= hash >> 16;
+			hash *= 0x85EBCA6Bu;
+			hash ^= hash >> 13;
+			hash *= 0xC2B2AE35u;
+			hash ^= hash >> 16;
+			return hash;
+		}
+
+		bool BuildTable(CommandTable &table, const std::vector<std::string> &names,
+			const std::vector<int> &public_indices, uint32_t primary_seed)
+		{
+			const size_t num_keys = names.size();
+			std::vector<std::vector<size_t> > buckets(num_keys);
+			for (size_t i = 0; i < num_keys; ++i)
+				buckets[Hash(names[i].c_str(), names[i].length(), primary_seed) % num_keys].push_back(i);
+
+			// Place the biggest buckets first, while most of the slots are free.
+			std::vector<size_t> bucket_order(num_keys);
+			for (size_t i = 0; i < num_keys; ++i)
+				bucket_order[i] = i;
+			std::sort(bucket_order.begin(), bucket_order.end(), [&buckets](size_t a, size_t b)
+			{
+				return buckets[a].size() > buckets[b].size();
+			});
+
+			table.primary_seed = primary_seed;
+			table.bucket_seeds.assign(num_keys, 0);
+			table.names.assign(num_keys, std::string());
+			table.public_indices.assign(num_keys, -1);
+			std::vector<bool> taken(num_keys, false);
+			std::vector<size_t> slots;
+			for (size_t b = 0; b < num_keys; ++b)
+			{
+				const std::vector<size_t> &bucket = buckets[bucket_order[b]];
+				if (bucket.empty())
+					break;
+				uint32_t seed;
+				for (seed = 1; seed < MAX_BUCKET_SEED; ++seed)
+				{
+					slots.clear();
+					for (size_t k = 0; k < bucket.size(); ++k)
+					{
+						const std::string &name = names[bucket[k]];
+						const size_t slot = Hash(name.c_str(), name.length(), seed) % num_keys;
+						if (taken[slot] || std::find(slots.begin(), slots.end(), slot) != slots.end())
+							break;
+						slots.push_back(slot);
+					}
+					if (slots.size() == bucket.size())
+						break;
+				}
+				if (seed == MAX_BUCKET_SEED)
+					return false;
+				table.bucket_seeds[bucket_order[b]] = seed;
+				for (size_t k = 0; k < bucket.size(); ++k)
+				{
+					taken[slots[k]] = true;
+					table.names[slots[k]] = names[bucket[k]];
+					table.public_indices[slots[k]] = public_indices[bucket[k]];
+				}
+			}
+			return true;
+		}
+
+		/*
+			The table is cached rather than the names: finding the seeds is
+			what takes time with many commands.
+		*/
+		void SaveTable(const CommandTable &table)
+		{
+			loadcache::Writer writer;
+			writer.Put((uint8_t)1);
+			writer.Put(table.primary_seed);
+			writer.Put((uint32_t)table.names.size());
+			for (size_t i = 0; i < table.names.size(); ++i)
+			{
+				writer.Put(table.bucket_seeds[i]);
+				writer.PutString(table.names[i]);
+				writer.Put((int32_t)table.public_indices[i]);
+			}
+			loadcache::Store(loadcache::SECTION_COMMANDS, writer.GetData());
+		}
+
+		void SaveNoTable()
+		{
+			loadcache::Writer writer;
+			writer.Put((uint8_t)0);
+			loadcache::Store(loadcache::SECTION_COMMANDS, writer.GetData());
+		}
+
+		/*
+			Returns false if the table isn't in the cache, otherwise 'has_table'
+			tells whether the script has commands.
+		*/
+		bool LoadTable(CommandTable &table, bool &has_table)
+		{
+			const char *data;
+			size_t size;
+			if (!loadcache::Find(loadcache::SECTION_COMMANDS, data, size))
+				return false;
+			loadcache::Reader reader(data, size);
+			uint8_t flag;
+			uint32_t num_keys;
+			if (!reader.Get(flag))
+				return false;
+			has_table = (flag != 0);
+			if (!has_table)
+				return reader.AtEnd();
+			if (!reader.Get(table.primary_seed) || !reader.Get(num_keys) ||
+				num_keys == 0 || !reader.CanHold(num_keys, 3 * sizeof(uint32_t)))
+			{
+				return false;
+			}
+			table.bucket_seeds.resize(num_keys);
+			table.names.resize(num_keys);
+			table.public_indices.resize(num_keys);
+			for (uint32_t i = 0; i < num_keys; ++i)
+			{
+				int32_t index;
+				if (!reader.Get(table.bucket_seeds[i]) || !reader.GetString(table.names[i]) || !reader.Get(index))
+					return false;
+				table.public_indices[i] = index;
+			}
+			return reader.AtEnd();
+		}
+
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		CommandTable cached;
+		bool has_table;
+		if (LoadTable(cached, has_table))
+		{
+			if (has_table)
+				std::swap(tables[amx], cached);
+			return;
+		}
+
+		const size_t prefix_len = sizeof(PLUGIN_COMMAND_PREFIX) - 1;
+		int num_publics;
+		if (amx_NumPublics(amx, &num_publics) != AMX_ERR_NONE)
+			return;
+		std::vector<std::string> names;
+		std::vector<int> public_indices;
+		std::set<std::string> unique_names;
+		char name[sNAMEMAX + 1];
+		for (int i = 0; i < num_publics; ++i)
+		{
+			if (amx_GetPublic(amx, i, name) != AMX_ERR_NONE)
+				continue;
+			if (strncmp(name, PLUGIN_COMMAND_PREFIX, prefix_len) != 0 || name[prefix_len] == '\0')
+				continue;
+			std::string command(&name[prefix_len]);
+			std::transform(command.begin(), command.end(), command.begin(), [](char c)
+			{
+				return (char)ToLower((uint32_t)(unsigned char)c);
+			});
+			// Commands are case-insensitive, so e.g. cmd_Help and cmd_help are the
+			// same command (and would never hash to different slots).
+			if (!unique_names.insert(command).second)
+			{
+				logprintf("%s: %s is the same command as another public, only the first one is used.",
+					PLUGIN_NAME, name);
+				continue;
+			}
+			names.push_back(command);
+			public_indices.push_back(i);
+		}
+		if (names.empty())
+		{
+			SaveNoTable();
+			return;
+		}
+
+		CommandTable &table = tables[amx];
+		for (uint32_t seed = 0; seed < MAX_PRIMARY_SEED; ++seed)
+		{
+			if (BuildTable(table, names, public_indices, seed))
+			{
+				SaveTable(table);
+				return;
+			}
+		}
+		tables.erase(amx);
+		logprintf("%s: Failed to build the command table.", PLUGIN_NAME);
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		tables.erase(amx);
+	}
+
+	int FindCommand(AMX *amx, const cell name[], size_t name_len)
+	{
+		std::map<AMX *, CommandTable>::const_iterator it = tables.find(amx);
+		if (it == tables.end() || name_len == 0)
+			return -1;
+		const CommandTable &table = it->second;
+		const size_t num_keys = table.names.size();
+		const uint32_t seed = table.bucket_seeds[Hash(name, name_len, table.primary_seed) % num_keys];
+		const size_t slot = Hash(name, name_len, seed) % num_keys;
+
+		// The input might not be a command at all, so the name has to be verified.
+		const std::string &slot_name = table.names[slot];
+		if (slot_name.length() != name_len)
+			return -1;
+		for (size_t i = 0; i < name_len; ++i)
+			if ((uint32_t)(unsigned char)slot_name[i] != ToLower((uint32_t)name[i]))
+				return -1;
+		return table.public_indices[slot];
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_DispatchCommand(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_playerid,
+		arg_cmdtext,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	int error, len;
+	cell *cmdtext;
+	if ((error = amx_GetAddr(amx, params[arg_cmdtext], &cmdtext)) != AMX_ERR_NONE ||
+		(error = amx_StrLen(cmdtext, &len)) != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), -1;
+	if ((ucell)cmdtext[0] > UNPACKEDMAX)
+		return -1;
+
+	// "/name params"
+	cell *name = cmdtext, *end = &cmdtext[len];
+	if (name < end && *name == '/')
+		++name;
+	cell *name_end = name;
+	while (name_end < end && *name_end != ' ')
+		++name_end;
+	const int index = commands::FindCommand(amx, name, (size_t)(name_end - name));
+	if (index < 0)
+		return -1;
+	cell *cmdparams = name_end;
+	while (cmdparams < end && *cmdparams == ' ')
+		++cmdparams;
+
+	// The parameters are copied straight from the input string,
+	// including its terminating zero.
+	cell params_addr, retval = 0;
+	error = amx_PushArray(amx, &params_addr, NULL, cmdparams, (int)(end - cmdparams) + 1);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), -1;
+	amx_Push(amx, params[arg_playerid]);
+	error = amx_Exec(amx, &retval, index);
+	amx_Release(amx, params_addr);
+	if (error != AMX_ERR_NONE)
+		return -1;
+	return retval;
+}
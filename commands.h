@@ -0,0 +1,37 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _COMMANDS_H
+#define _COMMANDS_H
+
+#include "SDK/amx/amx.h"
+
+
+namespace commands
+{
+
+	/*
+		Collects the public functions whose names start with PLUGIN_COMMAND_PREFIX
+		and builds a minimal perfect hash table for them.
+	*/
+	void AmxLoad(AMX *amx);
+
+	/*
+		Frees the command table of the specified script.
+	*/
+	void AmxUnload(AMX *amx);
+
+	/*
+		Returns the index of the public function that handles the command
+		(the command name is case-insensitive), or -1 if there's no such command.
+	*/
+	int FindCommand(AMX *amx, const cell name[], size_t name_len);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_DispatchCommand(AMX *amx, cell *params);
+
+
+#endif // _COMMANDS_H
@@ -0,0 +1,413 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#if defined _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <dirent.h>
+#endif
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "datatables.h"
+#include "cellstring.h"
+#include "mappedfile.h"
+#include "pluginconfig.h"
+#include "pluginutils.h"
+#include "tableformat.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace datatables
+{
+
+	namespace
+	{
+
+		const char TABLE_FILE_EXT[] = ".tbl";
+
+		struct Table
+		{
+			std::string name;
+			MappedFile file;
+			const TableHeader *header;
+			const TableColumn *columns;
+			const int32_t *cells;
+			const unsigned char *strings;
+			const uint32_t *index;
+		};
+
+		std::vector<std::unique_ptr<Table> > tables;
+
+		bool IsRangeValid(size_t file_size, uint32_t offset, uint64_t size)
+		{
+			return (offset % 4) == 0 && (uint64_t)offset + size <= (uint64_t)file_size;
+		}
+
+		bool InitTable(Table &table)
+		{
+			const size_t file_size = table.file.GetSize();
+			const unsigned char *data = (const unsigned char *)table.file.GetData();
+			if (file_size < sizeof(TableHeader))
+				return false;
+			const TableHeader *header = (const TableHeader *)(const void *)data;
+			if (memcmp(header->magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) != 0 ||
+				header->version != TABLE_FORMAT_VERSION || header->num_columns == 0)
+				return false;
+			const uint64_t num_cells = (uint64_t)header->num_rows * header->num_columns;
+			if (!IsRangeValid(file_size, header->columns_offset, (uint64_t)header->num_columns * sizeof(TableColumn)) ||
+				!IsRangeValid(file_size, header->cells_offset, num_cells * sizeof(int32_t)) ||
+				!IsRangeValid(file_size, header->strings_offset, header->strings_size) ||
+				!IsRangeValid(file_size, header->index_offset, header->index_size))
+				return false;
+			table.header = header;
+			table.columns = (const TableColumn *)(const void *)(data + header->columns_offset);
+			table.cells = (const int32_t *)(const void *)(data + header->cells_offset);
+			table.strings = data + header->strings_offset;
+			table.index = (const uint32_t *)(const void *)(data + header->index_offset);
+
+			// The index must match the type of the key column.
+			const uint32_t key_type = table.columns[0].type;
+			if (key_type == TABLE_COLUMN_STRING)
+			{
+				if (header->index_size < sizeof(uint32_t))
+					return false;
+				const uint32_t num_buckets = table.index[0];
+				if (num_buckets == 0 || (num_buckets & (num_buckets - 1)) != 0 ||
+					(uint64_t)(num_buckets + 1) * sizeof(uint32_t) != header->index_size)
+					return false;
+			}
+			else if ((uint64_t)header->num_rows * sizeof(uint32_t) != header->index_size)
+			{
+				return false;
+			}
+			return true;
+		}
+
+		void LoadTable(const std::string &dir, const std::string &file_name)
+		{
+			std::unique_ptr<Table> table(new Table);
+			table->name = file_name.substr(0, file_name.length() - (sizeof(TABLE_FILE_EXT) - 1));
+			const std::string path = dir + "/" + file_name;
+			if (!table->file.Open(path.c_str()) || !InitTable(*table))
+			{
+				logprintf("%s: Failed to load table \"%s\".", PLUGIN_NAME, path.c_str());
+				return;
+			}
+			tables.push_back(std::move(table));
+		}
+
+		bool HasTableExt(const char *file_name)
+		{
+			const size_t len = strlen(file_name), ext_len = sizeof(TABLE_FILE_EXT) - 1;
+			return len > ext_len && strcmp(&file_name[len - ext_len], TABLE_FILE_EXT) == 0;
+		}
+
+		const Table *GetTable(cell id)
+		{
+			if (id <= 0 || (size_t)id > tables.size())
+				return NULL;
+			return tables[id - 1].get();
+		}
+
+		/*
+			Returns a string from the pool (as cells) or NULL if the offset is invalid.
+		*/
+		const int32_t *GetString(const Table &table, uint32_t offset, uint32_t &len)
+		{
+			const uint32_t pool_size = table.header->strings_size;
+			if ((offset % 4) != 0 || (uint64_t)offset + sizeof(uint32_t) > pool_size)
+				return NULL;
+			const int32_t *str = (const int32_t *)(const void *)(table.strings + offset);
+			len = (uint32_t)str[0];
+			if ((uint64_t)offset + ((uint64_t)len + 2) * sizeof(int32_t) > pool_size)
+				return NULL;
+			return &str[1];
+		}
+
+		bool GetCell(const Table &table, cell row, cell column, int32_t &value)
+		{
+			if (row < 0 || (uint32_t)row >= table.header->num_rows ||
+				column < 0 || (uint32_t)column >= table.header->num_columns)
+				return false;
+			value = table.cells[(size_t)row * table.header->num_columns + (size_t)column];
+			return true;
+		}
+
+		FORCE_INLINE bool KeyLess(int32_t a, int32_t b, bool floats)
+		{
+			if (floats)
+			{
+				float fa, fb;
+				memcpy(&fa, &a, sizeof(fa));
+				memcpy(&fb, &b, sizeof(fb));
+				return fa < fb;
+			}
+			return a < b;
+		}
+
+	}
+
+	void Load()
+	{
+		const std::string dir(PLUGIN_TABLES_DIR);
+#if defined _WIN32
+		WIN32_FIND_DATAA find_data;
+		const HANDLE find_handle = FindFirstFileA((dir + "\\*" + TABLE_FILE_EXT).c_str(), &find_data);
+		if (find_handle == INVALID_HANDLE_VALUE)
+			return;
+		do
+		{
+			if (HasTableExt(find_data.cFileName))
+				LoadTable(dir, find_data.cFileName);
+		} while (FindNextFileA(find_handle, &find_data));
+		FindClose(find_handle);
+#else
+		DIR *dir_handle = opendir(dir.c_str());
+		if (dir_handle == NULL)
+			return;
+		while (struct dirent *entry = readdir(dir_handle))
+			if (HasTableExt(entry->d_name))
+				LoadTable(dir, entry->d_name);
+		closedir(dir_handle);
+#endif
+		if (!tables.empty())
+			logprintf("  %s: Loaded %u data table(s).", PLUGIN_NAME, (unsigned)tables.size());
+	}
+
+	void Unload()
+	{
+		tables.clear();
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableFind(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_name,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	char *name = pluginutils::GetCString(amx, params[arg_name], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	cell id = 0;
+	for (size_t i = 0; i < datatables::tables.size(); ++i)
+	{
+		if (datatables::tables[i]->name == name)
+		{
+			id = (cell)i + 1;
+			break;
+		}
+	}
+	free(name);
+	return id;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableRows(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_table,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const datatables::Table *table = datatables::GetTable(params[arg_table]);
+	return (table != NULL) ? (cell)table->header->num_rows : 0;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableColumns(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_table,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const datatables::Table *table = datatables::GetTable(params[arg_table]);
+	return (table != NULL) ? (cell)table->header->num_columns : 0;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableColumn(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_table,
+		arg_name,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	const datatables::Table *table = datatables::GetTable(params[arg_table]);
+	if (table == NULL)
+		return -1;
+	int error;
+	cellstring::StringArg name;
+	if (!cellstring::GetStringArg(amx, params[arg_name], name, error))
+		return amx_RaiseError(amx, error), -1;
+	for (uint32_t i = 0; i < table->header->num_columns; ++i)
+	{
+		uint32_t len;
+		const int32_t *column_name = datatables::GetString(*table, table->columns[i].name_offset, len);
+		if (column_name != NULL && len == name.len &&
+			memcmp(column_name, name.str, (size_t)len * sizeof(cell)) == 0)
+			return (cell)i;
+	}
+	return -1;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableLookup(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_table,
+		arg_key,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	const datatables::Table *table = datatables::GetTable(params[arg_table]);
+	if (table == NULL || table->columns[0].type == TABLE_COLUMN_STRING)
+		return -1;
+
+	// Binary search over the rows sorted by key.
+	const bool floats = (table->columns[0].type == TABLE_COLUMN_FLOAT);
+	const uint32_t num_columns = table->header->num_columns;
+	const int32_t key = (int32_t)params[arg_key];
+	size_t first = 0, count = table->header->num_rows;
+	while (count > 0)
+	{
+		const size_t half = count / 2;
+		const uint32_t row = table->index[first + half];
+		if (row < table->header->num_rows &&
+			datatables::KeyLess(table->cells[(size_t)row * num_columns], key, floats))
+		{
+			first += half + 1;
+			count -= half + 1;
+		}
+		else
+		{
+			count = half;
+		}
+	}
+	if (first == table->header->num_rows)
+		return -1;
+	const uint32_t row = table->index[first];
+	if (row >= table->header->num_rows || table->cells[(size_t)row * num_columns] != key)
+		return -1;
+	return (cell)row;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableLookupString(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_table,
+		arg_key,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	const datatables::Table *table = datatables::GetTable(params[arg_table]);
+	if (table == NULL || table->columns[0].type != TABLE_COLUMN_STRING)
+		return -1;
+	int error;
+	cellstring::StringArg key;
+	if (!cellstring::GetStringArg(amx, params[arg_key], key, error))
+		return amx_RaiseError(amx, error), -1;
+
+	const uint32_t num_buckets = table->index[0];
+	const uint32_t *buckets = &table->index[1];
+	const uint32_t num_columns = table->header->num_columns;
+	uint32_t bucket = TableHashKey(key.str, key.len) & (num_buckets - 1);
+	for (uint32_t i = 0; i < num_buckets; ++i, bucket = (bucket + 1) & (num_buckets - 1))
+	{
+		const uint32_t row = buckets[bucket];
+		if (row == 0)
+			break;
+		if (row > table->header->num_rows)
+			continue;
+		uint32_t len;
+		const int32_t *str = datatables::GetString(*table,
+			(uint32_t)table->cells[(size_t)(row - 1) * num_columns], len);
+		if (str != NULL && len == key.len &&
+			memcmp(str, key.str, (size_t)len * sizeof(cell)) == 0)
+			return (cell)(row - 1);
+	}
+	return -1;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableGetInt(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_table,
+		arg_row,
+		arg_column,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const datatables::Table *table = datatables::GetTable(params[arg_table]);
+	int32_t value;
+	if (table == NULL || !datatables::GetCell(*table, params[arg_row], params[arg_column], value))
+		return 0;
+	return (cell)value;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableGetString(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_table,
+		arg_row,
+		arg_column,
+		arg_dest,
+		arg_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell size = params[arg_size];
+	if (size <= 0)
+		return 0;
+	int error;
+	cell *dest = pluginutils::GetArrayAddr(amx, params[arg_dest], (size_t)size, error);
+	if (dest == NULL)
+		return amx_RaiseError(amx, error), 0;
+	dest[0] = 0;
+	const datatables::Table *table = datatables::GetTable(params[arg_table]);
+	int32_t offset;
+	if (table == NULL || !datatables::GetCell(*table, params[arg_row], params[arg_column], offset) ||
+		table->columns[params[arg_column]].type != TABLE_COLUMN_STRING)
+		return 0;
+	uint32_t len;
+	const int32_t *str = datatables::GetString(*table, (uint32_t)offset, len);
+	if (str == NULL)
+		return 0;
+	if (len > (uint32_t)size - 1)
+		len = (uint32_t)size - 1;
+	// The strings are stored as cells, so there's nothing to convert.
+	memcpy(dest, str, (size_t)len * sizeof(cell));
+	dest[len] = 0;
+	return (cell)len;
+}
@@ -0,0 +1,34 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _DATATABLES_H
+#define _DATATABLES_H
+
+#include "SDK/amx/amx.h"
+
+
+namespace datatables
+{
+
+	/*
+		Maps all compiled tables (*.tbl) from PLUGIN_TABLES_DIR into memory.
+		The tables are read-only and shared by all scripts.
+	*/
+	void Load();
+	void Unload();
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_TableFind(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_TableRows(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_TableColumns(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_TableColumn(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_TableLookup(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_TableLookupString(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_TableGetInt(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_TableGetString(AMX *amx, cell *params);
+
+
+#endif // _DATATABLES_H
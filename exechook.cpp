@@ -0,0 +1,179 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#if defined _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include "exechook.h"
+#include "callbackfilter.h"
+#include "metrics.h"
+#include "nativecache.h"
+#include "pluginconfig.h"
+#include "SDK/plugincommon.h"
+
+
+extern void *pAMXFunctions;
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace exechook
+{
+
+	namespace
+	{
+
+		typedef int (AMXAPI *amx_Exec_t)(AMX *amx, cell *retval, int index);
+
+		// Deeper calls (scripts calling each other through CallRemoteFunction
+		// and the like) are executed but not tracked.
+		const int MAX_DEPTH = 32;
+
+		amx_Exec_t orig_Exec;
+
+		// Written by the server thread only. A call is pushed before 'depth'
+		// is raised, so other threads see complete entries.
+		ExecInfo calls[MAX_DEPTH];
+		std::atomic<int> depth(0);
+
+		MetricsEntry *callbacks;
+		MetricsEntry *callback_time;
+
+		// The code hook: JMP rel32 to hook_Exec at the start of orig_Exec.
+		const size_t JUMP_SIZE = 5;
+		unsigned char *exec_code;
+		unsigned char orig_code[JUMP_SIZE];
+		unsigned char jump_code[JUMP_SIZE];
+		bool code_hooked;
+		bool code_hook_installed;
+
+		int AMXAPI hook_Exec(AMX *amx, cell *retval, int index)
+		{
+			nativecache::BeginExec(amx, index);
+			if (callbackfilter::Filter(amx, index, retval))
+				return AMX_ERR_NONE;
+			const int pos = depth.load(std::memory_order_relaxed);
+			if (pos < MAX_DEPTH)
+			{
+				calls[pos].amx = amx;
+				calls[pos].index = index;
+			}
+			depth.store(pos + 1, std::memory_order_release);
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			// The outermost call takes the jump out, so that the original can run,
+			// and puts it back.
+			const bool unhook = code_hooked;
+			if (unhook)
+			{
+				memcpy(exec_code, orig_code, JUMP_SIZE);
+				code_hooked = false;
+			}
+			const int result = orig_Exec(amx, retval, index);
+			if (unhook)
+			{
+				memcpy(exec_code, jump_code, JUMP_SIZE);
+				code_hooked = true;
+			}
+			depth.store(pos, std::memory_order_release);
+			// Nested calls are also counted in the time of the outer one.
+			metrics::Increment(callbacks);
+			metrics::Record(callback_time, (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - start).count());
+			return result;
+		}
+
+		void **GetExports()
+		{
+			return (void **)pAMXFunctions;
+		}
+
+		/*
+			Makes the code writable for good, as it's patched on every call.
+		*/
+		bool Unprotect(void *address, size_t size)
+		{
+#if defined _WIN32
+			DWORD old_protect;
+			return VirtualProtect(address, size, PAGE_EXECUTE_READWRITE, &old_protect) != 0;
+#else
+			const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+			const size_t start = (size_t)address & ~(page_size - 1);
+			const size_t end = ((size_t)address + size + page_size - 1) & ~(page_size - 1);
+			return mprotect((void *)start, end - start, PROT_READ | PROT_WRITE | PROT_EXEC) == 0;
+#endif
+		}
+
+		bool InstallCodeHook()
+		{
+			exec_code = (unsigned char *)(void *)orig_Exec;
+			const ptrdiff_t offset = (const unsigned char *)(void *)hook_Exec - (exec_code + JUMP_SIZE);
+			if (offset != (ptrdiff_t)(int32_t)offset || !Unprotect(exec_code, JUMP_SIZE))
+				return false;
+			const int32_t rel32 = (int32_t)offset;
+			jump_code[0] = 0xE9;
+			memcpy(&jump_code[1], &rel32, sizeof(rel32));
+			memcpy(orig_code, exec_code, JUMP_SIZE);
+			memcpy(exec_code, jump_code, JUMP_SIZE);
+			code_hooked = true;
+			code_hook_installed = true;
+			return true;
+		}
+
+		void RemoveCodeHook()
+		{
+			// Unless another plugin has patched the code since.
+			if (code_hooked && memcmp(exec_code, jump_code, JUMP_SIZE) == 0)
+				memcpy(exec_code, orig_code, JUMP_SIZE);
+			code_hooked = false;
+			code_hook_installed = false;
+		}
+
+	}
+
+	void Load()
+	{
+		if (orig_Exec != NULL)
+			return;
+		callbacks = metrics::AddCounter("callbacks");
+		callback_time = metrics::AddHistogram("callbacks.time_us");
+		orig_Exec = (amx_Exec_t)GetExports()[PLUGIN_AMX_EXPORT_Exec];
+		GetExports()[PLUGIN_AMX_EXPORT_Exec] = (void *)hook_Exec;
+		if (!InstallCodeHook())
+			logprintf("%s: Can't patch amx_Exec, the server's own callbacks won't be seen.", PLUGIN_NAME);
+	}
+
+	void Unload()
+	{
+		if (orig_Exec == NULL)
+			return;
+		// The jump leads into this plugin's code, which is about to be unloaded.
+		RemoveCodeHook();
+		// Another plugin's hook may still call ours, which then needs orig_Exec.
+		if (GetExports()[PLUGIN_AMX_EXPORT_Exec] != (void *)hook_Exec)
+			return;
+		GetExports()[PLUGIN_AMX_EXPORT_Exec] = (void *)orig_Exec;
+		orig_Exec = NULL;
+	}
+
+	bool SeesServerCallbacks()
+	{
+		return code_hook_installed;
+	}
+
+	bool GetCurrent(ExecInfo &info)
+	{
+		const int pos = depth.load(std::memory_order_acquire);
+		if (pos == 0)
+			return false;
+		info = calls[(pos <= MAX_DEPTH) ? pos - 1 : MAX_DEPTH - 1];
+		return true;
+	}
+
+}
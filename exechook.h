@@ -0,0 +1,60 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _EXECHOOK_H
+#define _EXECHOOK_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Hooks amx_Exec, so that the plugin knows which script and public are
+	being executed. The function in the server's AMX export table is
+	replaced, which catches the calls made by plugins, and the server calls
+	amx_Exec directly for its own callbacks, so a jump to the hook is also
+	written over the start of the function the table pointed to (as
+	crashdetect and sampgdk do). The jump is taken out while the original
+	amx_Exec runs: the callbacks the server calls from within a script
+	(i.e. from a native) are only seen if they go through the export table.
+	The calls and how long they took are added to the metrics (metrics.h).
+	Calls may be skipped by the rules of the scripts (callbackfilter.h).
+	The player callbacks also drop the cached player data (nativecache.h).
+*/
+namespace exechook
+{
+
+	/*
+		Must be called after pAMXFunctions is set.
+	*/
+	void Load();
+
+	/*
+		Puts the original amx_Exec back, unless something has replaced ours since.
+	*/
+	void Unload();
+
+	/*
+		Whether the jump into amx_Exec is in place, i.e. the callbacks
+		the server calls on its own go through the hook.
+	*/
+	bool SeesServerCallbacks();
+
+	struct ExecInfo
+	{
+		AMX *amx;
+		int index; // Public index, or AMX_EXEC_MAIN or AMX_EXEC_CONT.
+	};
+
+	/*
+		The innermost amx_Exec call in progress on the server thread.
+		Can be called from any thread, in which case the result is only
+		a sample: the call may have returned by the time it's used.
+		Returns false when no script is being executed.
+	*/
+	bool GetCurrent(ExecInfo &info);
+
+}
+
+
+#endif // _EXECHOOK_H
@@ -0,0 +1,292 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "intern.h"
+#include "cellstring.h"
+#include "pluginutils.h"
+
+
+namespace intern
+{
+
+	namespace
+	{
+
+		const size_t ARENA_CHUNK_SIZE = 64 * 1024;
+		const size_t ID_SEGMENT_BITS = 12;
+		const size_t ID_SEGMENT_SIZE = (size_t)1 << ID_SEGMENT_BITS;
+		const size_t MAX_ID_SEGMENTS = 4096;
+		const size_t INITIAL_TABLE_SIZE = 1024;
+
+		/*
+			Entries are allocated from the arena and never move or get freed
+			until the plugin is unloaded, so readers can use them without locks.
+		*/
+		struct Entry
+		{
+			uint32_t hash;
+			uint32_t len;
+			cell str[1]; // 'len' characters followed by a zero
+		};
+
+		typedef std::atomic<const Entry *> EntryPtr;
+
+		/*
+			Open addressing hash table of IDs. When the table grows, a new one
+			is built and published, the old one is kept alive for the readers
+			that might still be using it.
+		*/
+		struct HashTable
+		{
+			size_t mask;
+			std::unique_ptr<std::atomic<cell>[]> slots;
+
+			explicit HashTable(size_t size)
+				: mask(size - 1), slots(new std::atomic<cell>[size])
+			{
+				for (size_t i = 0; i < size; ++i)
+					slots[i].store(0, std::memory_order_relaxed);
+			}
+		};
+
+		std::mutex write_mutex;
+		std::vector<std::unique_ptr<char[]> > arena_chunks;
+		size_t arena_chunk_used = 0, arena_chunk_size = 0;
+		std::vector<std::unique_ptr<HashTable> > tables;
+		std::atomic<HashTable *> current_table(NULL);
+		std::atomic<EntryPtr *> id_segments[MAX_ID_SEGMENTS];
+		std::atomic<cell> num_ids(0);
+
+		uint32_t Hash(const cell str[], size_t len)
+		{
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < len; ++i)
+			{
+				hash ^= (uint32_t)str[i];
+				hash *= 16777619u;
+			}
+			hash ^= hash >> 16;
+			hash *= 0x85EBCA6Bu;
+			hash ^= hash >> 13;
+			return hash;
+		}
+
+		const Entry *GetEntry(cell id)
+		{
+			if (id <= 0 || id > num_ids.load(std::memory_order_acquire))
+				return NULL;
+			const EntryPtr *segment =
+				id_segments[(size_t)id >> ID_SEGMENT_BITS].load(std::memory_order_acquire);
+			return segment[(size_t)id & (ID_SEGMENT_SIZE - 1)].load(std::memory_order_acquire);
+		}
+
+		cell FindInTable(const HashTable *table, const cell str[], size_t len, uint32_t hash)
+		{
+			for (size_t i = hash & table->mask; ; i = (i + 1) & table->mask)
+			{
+				const cell id = table->slots[i].load(std::memory_order_acquire);
+				if (id == 0)
+					return 0;
+				const Entry *entry = GetEntry(id);
+				if (entry->hash == hash && entry->len == (uint32_t)len &&
+					memcmp(entry->str, str, len * sizeof(cell)) == 0)
+					return id;
+			}
+		}
+
+		void InsertIntoTable(HashTable *table, cell id, uint32_t hash)
+		{
+			size_t i = hash & table->mask;
+			while (table->slots[i].load(std::memory_order_relaxed) != 0)
+				i = (i + 1) & table->mask;
+			table->slots[i].store(id, std::memory_order_release);
+		}
+
+		Entry *AllocEntry(size_t len)
+		{
+			size_t size = offsetof(Entry, str) + (len + 1) * sizeof(cell);
+			size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+			if (arena_chunk_size - arena_chunk_used < size)
+			{
+				arena_chunk_size = (size > ARENA_CHUNK_SIZE) ? size : ARENA_CHUNK_SIZE;
+				arena_chunks.push_back(std::unique_ptr<char[]>(new char[arena_chunk_size]));
+				arena_chunk_used = 0;
+			}
+			Entry *entry = (Entry *)(void *)(arena_chunks.back().get() + arena_chunk_used);
+			arena_chunk_used += size;
+			return entry;
+		}
+
+	}
+
+	void Load()
+	{
+		tables.push_back(std::unique_ptr<HashTable>(new HashTable(INITIAL_TABLE_SIZE)));
+		current_table.store(tables.back().get(), std::memory_order_release);
+	}
+
+	void Unload()
+	{
+		current_table.store(NULL);
+		const cell last_id = num_ids.exchange(0);
+		for (size_t i = 0; i <= ((size_t)last_id >> ID_SEGMENT_BITS); ++i)
+			delete[] id_segments[i].exchange(NULL);
+		tables.clear();
+		arena_chunks.clear();
+		arena_chunk_used = arena_chunk_size = 0;
+	}
+
+	cell Find(const cell str[], size_t len)
+	{
+		const HashTable *table = current_table.load(std::memory_order_acquire);
+		if (table == NULL)
+			return 0;
+		return FindInTable(table, str, len, Hash(str, len));
+	}
+
+	cell Intern(const cell str[], size_t len)
+	{
+		const uint32_t hash = Hash(str, len);
+		HashTable *table = current_table.load(std::memory_order_acquire);
+		if (table == NULL)
+			return 0;
+		cell id = FindInTable(table, str, len, hash);
+		if (id != 0)
+			return id;
+
+		std::lock_guard<std::mutex> lock(write_mutex);
+		table = current_table.load(std::memory_order_relaxed);
+		if ((id = FindInTable(table, str, len, hash)) != 0)
+			return id;
+		id = num_ids.load(std::memory_order_relaxed) + 1;
+		const size_t segment_idx = (size_t)id >> ID_SEGMENT_BITS;
+		if (segment_idx >= MAX_ID_SEGMENTS)
+			return 0;
+
+		Entry *entry = AllocEntry(len);
+		entry->hash = hash;
+		entry->len = (uint32_t)len;
+		memcpy(entry->str, str, len * sizeof(cell));
+		entry->str[len] = 0;
+		EntryPtr *segment = id_segments[segment_idx].load(std::memory_order_relaxed);
+		if (segment == NULL)
+		{
+			segment = new EntryPtr[ID_SEGMENT_SIZE];
+			id_segments[segment_idx].store(segment, std::memory_order_release);
+		}
+		segment[(size_t)id & (ID_SEGMENT_SIZE - 1)].store(entry, std::memory_order_release);
+		num_ids.store(id, std::memory_order_release);
+
+		// Keep the load factor below 1/2.
+		if ((size_t)id * 2 > table->mask + 1)
+		{
+			HashTable *new_table = new HashTable((table->mask + 1) * 2);
+			for (cell i = 1; i < id; ++i)
+				InsertIntoTable(new_table, i, GetEntry(i)->hash);
+			InsertIntoTable(new_table, id, hash);
+			tables.push_back(std::unique_ptr<HashTable>(new_table));
+			current_table.store(new_table, std::memory_order_release);
+		}
+		else
+		{
+			InsertIntoTable(table, id, hash);
+		}
+		return id;
+	}
+
+	const cell *GetString(cell id, size_t &len)
+	{
+		const Entry *entry = GetEntry(id);
+		if (entry == NULL)
+			return NULL;
+		len = (size_t)entry->len;
+		return entry->str;
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_Intern(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_string,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	cellstring::StringArg str;
+	if (!cellstring::GetStringArg(amx, params[arg_string], str, error))
+		return amx_RaiseError(amx, error), 0;
+	return intern::Intern(str.str, str.len);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_InternFind(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_string,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	cellstring::StringArg str;
+	if (!cellstring::GetStringArg(amx, params[arg_string], str, error))
+		return amx_RaiseError(amx, error), 0;
+	return intern::Find(str.str, str.len);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_InternGet(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_id,
+		arg_dest,
+		arg_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell size = params[arg_size];
+	if (size <= 0)
+		return 0;
+	int error;
+	cell *dest = pluginutils::GetArrayAddr(amx, params[arg_dest], (size_t)size, error);
+	if (dest == NULL)
+		return amx_RaiseError(amx, error), 0;
+	size_t len = 0;
+	const cell *str = intern::GetString(params[arg_id], len);
+	if (len > (size_t)size - 1)
+		len = (size_t)size - 1;
+	if (str != NULL)
+		memcpy(dest, str, len * sizeof(cell));
+	dest[len] = 0;
+	return (cell)len;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_InternLength(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_id,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	size_t len;
+	if (intern::GetString(params[arg_id], len) == NULL)
+		return -1;
+	return (cell)len;
+}
@@ -0,0 +1,49 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _INTERN_H
+#define _INTERN_H
+
+#include <cstddef>
+#include "SDK/amx/amx.h"
+
+
+namespace intern
+{
+
+	/*
+		Creates and destroys the string table. The table is shared by all scripts,
+		so the same string gets the same ID in the gamemode and in filterscripts.
+	*/
+	void Load();
+	void Unload();
+
+	/*
+		Returns the ID of a string, adding the string to the table if needed.
+		IDs start from 1 and never change. Returns 0 on failure.
+	*/
+	cell Intern(const cell str[], size_t len);
+
+	/*
+		Returns the ID of a string or 0 if the string is not in the table.
+		Doesn't take any locks, so it's safe to call from any thread.
+	*/
+	cell Find(const cell str[], size_t len);
+
+	/*
+		Returns the string with the specified ID or NULL if the ID is invalid.
+		Doesn't take any locks.
+	*/
+	const cell *GetString(cell id, size_t &len);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_Intern(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_InternFind(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_InternGet(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_InternLength(AMX *amx, cell *params);
+
+
+#endif // _INTERN_H
@@ -0,0 +1,703 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#if defined _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <io.h>
+#else
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "kvstore.h"
+#include "cellstring.h"
+#include "metrics.h"
+#include "pluginconfig.h"
+#include "pluginutils.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace kvstore
+{
+
+	namespace
+	{
+
+		/*
+			Log record layout: RecordHeader, the key characters, then the value
+			as 32-bit cells. The checksum covers everything after itself.
+			A record that fails the check ends the log (torn write).
+		*/
+		struct RecordHeader
+		{
+			uint32_t checksum;
+			uint8_t op;
+			uint8_t type;
+			uint16_t reserved;
+			uint32_t key_len;
+			uint32_t value_len;
+		};
+
+		enum RecordOp
+		{
+			OP_SET = 1,
+			OP_DELETE = 2
+		};
+
+		enum ValueType
+		{
+			VALUE_INT,
+			VALUE_STRING
+		};
+
+		// Don't compact logs smaller than this, no matter how much garbage they have.
+		const size_t COMPACTION_MIN_LOG_SIZE = 1024 * 1024;
+		// Check the clock every this many keys while compacting.
+		const size_t COMPACTION_CLOCK_INTERVAL = 64;
+
+		struct Value
+		{
+			ValueType type;
+			std::vector<cell> data;
+		};
+
+		typedef std::unordered_map<std::string, Value> Entries;
+
+		struct Compaction
+		{
+			bool active;
+			std::vector<std::string> keys;
+			size_t next_key;
+			std::vector<char> data;
+			// Records written since the compaction started; they're appended
+			// to the snapshot so that no change is lost.
+			std::vector<char> tail;
+		};
+
+		// The index is only accessed by the server thread.
+		Entries entries;
+		Compaction compaction;
+		size_t live_size = 0;
+		size_t log_size = 0;
+
+		// Shared with the writer thread.
+		std::mutex writer_mutex;
+		std::condition_variable writer_cond;
+		std::vector<char> pending;
+		std::vector<char> rewrite;
+		bool rewrite_requested = false;
+		bool stopping = false;
+		std::thread writer;
+		std::atomic<bool> write_failed(false);
+
+		// Set while the log file can't be opened. Changes are refused then,
+		// so that the data in memory doesn't drift away from the data on disk,
+		// and the writer thread tries to open the file again once in a while.
+		std::atomic<bool> log_unavailable(false);
+		std::atomic<bool> log_reopened(false);
+		bool log_unavailable_reported = false; // Server thread.
+		const std::chrono::seconds LOG_REOPEN_INTERVAL(5);
+
+		// Updated by the writer thread.
+		MetricsEntry *commits;
+		MetricsEntry *commit_bytes;
+		// Updated by the server thread.
+		MetricsEntry *log_size_gauge;
+
+		// Used by the writer thread (and by Load before it starts).
+		FILE *log_file = NULL;
+		size_t log_file_size = 0; // Up to the end of the last complete record.
+
+		uint32_t Checksum(const char *data, size_t size)
+		{
+			uint32_t hash = 2166136261u;
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= (unsigned char)data[i];
+				hash *= 16777619u;
+			}
+			return hash;
+		}
+
+		size_t GetRecordSize(const std::string &key, const Value *value)
+		{
+			return sizeof(RecordHeader) + key.length() +
+				((value != NULL) ? value->data.size() * sizeof(int32_t) : 0);
+		}
+
+		void AppendRecord(std::vector<char> &buffer, const std::string &key, const Value *value)
+		{
+			RecordHeader header;
+			header.op = (value != NULL) ? OP_SET : OP_DELETE;
+			header.type = (value != NULL) ? (uint8_t)value->type : 0;
+			header.reserved = 0;
+			header.key_len = (uint32_t)key.length();
+			header.value_len = (value != NULL) ? (uint32_t)value->data.size() : 0;
+
+			const size_t start = buffer.size();
+			buffer.resize(start + GetRecordSize(key, value));
+			char *record = &buffer[start];
+			memcpy(record, &header, sizeof(header));
+			memcpy(record + sizeof(header), key.data(), key.length());
+			if (header.value_len != 0)
+			{
+				memcpy(record + sizeof(header) + key.length(),
+					&value->data[0], value->data.size() * sizeof(int32_t));
+			}
+			header.checksum = Checksum(record + sizeof(uint32_t),
+				buffer.size() - start - sizeof(uint32_t));
+			memcpy(record, &header.checksum, sizeof(header.checksum));
+		}
+
+		/*
+			Replays the records and returns the size of the valid part of the log.
+		*/
+		size_t Replay(const std::vector<char> &log)
+		{
+			size_t offset = 0;
+			while (log.size() - offset >= sizeof(RecordHeader))
+			{
+				RecordHeader header;
+				memcpy(&header, &log[offset], sizeof(header));
+				const size_t remaining = log.size() - offset - sizeof(header);
+				if ((header.op != OP_SET && header.op != OP_DELETE) ||
+					header.key_len > remaining ||
+					header.value_len > (remaining - header.key_len) / sizeof(int32_t))
+					break;
+				const size_t size = sizeof(header) + header.key_len + header.value_len * sizeof(int32_t);
+				if (Checksum(&log[offset + sizeof(uint32_t)], size - sizeof(uint32_t)) != header.checksum)
+					break;
+				const std::string key(&log[offset + sizeof(header)], header.key_len);
+				Entries::iterator it = entries.find(key);
+				if (it != entries.end())
+				{
+					live_size -= GetRecordSize(key, &it->second);
+					if (header.op == OP_DELETE)
+						entries.erase(it);
+				}
+				if (header.op == OP_SET)
+				{
+					Value &value = entries[key];
+					value.type = (header.type == VALUE_STRING) ? VALUE_STRING : VALUE_INT;
+					value.data.resize(header.value_len);
+					if (header.value_len != 0)
+					{
+						memcpy(&value.data[0], &log[offset + sizeof(header) + header.key_len],
+							header.value_len * sizeof(int32_t));
+					}
+					live_size += GetRecordSize(key, &value);
+				}
+				offset += size;
+			}
+			return offset;
+		}
+
+		bool Sync(FILE *file)
+		{
+			if (fflush(file) != 0)
+				return false;
+#if defined _WIN32
+			return _commit(_fileno(file)) == 0;
+#else
+			return fsync(fileno(file)) == 0;
+#endif
+		}
+
+		bool WriteData(FILE *file, const std::vector<char> &data)
+		{
+			return data.empty() || fwrite(&data[0], 1, data.size(), file) == data.size();
+		}
+
+		/*
+			Atomically replaces the log with 'data' followed by 'extra'.
+		*/
+		bool ReplaceLog(const std::vector<char> &data, const std::vector<char> &extra)
+		{
+			const std::string tmp_path = std::string(PLUGIN_KVSTORE_FILE) + ".tmp";
+			FILE *file = fopen(tmp_path.c_str(), "wb");
+			if (file == NULL)
+				return false;
+			const bool ok = WriteData(file, data) && WriteData(file, extra) && Sync(file);
+			if (fclose(file) != 0 || !ok)
+				return false;
+#if defined _WIN32
+			return MoveFileExA(tmp_path.c_str(), PLUGIN_KVSTORE_FILE,
+				MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+			return rename(tmp_path.c_str(), PLUGIN_KVSTORE_FILE) == 0;
+#endif
+		}
+
+		/*
+			Opens the log for appending and cuts off whatever follows the last
+			complete record, e.g. the part of a record a failed write left.
+			Sets or clears log_unavailable.
+		*/
+		bool OpenLog()
+		{
+			bool ok = (log_file = fopen(PLUGIN_KVSTORE_FILE, "ab")) != NULL;
+			if (ok)
+			{
+#if defined _WIN32
+				const int fd = _fileno(log_file);
+				const __int64 file_size = _filelengthi64(fd);
+				ok = file_size >= 0 && ((size_t)file_size <= log_file_size || _chsize_s(fd, (__int64)log_file_size) == 0);
+#else
+				const int fd = fileno(log_file);
+				struct stat file_stat;
+				file_stat.st_size = 0;
+				ok = fstat(fd, &file_stat) == 0 &&
+					((size_t)file_stat.st_size <= log_file_size || ftruncate(fd, (off_t)log_file_size) == 0);
+				const size_t file_size = (size_t)file_stat.st_size;
+#endif
+				// The file may have been cut (or removed) by someone else.
+				if (ok && (size_t)file_size < log_file_size)
+					log_file_size = (size_t)file_size;
+				if (!ok)
+				{
+					fclose(log_file);
+					log_file = NULL;
+				}
+			}
+			if (ok && log_unavailable)
+				log_reopened = true;
+			log_unavailable = !ok;
+			return ok;
+		}
+
+		/*
+			Writes the records collected since the last commit with a single
+			write and fsync (group commit), or swaps in the compacted log.
+			Returns false if the data couldn't be written: the log is then cut
+			back to its last complete record, and the caller keeps the data
+			for the next commit.
+		*/
+		bool Commit(const std::vector<char> &data, const std::vector<char> &new_log, bool replace)
+		{
+			if (replace)
+			{
+				if (log_file != NULL)
+				{
+					fclose(log_file);
+					log_file = NULL;
+				}
+				if (ReplaceLog(new_log, data))
+				{
+					log_file_size = new_log.size() + data.size();
+					OpenLog();
+					return true;
+				}
+				// If the log couldn't be replaced, append to the old one:
+				// replaying the snapshot on top of it gives the same result.
+				if (!OpenLog())
+					return false;
+				if (WriteData(log_file, new_log) && WriteData(log_file, data) && Sync(log_file))
+				{
+					log_file_size += new_log.size() + data.size();
+					return true;
+				}
+			}
+			else
+			{
+				if (log_file == NULL)
+					return false;
+				if (WriteData(log_file, data) && Sync(log_file))
+				{
+					log_file_size += data.size();
+					return true;
+				}
+			}
+			// Replaying stops at a torn record, so the records appended after
+			// it would be lost.
+			fclose(log_file);
+			log_file = NULL;
+			OpenLog();
+			return false;
+		}
+
+		void WriterThread()
+		{
+			typedef std::chrono::steady_clock Clock;
+			// Kept until they're written.
+			std::vector<char> data, new_log;
+			bool replace = false;
+			bool failed = false;
+			Clock::time_point last_attempt = Clock::now();
+			std::unique_lock<std::mutex> lock(writer_mutex);
+			for (;;)
+			{
+				writer_cond.wait_for(lock, std::chrono::milliseconds(PLUGIN_KVSTORE_COMMIT_INTERVAL),
+					[] { return stopping; });
+				if (rewrite_requested)
+				{
+					// The snapshot has all the changes, including those that
+					// couldn't be written yet, and it's followed by 'pending'.
+					new_log.swap(rewrite);
+					rewrite.clear();
+					data.clear();
+					replace = true;
+					rewrite_requested = false;
+				}
+				if (data.empty())
+					data.swap(pending);
+				else
+					data.insert(data.end(), pending.begin(), pending.end());
+				pending.clear();
+				const bool stop = stopping;
+				lock.unlock();
+
+				// After a failure, wait a bit before trying again.
+				const bool retry = !failed || stop || Clock::now() - last_attempt >= LOG_REOPEN_INTERVAL;
+				if (retry && log_unavailable && !replace)
+				{
+					last_attempt = Clock::now();
+					OpenLog();
+				}
+				if (retry && (replace || !data.empty()) && (!log_unavailable || replace))
+				{
+					metrics::Increment(commits);
+					metrics::Record(commit_bytes, (uint64_t)(data.size() + new_log.size()));
+					last_attempt = Clock::now();
+					failed = !Commit(data, new_log, replace);
+					if (failed)
+					{
+						write_failed = true;
+					}
+					else
+					{
+						data.clear();
+						new_log.clear();
+						replace = false;
+					}
+				}
+
+				lock.lock();
+				if (stop)
+					break;
+			}
+		}
+
+		void Write(const std::string &key, const Value *value)
+		{
+			{
+				std::lock_guard<std::mutex> lock(writer_mutex);
+				AppendRecord(pending, key, value);
+			}
+			if (compaction.active)
+				AppendRecord(compaction.tail, key, value);
+			log_size += GetRecordSize(key, value);
+		}
+
+		bool Set(const std::string &key, ValueType type, const cell *data, size_t size)
+		{
+			if (log_unavailable)
+				return false;
+			const std::pair<Entries::iterator, bool> result = entries.insert(std::make_pair(key, Value()));
+			Value &value = result.first->second;
+			if (!result.second)
+				live_size -= GetRecordSize(key, &value);
+			value.type = type;
+			value.data.assign(data, data + size);
+			live_size += GetRecordSize(key, &value);
+			Write(key, &value);
+			return true;
+		}
+
+		bool Delete(const std::string &key)
+		{
+			Entries::iterator it = entries.find(key);
+			if (log_unavailable || it == entries.end())
+				return false;
+			live_size -= GetRecordSize(key, &it->second);
+			entries.erase(it);
+			Write(key, NULL);
+			return true;
+		}
+
+		const Value *Get(const std::string &key)
+		{
+			Entries::const_iterator it = entries.find(key);
+			return (it != entries.end()) ? &it->second : NULL;
+		}
+
+		void StartCompaction()
+		{
+			compaction.active = true;
+			compaction.keys.clear();
+			compaction.keys.reserve(entries.size());
+			for (Entries::const_iterator it = entries.begin(); it != entries.end(); ++it)
+				compaction.keys.push_back(it->first);
+			compaction.next_key = 0;
+			compaction.data.clear();
+			compaction.data.reserve(live_size);
+			compaction.tail.clear();
+		}
+
+		void FinishCompaction()
+		{
+			compaction.data.insert(compaction.data.end(), compaction.tail.begin(), compaction.tail.end());
+			log_size = compaction.data.size();
+			{
+				std::lock_guard<std::mutex> lock(writer_mutex);
+				// Everything that hasn't been committed yet is in the new log.
+				pending.clear();
+				rewrite.swap(compaction.data);
+				rewrite_requested = true;
+			}
+			compaction.active = false;
+			std::vector<std::string>().swap(compaction.keys);
+			std::vector<char>().swap(compaction.data);
+			std::vector<char>().swap(compaction.tail);
+		}
+
+		bool GetKey(AMX *amx, cell address, std::string &key)
+		{
+			int error;
+			char *str = pluginutils::GetCString(amx, address, error);
+			if (error != AMX_ERR_NONE)
+				return amx_RaiseError(amx, error), false;
+			key = str;
+			free(str);
+			return true;
+		}
+
+	}
+
+	void Load()
+	{
+		std::vector<char> log;
+		if (FILE *file = fopen(PLUGIN_KVSTORE_FILE, "rb"))
+		{
+			char buffer[64 * 1024];
+			size_t num_read;
+			while ((num_read = fread(buffer, 1, sizeof(buffer), file)) != 0)
+				log.insert(log.end(), buffer, buffer + num_read);
+			fclose(file);
+		}
+		const size_t valid_size = Replay(log);
+		log_size = valid_size;
+		if (valid_size != log.size())
+		{
+			// OpenLog cuts off the torn record, otherwise the records appended
+			// after it would be lost.
+			logprintf("%s: Discarded %u corrupt bytes at the end of \"%s\".", PLUGIN_NAME,
+				(unsigned)(log.size() - valid_size), PLUGIN_KVSTORE_FILE);
+		}
+		std::vector<char>().swap(log);
+
+		log_file_size = valid_size;
+		log_unavailable = false;
+		OpenLog();
+		log_reopened = false;
+		log_unavailable_reported = (log_file == NULL);
+		if (log_file == NULL)
+		{
+			logprintf("%s: Can't open \"%s\" for writing, changes are refused until it can be opened.",
+				PLUGIN_NAME, PLUGIN_KVSTORE_FILE);
+		}
+		compaction.active = false;
+		commits = metrics::AddCounter("kvstore.commits");
+		commit_bytes = metrics::AddHistogram("kvstore.commit_bytes");
+		log_size_gauge = metrics::AddGauge("kvstore.log_size");
+		stopping = false;
+		writer = std::thread(WriterThread);
+	}
+
+	void Unload()
+	{
+		{
+			std::lock_guard<std::mutex> lock(writer_mutex);
+			stopping = true;
+		}
+		writer_cond.notify_one();
+		if (writer.joinable())
+			writer.join();
+		if (log_file != NULL)
+		{
+			fclose(log_file);
+			log_file = NULL;
+		}
+		if (write_failed.exchange(false))
+			logprintf("%s: Failed to write \"%s\".", PLUGIN_NAME, PLUGIN_KVSTORE_FILE);
+		Entries().swap(entries);
+		compaction.active = false;
+		live_size = log_size = 0;
+	}
+
+	void ProcessTick()
+	{
+		if (write_failed.exchange(false))
+			logprintf("%s: Failed to write \"%s\".", PLUGIN_NAME, PLUGIN_KVSTORE_FILE);
+		if (log_reopened.exchange(false))
+		{
+			logprintf("%s: \"%s\" can be written again.", PLUGIN_NAME, PLUGIN_KVSTORE_FILE);
+			log_unavailable_reported = false;
+		}
+		if (log_unavailable && !log_unavailable_reported)
+		{
+			logprintf("%s: Can't open \"%s\" for writing, changes are refused until it can be opened.",
+				PLUGIN_NAME, PLUGIN_KVSTORE_FILE);
+			log_unavailable_reported = true;
+		}
+		metrics::Set(log_size_gauge, (int64_t)log_size);
+		if (!compaction.active)
+		{
+			if (log_unavailable || log_size < COMPACTION_MIN_LOG_SIZE || log_size / 2 < live_size)
+				return;
+			StartCompaction();
+		}
+
+		typedef std::chrono::steady_clock Clock;
+		const Clock::time_point deadline = Clock::now() +
+			std::chrono::microseconds(PLUGIN_KVSTORE_COMPACTION_BUDGET);
+		while (compaction.next_key < compaction.keys.size())
+		{
+			// Keys deleted since the compaction started are skipped, and the values
+			// changed since then are also in the tail, so the latest value wins.
+			const std::string &key = compaction.keys[compaction.next_key++];
+			if (const Value *value = Get(key))
+				AppendRecord(compaction.data, key, value);
+			if (compaction.next_key % COMPACTION_CLOCK_INTERVAL == 0 && Clock::now() >= deadline)
+				return;
+		}
+		FinishCompaction();
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_KVSet(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_key,
+		arg_value,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	std::string key;
+	if (!kvstore::GetKey(amx, params[arg_key], key))
+		return 0;
+	int error;
+	cellstring::StringArg value;
+	if (!cellstring::GetStringArg(amx, params[arg_value], value, error))
+		return amx_RaiseError(amx, error), 0;
+	return kvstore::Set(key, kvstore::VALUE_STRING, value.str, value.len) ? 1 : 0;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_KVGet(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_key,
+		arg_dest,
+		arg_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell size = params[arg_size];
+	if (size <= 0)
+		return 0;
+	int error;
+	cell *dest = pluginutils::GetArrayAddr(amx, params[arg_dest], (size_t)size, error);
+	if (dest == NULL)
+		return amx_RaiseError(amx, error), 0;
+	dest[0] = 0;
+	std::string key;
+	if (!kvstore::GetKey(amx, params[arg_key], key))
+		return 0;
+	const kvstore::Value *value = kvstore::Get(key);
+	if (value == NULL || value->type != kvstore::VALUE_STRING)
+		return 0;
+	const size_t len = std::min(value->data.size(), (size_t)size - 1);
+	if (len != 0)
+		memcpy(dest, &value->data[0], len * sizeof(cell));
+	dest[len] = 0;
+	return (cell)len;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_KVSetInt(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_key,
+		arg_value,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	std::string key;
+	if (!kvstore::GetKey(amx, params[arg_key], key))
+		return 0;
+	return kvstore::Set(key, kvstore::VALUE_INT, &params[arg_value], 1) ? 1 : 0;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_KVGetInt(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_key,
+		arg_default,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	std::string key;
+	if (!kvstore::GetKey(amx, params[arg_key], key))
+		return 0;
+	const kvstore::Value *value = kvstore::Get(key);
+	if (value == NULL || value->type != kvstore::VALUE_INT || value->data.size() != 1)
+		return params[arg_default];
+	return value->data[0];
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_KVDelete(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_key,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	std::string key;
+	if (!kvstore::GetKey(amx, params[arg_key], key))
+		return 0;
+	return kvstore::Delete(key) ? 1 : 0;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_KVExists(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_key,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	std::string key;
+	if (!kvstore::GetKey(amx, params[arg_key], key))
+		return 0;
+	return (kvstore::Get(key) != NULL) ? 1 : 0;
+}
@@ -0,0 +1,42 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _KVSTORE_H
+#define _KVSTORE_H
+
+#include "SDK/amx/amx.h"
+
+
+namespace kvstore
+{
+
+	/*
+		Replays the log file (PLUGIN_KVSTORE_FILE) into memory
+		and starts the writer thread.
+	*/
+	void Load();
+
+	/*
+		Commits everything that hasn't been written yet and stops the writer thread.
+	*/
+	void Unload();
+
+	/*
+		Runs a slice of the log compaction (at most PLUGIN_KVSTORE_COMPACTION_BUDGET
+		microseconds per call) when the log has grown much larger than the data.
+	*/
+	void ProcessTick();
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_KVSet(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_KVGet(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_KVSetInt(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_KVGetInt(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_KVDelete(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_KVExists(AMX *amx, cell *params);
+
+
+#endif // _KVSTORE_H
@@ -0,0 +1,309 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#if defined _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <sys/utime.h>
+#else
+	#include <dirent.h>
+	#include <sys/stat.h>
+	#include <sys/types.h>
+	#include <utime.h>
+#endif
+#include <cstdio>
+#include <ctime>
+#include "loadcache.h"
+#include "mappedfile.h"
+#include "pluginconfig.h"
+
+
+namespace loadcache
+{
+
+	namespace
+	{
+
+		/*
+			Layout of a cache file. All numbers are in the byte order of the host.
+
+				CacheHeader
+				for each section:
+					CacheSection
+					the data, padded with zeros to a multiple of 4 bytes
+
+			'checksum' is the hash of everything after the header, so a file
+			that wasn't written completely is ignored.
+		*/
+		const char CACHE_MAGIC[4] = { 'H', 'W', 'L', 'C' };
+		const uint32_t CACHE_FORMAT_VERSION = 2;
+
+		struct CacheHeader
+		{
+			char magic[4];
+			uint32_t version;
+			int32_t plugin_version; // The sections are only valid for the plugin that wrote them.
+			uint32_t num_sections;
+			uint64_t key;
+			uint64_t checksum;
+		};
+
+		struct CacheSection
+		{
+			uint32_t id;
+			uint32_t size;
+		};
+
+		struct Entry
+		{
+			Section section;
+			std::vector<char> data;
+		};
+
+		// The script being loaded.
+		bool loading;
+		uint64_t key;
+		MappedFile file;
+		std::vector<Entry> entries; // Read from the file or stored during this load.
+		bool dirty;
+
+		/*
+			64-bit FNV-1a over 32-bit words: the tables are hashed on every
+			load, so it should take much less time than the work it saves.
+		*/
+		uint64_t Hash(uint64_t hash, const void *data, size_t size)
+		{
+			const uint64_t prime = 1099511628211ull;
+			const unsigned char *bytes = (const unsigned char *)data;
+			size_t i = 0;
+			for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t))
+			{
+				uint32_t word;
+				memcpy(&word, bytes + i, sizeof(word));
+				hash = (hash ^ word) * prime;
+			}
+			for (; i < size; ++i)
+				hash = (hash ^ bytes[i]) * prime;
+			return hash;
+		}
+
+		const uint64_t HASH_START = 14695981039346656037ull;
+
+		const char CACHE_FILE_EXT[] = ".cache";
+		const char TMP_FILE_EXT[] = ".cache.tmp";
+
+		bool HasExt(const std::string &name, const char *ext)
+		{
+			const size_t ext_length = strlen(ext);
+			return name.length() > ext_length && name.compare(name.length() - ext_length, ext_length, ext) == 0;
+		}
+
+		/*
+			Removes a cache file (or a temporary file left by a crash) that
+			hasn't been used for PLUGIN_CACHE_MAX_AGE days. Used files are
+			touched when they're read, so these belong to scripts that were
+			changed or removed since.
+		*/
+		void EvictFile(const std::string &name, time_t modified, time_t now)
+		{
+			if (!HasExt(name, CACHE_FILE_EXT) && !HasExt(name, TMP_FILE_EXT))
+				return;
+			if (now - modified > (time_t)PLUGIN_CACHE_MAX_AGE * 24 * 60 * 60)
+				remove((PLUGIN_CACHE_DIR + ("/" + name)).c_str());
+		}
+
+		std::string GetPath(uint64_t file_key)
+		{
+			char name[32];
+			snprintf(name, sizeof(name), "/%016llx.cache", (unsigned long long)file_key);
+			return PLUGIN_CACHE_DIR + std::string(name);
+		}
+
+		/*
+			Checks the header, the checksum and the section sizes, and copies
+			the sections, so they're kept if the file is written again with
+			another section (and the file isn't mapped while it's replaced).
+		*/
+		bool ReadFile()
+		{
+			const char *data = (const char *)file.GetData();
+			const size_t size = file.GetSize();
+			if (size < sizeof(CacheHeader))
+				return false;
+			CacheHeader header;
+			memcpy(&header, data, sizeof(header));
+			if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+				header.version != CACHE_FORMAT_VERSION || header.plugin_version != PLUGIN_VERSION ||
+				header.key != key ||
+				header.checksum != Hash(HASH_START, data + sizeof(header), size - sizeof(header)))
+			{
+				return false;
+			}
+			Reader reader(data + sizeof(header), size - sizeof(header));
+			for (uint32_t i = 0; i < header.num_sections; ++i)
+			{
+				CacheSection section;
+				if (!reader.Get(section) || !reader.CanHold(section.size, 1))
+					return false;
+				entries.push_back(Entry());
+				entries.back().section = (Section)section.id;
+				entries.back().data.resize(section.size);
+				char padding[3];
+				if (!reader.GetBytes(entries.back().data.data(), section.size) ||
+					!reader.GetBytes(padding, (4 - section.size % 4) % 4))
+				{
+					return false;
+				}
+			}
+			return reader.AtEnd();
+		}
+
+		bool WriteFile()
+		{
+			Writer body;
+			for (size_t i = 0; i < entries.size(); ++i)
+			{
+				const CacheSection section = { (uint32_t)entries[i].section, (uint32_t)entries[i].data.size() };
+				body.Put(section);
+				body.PutBytes(entries[i].data.data(), entries[i].data.size());
+				const char padding[3] = { 0, 0, 0 };
+				body.PutBytes(padding, (4 - section.size % 4) % 4);
+			}
+			CacheHeader header;
+			memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+			header.version = CACHE_FORMAT_VERSION;
+			header.plugin_version = PLUGIN_VERSION;
+			header.num_sections = (uint32_t)entries.size();
+			header.key = key;
+			header.checksum = Hash(HASH_START, body.GetData().data(), body.GetData().size());
+
+#if defined _WIN32
+			CreateDirectoryA(PLUGIN_CACHE_DIR, NULL);
+#else
+			mkdir(PLUGIN_CACHE_DIR, 0755);
+#endif
+			// The file may be mapped by another server loading the same script,
+			// so it's replaced rather than overwritten.
+			const std::string path = GetPath(key);
+			const std::string tmp_path = path + ".tmp";
+			FILE *tmp_file = fopen(tmp_path.c_str(), "wb");
+			if (tmp_file == NULL)
+				return false;
+			const bool ok = fwrite(&header, sizeof(header), 1, tmp_file) == 1 &&
+				fwrite(body.GetData().data(), 1, body.GetData().size(), tmp_file) == body.GetData().size();
+			if (fclose(tmp_file) != 0 || !ok)
+			{
+				remove(tmp_path.c_str());
+				return false;
+			}
+#if defined _WIN32
+			return MoveFileExA(tmp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+			return rename(tmp_path.c_str(), path.c_str()) == 0;
+#endif
+		}
+
+	}
+
+	void Load()
+	{
+		if (PLUGIN_CACHE_DIR[0] == '\0' || PLUGIN_CACHE_MAX_AGE == 0)
+			return;
+		const std::string dir(PLUGIN_CACHE_DIR);
+#if defined _WIN32
+		FILETIME now_filetime;
+		GetSystemTimeAsFileTime(&now_filetime);
+		const ULONGLONG now = ((ULONGLONG)now_filetime.dwHighDateTime << 32) | now_filetime.dwLowDateTime;
+		WIN32_FIND_DATAA find_data;
+		const HANDLE find_handle = FindFirstFileA((dir + "\\*").c_str(), &find_data);
+		if (find_handle == INVALID_HANDLE_VALUE)
+			return;
+		do
+		{
+			// FILETIME counts 100-nanosecond intervals.
+			const ULONGLONG modified = ((ULONGLONG)find_data.ftLastWriteTime.dwHighDateTime << 32) |
+				find_data.ftLastWriteTime.dwLowDateTime;
+			EvictFile(find_data.cFileName, (time_t)(modified / 10000000), (time_t)(now / 10000000));
+		} while (FindNextFileA(find_handle, &find_data));
+		FindClose(find_handle);
+#else
+		DIR *dir_handle = opendir(dir.c_str());
+		if (dir_handle == NULL)
+			return;
+		const time_t now = time(NULL);
+		while (struct dirent *entry = readdir(dir_handle))
+		{
+			struct stat file_stat;
+			if (stat((dir + "/" + entry->d_name).c_str(), &file_stat) == 0)
+				EvictFile(entry->d_name, file_stat.st_mtime, now);
+		}
+		closedir(dir_handle);
+#endif
+	}
+
+	void BeginAmxLoad(AMX *amx)
+	{
+		entries.clear();
+		dirty = false;
+		loading = (PLUGIN_CACHE_DIR[0] != '\0');
+		if (!loading)
+			return;
+		const AMX_HEADER *hdr = (const AMX_HEADER *)amx->base;
+		// The command table depends on the prefix and the publics. The native
+		// table isn't hashed: amx_Register has written the addresses of the
+		// natives into it, which change from one run to the next. The names
+		// of the natives are in the name table.
+		key = Hash(HASH_START, PLUGIN_COMMAND_PREFIX, sizeof(PLUGIN_COMMAND_PREFIX));
+		key = Hash(key, hdr, sizeof(AMX_HEADER));
+		key = Hash(key, amx->base + (size_t)hdr->publics, (size_t)(hdr->natives - hdr->publics));
+		if (hdr->defsize == (int16_t)sizeof(AMX_FUNCSTUBNT))
+			key = Hash(key, amx->base + (size_t)hdr->nametable, (size_t)(hdr->cod - hdr->nametable));
+		const std::string path = GetPath(key);
+		if (file.Open(path.c_str()))
+		{
+			if (!ReadFile())
+				entries.clear();
+			file.Close();
+#if defined _WIN32
+			_utime(path.c_str(), NULL);
+#else
+			utime(path.c_str(), NULL);
+#endif
+		}
+	}
+
+	void EndAmxLoad()
+	{
+		if (loading && dirty)
+			WriteFile();
+		entries.clear();
+		loading = false;
+	}
+
+	bool Find(Section section, const char *&data, size_t &size)
+	{
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			if (entries[i].section == section)
+			{
+				data = entries[i].data.data();
+				size = entries[i].data.size();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Store(Section section, const std::vector<char> &data)
+	{
+		if (!loading)
+			return;
+		Entry entry;
+		entry.section = section;
+		entry.data = data;
+		entries.push_back(entry);
+		dirty = true;
+	}
+
+}
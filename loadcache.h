@@ -0,0 +1,144 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _LOADCACHE_H
+#define _LOADCACHE_H
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "SDK/amx/amx.h"
+
+
+/*
+	Keeps what the plugin computes for a script when it's loaded in a file
+	in PLUGIN_CACHE_DIR, named after a hash of the script's header, public
+	table and name table. When the same script is loaded again (e.g. after a
+	server restart) the results are read from the file (memory-mapped) instead.
+
+	Only what depends on these tables alone is cached (the command table),
+	not the analysis of the code (codeanalysis.h): hashing the code would
+	mean decoding it, as amx_Init turns it into threaded code, and that
+	takes about as long as analyzing it. Files that weren't used for PLUGIN_CACHE_MAX_AGE days are removed when
+	the plugin is loaded.
+
+	The modules look up their section between BeginAmxLoad and EndAmxLoad,
+	and store it if it isn't there. The file is written (to a temporary file
+	that then replaces the old one) when a section was stored.
+*/
+namespace loadcache
+{
+
+	enum Section
+	{
+		SECTION_COMMANDS = 1
+	};
+
+	/*
+		Removes the cache files that weren't used for a while.
+	*/
+	void Load();
+
+	/*
+		Hashes the script and reads its cache file if there's one.
+		Call before the AmxLoad of the modules that use the cache.
+	*/
+	void BeginAmxLoad(AMX *amx);
+
+	/*
+		Writes the cache file if a section was stored.
+	*/
+	void EndAmxLoad();
+
+	/*
+		Returns false if the section isn't in the cache.
+	*/
+	bool Find(Section section, const char *&data, size_t &size);
+
+	void Store(Section section, const std::vector<char> &data);
+
+	/*
+		Builds a section out of numbers and strings (in the byte order of the host).
+	*/
+	class Writer
+	{
+	public:
+		template <typename T>
+		void Put(T value)
+		{
+			PutBytes(&value, sizeof(value));
+		}
+
+		void PutString(const std::string &str)
+		{
+			Put((uint32_t)str.length());
+			PutBytes(str.data(), str.length());
+		}
+
+		void PutBytes(const void *bytes, size_t size)
+		{
+			data.insert(data.end(), (const char *)bytes, (const char *)bytes + size);
+		}
+
+		const std::vector<char> &GetData() const { return data; }
+
+	private:
+		std::vector<char> data;
+	};
+
+	/*
+		Reads a section built by Writer. Every Get fails once the data runs out.
+	*/
+	class Reader
+	{
+	public:
+		Reader(const char *data, size_t size) : data(data), end(data + size) {}
+
+		template <typename T>
+		bool Get(T &value)
+		{
+			return GetBytes(&value, sizeof(value));
+		}
+
+		bool GetString(std::string &str)
+		{
+			uint32_t length;
+			if (!Get(length) || length > (size_t)(end - data))
+				return false;
+			str.assign(data, (size_t)length);
+			data += length;
+			return true;
+		}
+
+		bool GetBytes(void *bytes, size_t size)
+		{
+			if (size > (size_t)(end - data))
+				return false;
+			memcpy(bytes, data, size);
+			data += size;
+			return true;
+		}
+
+		/*
+			Checks that a count read from the data isn't larger than the rest
+			of it, before reserving memory for that many items.
+		*/
+		bool CanHold(uint32_t count, size_t item_size) const
+		{
+			return count <= (size_t)(end - data) / item_size;
+		}
+
+		bool AtEnd() const { return data == end; }
+
+	private:
+		const char *data;
+		const char *end;
+	};
+
+}
+
+
+#endif // _LOADCACHE_H
@@ -9,8 +9,31 @@
 #include "SDK/plugincommon.h"
 #include "pluginconfig.h"
 #include "pluginutils.h"
-
-#define CheckArgs() pluginutils::CheckNumberOfArguments(amx, params, num_args_expected)
+#include "sorting.h"
+#include "cellstring.h"
+#include "commands.h"
+#include "intern.h"
+#include "segments.h"
+#include "scripts.h"
+#include "remotecall.h"
+#include "datatables.h"
+#include "kvstore.h"
+#include "serialize.h"
+#include "cellformat.h"
+#include "cellregex.h"
+#include "nativecache.h"
+#include "batch.h"
+#include "recorder.h"
+#include "nativethunks.h"
+#include "memmonitor.h"
+#include "exechook.h"
+#include "watchdog.h"
+#include "metrics.h"
+#include "codeanalysis.h"
+#include "callpatch.h"
+#include "loadcache.h"
+#include "callbackfilter.h"
+#include "threadpool.h"
 
 
 extern void *pAMXFunctions;
@@ -76,20 +99,72 @@ static cell AMX_NATIVE_CALL n_HelloWorld_CheckArgsTest(AMX *amx, cell *params)
 	return 1;
 }
 
-static AMX_NATIVE orig_IsPlayerConnected;
-static cell AMX_NATIVE_CALL hook_IsPlayerConnected(AMX *amx, cell *params)
-{
-	logprintf("Hello from hook_IsPlayerConnected");
-	return orig_IsPlayerConnected(amx, params);
-}
-
 
 static AMX_NATIVE_INFO plugin_natives[] =
 {
 	{ "HelloWorld", n_HelloWorld },
 	{ "HelloWorld_PrintNumber", n_HelloWorld_PrintNumber },
 	{ "HelloWorld_PrintString", n_HelloWorld_PrintString },
-	{ "HelloWorld_CheckArgsTest", n_HelloWorld_CheckArgsTest }
+	{ "HelloWorld_CheckArgsTest", n_HelloWorld_CheckArgsTest },
+	{ "HelloWorld_SortArray", n_HelloWorld_SortArray },
+	{ "HelloWorld_SortFloatArray", n_HelloWorld_SortFloatArray },
+	{ "HelloWorld_SortArrayRows", n_HelloWorld_SortArrayRows },
+	{ "HelloWorld_BinarySearch", n_HelloWorld_BinarySearch },
+	{ "HelloWorld_BinarySearchFloat", n_HelloWorld_BinarySearchFloat },
+	{ "HelloWorld_LinearSearch", n_HelloWorld_LinearSearch },
+	{ "HelloWorld_StrCompare", n_HelloWorld_StrCompare },
+	{ "HelloWorld_StrEqual", n_HelloWorld_StrEqual },
+	{ "HelloWorld_StrFind", n_HelloWorld_StrFind },
+	{ "HelloWorld_StrToken", n_HelloWorld_StrToken },
+	{ "HelloWorld_DispatchCommand", n_HelloWorld_DispatchCommand },
+	{ "HelloWorld_Intern", n_HelloWorld_Intern },
+	{ "HelloWorld_InternFind", n_HelloWorld_InternFind },
+	{ "HelloWorld_InternGet", n_HelloWorld_InternGet },
+	{ "HelloWorld_InternLength", n_HelloWorld_InternLength },
+	{ "HelloWorld_SegmentAttach", n_HelloWorld_SegmentAttach },
+	{ "HelloWorld_SegmentDetach", n_HelloWorld_SegmentDetach },
+	{ "HelloWorld_SegmentSize", n_HelloWorld_SegmentSize },
+	{ "HelloWorld_SegmentVersion", n_HelloWorld_SegmentVersion },
+	{ "HelloWorld_SegmentRead", n_HelloWorld_SegmentRead },
+	{ "HelloWorld_SegmentWrite", n_HelloWorld_SegmentWrite },
+	{ "HelloWorld_SegmentGet", n_HelloWorld_SegmentGet },
+	{ "HelloWorld_SegmentSet", n_HelloWorld_SegmentSet },
+	{ "HelloWorld_RemoteRef", n_HelloWorld_RemoteRef },
+	{ "HelloWorld_CallRemoteRef", n_HelloWorld_CallRemoteRef },
+	{ "HelloWorld_CallRemote", n_HelloWorld_CallRemote },
+	{ "HelloWorld_TableFind", n_HelloWorld_TableFind },
+	{ "HelloWorld_TableRows", n_HelloWorld_TableRows },
+	{ "HelloWorld_TableColumns", n_HelloWorld_TableColumns },
+	{ "HelloWorld_TableColumn", n_HelloWorld_TableColumn },
+	{ "HelloWorld_TableLookup", n_HelloWorld_TableLookup },
+	{ "HelloWorld_TableLookupString", n_HelloWorld_TableLookupString },
+	{ "HelloWorld_TableGetInt", n_HelloWorld_TableGetInt },
+	{ "HelloWorld_TableGetString", n_HelloWorld_TableGetString },
+	{ "HelloWorld_KVSet", n_HelloWorld_KVSet },
+	{ "HelloWorld_KVGet", n_HelloWorld_KVGet },
+	{ "HelloWorld_KVSetInt", n_HelloWorld_KVSetInt },
+	{ "HelloWorld_KVGetInt", n_HelloWorld_KVGetInt },
+	{ "HelloWorld_KVDelete", n_HelloWorld_KVDelete },
+	{ "HelloWorld_KVExists", n_HelloWorld_KVExists },
+	{ "HelloWorld_SerialSchema", n_HelloWorld_SerialSchema },
+	{ "HelloWorld_SerialSchemaSize", n_HelloWorld_SerialSchemaSize },
+	{ "HelloWorld_Serialize", n_HelloWorld_Serialize },
+	{ "HelloWorld_Deserialize", n_HelloWorld_Deserialize },
+	{ "HelloWorld_Format", n_HelloWorld_Format },
+	{ "HelloWorld_RegexCompile", n_HelloWorld_RegexCompile },
+	{ "HelloWorld_RegexGroups", n_HelloWorld_RegexGroups },
+	{ "HelloWorld_RegexMatch", n_HelloWorld_RegexMatch },
+	{ "HelloWorld_RegexSearch", n_HelloWorld_RegexSearch },
+	{ "HelloWorld_RegexMatchAny", n_HelloWorld_RegexMatchAny },
+	{ "HelloWorld_InvalidatePlayer", n_HelloWorld_InvalidatePlayer },
+	{ "HelloWorld_GetNativeIndex", n_HelloWorld_GetNativeIndex },
+	{ "HelloWorld_BatchCall", n_HelloWorld_BatchCall },
+	{ "HelloWorld_GetMemoryUsage", n_HelloWorld_GetMemoryUsage },
+	{ "HelloWorld_ResetMemoryUsage", n_HelloWorld_ResetMemoryUsage },
+	{ "HelloWorld_WriteCodeReport", n_HelloWorld_WriteCodeReport },
+	{ "HelloWorld_ThrottleCallback", n_HelloWorld_ThrottleCallback },
+	{ "HelloWorld_CoalesceCallback", n_HelloWorld_CoalesceCallback },
+	{ "HelloWorld_RemoveCallbackFilter", n_HelloWorld_RemoveCallbackFilter }
 };
 
 
@@ -105,6 +180,16 @@ PLUGIN_EXPORT bool PLUGIN_CALL Load(void **ppData)
 	if (NULL == pAMXFunctions || NULL == logprintf)
 		return false;
 	int plug_ver_major, plug_ver_minor, plug_ver_build;
+	metrics::Load();
+	exechook::Load();
+	watchdog::Load();
+	recorder::Load();
+	nativethunks::WrapNatives(plugin_natives, arraysize(plugin_natives));
+	threadpool::Start(PLUGIN_WORKER_THREADS);
+	intern::Load();
+	datatables::Load();
+	kvstore::Load();
+	loadcache::Load();
 	pluginutils::SplitVersion(PLUGIN_VERSION, plug_ver_major, plug_ver_minor, plug_ver_build);
 	logprintf("  %s plugin v%d.%d.%d is OK", PLUGIN_NAME, plug_ver_major, plug_ver_minor, plug_ver_build);
 	return true;
@@ -112,6 +197,14 @@ PLUGIN_EXPORT bool PLUGIN_CALL Load(void **ppData)
 
 PLUGIN_EXPORT void PLUGIN_CALL Unload()
 {
+	kvstore::Unload();
+	datatables::Unload();
+	intern::Unload();
+	threadpool::Stop();
+	recorder::Unload();
+	watchdog::Unload();
+	exechook::Unload();
+	metrics::Unload();
 	logprintf("  %s plugin was unloaded", PLUGIN_NAME);
 }
 
@@ -120,24 +213,43 @@ PLUGIN_EXPORT int PLUGIN_CALL AmxLoad(AMX *amx)
 	if (!pluginutils::CheckIncludeVersion(amx))
 		return 0;
 	amx_Register(amx, plugin_natives, (int)arraysize(plugin_natives));
-
-	// Native function hooking example.
-	bool native_found = pluginutils::ReplaceNative(
-		amx, "IsPlayerConnected", hook_IsPlayerConnected, &orig_IsPlayerConnected);
-	if (native_found)
-		logprintf("IsPlayerConnected hooked successfully");
-
+	scripts::AmxLoad(amx);
+	watchdog::AmxLoad(amx);
+	codeanalysis::AmxLoad(amx);
+	memmonitor::AmxLoad(amx);
+	loadcache::BeginAmxLoad(amx);
+	commands::AmxLoad(amx);
+	loadcache::EndAmxLoad();
+	segments::AmxLoad(amx);
+	nativecache::AmxLoad(amx);
+	batch::AmxLoad(amx);
+	callpatch::AmxLoad(amx);
 	return 1;
 }
 
 PLUGIN_EXPORT int PLUGIN_CALL AmxUnload(AMX *amx)
 {
+	callpatch::AmxUnload(amx);
+	callbackfilter::AmxUnload(amx);
+	commands::AmxUnload(amx);
+	segments::AmxUnload(amx);
+	nativecache::AmxUnload(amx);
+	cellformat::AmxUnload(amx);
+	batch::AmxUnload(amx);
+	memmonitor::AmxUnload(amx);
+	codeanalysis::AmxUnload(amx);
+	watchdog::AmxUnload(amx);
+	scripts::AmxUnload(amx);
 	return AMX_ERR_NONE;
 }
 
-/*
 PLUGIN_EXPORT int PLUGIN_CALL ProcessTick()
 {
+	watchdog::ProcessTick();
+	metrics::ProcessTick();
+	callbackfilter::ProcessTick();
+	callpatch::ProcessTick();
+	nativecache::ProcessTick();
+	kvstore::ProcessTick();
 	return AMX_ERR_NONE;
 }
-*/
@@ -0,0 +1,97 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#if defined _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+#include "mappedfile.h"
+
+
+MappedFile::MappedFile()
+	: data(NULL), size(0)
+#if defined _WIN32
+	, file_handle(INVALID_HANDLE_VALUE), mapping_handle(NULL)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined _WIN32
+
+bool MappedFile::Open(const char *path)
+{
+	Close();
+	file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0 ||
+		(mapping_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0, NULL)) == NULL ||
+		(data = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0)) == NULL)
+	{
+		Close();
+		return false;
+	}
+	size = (size_t)file_size.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != NULL)
+		UnmapViewOfFile(data);
+	if (mapping_handle != NULL)
+		CloseHandle(mapping_handle);
+	if (file_handle != INVALID_HANDLE_VALUE)
+		CloseHandle(file_handle);
+	data = NULL;
+	size = 0;
+	mapping_handle = NULL;
+	file_handle = INVALID_HANDLE_VALUE;
+}
+
+#else // _WIN32
+
+bool MappedFile::Open(const char *path)
+{
+	Close();
+	const int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+	void *ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	// The mapping stays valid after the descriptor is closed.
+	close(fd);
+	if (ptr == MAP_FAILED)
+		return false;
+	data = ptr;
+	size = (size_t)st.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != NULL)
+		munmap(const_cast<void *>(data), size);
+	data = NULL;
+	size = 0;
+}
+
+#endif // _WIN32
@@ -0,0 +1,39 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _MAPPEDFILE_H
+#define _MAPPEDFILE_H
+
+#include <cstddef>
+
+
+/*
+	A read-only memory-mapped file.
+*/
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char *path);
+	void Close();
+
+	const void *GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+private:
+	MappedFile(const MappedFile &);
+	MappedFile &operator=(const MappedFile &);
+
+	const void *data;
+	size_t size;
+#if defined _WIN32
+	void *file_handle;
+	void *mapping_handle;
+#endif
+};
+
+
+#endif // _MAPPEDFILE_H
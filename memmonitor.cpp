@@ -0,0 +1,202 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include "memmonitor.h"
+#include "metrics.h"
+#include "pluginconfig.h"
+#include "pluginutils.h"
+#include "scripts.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace memmonitor
+{
+
+	namespace
+	{
+
+		struct Entry
+		{
+			AMX *amx;
+			cell min_stk;
+			cell max_hea;
+			cell min_free;
+			cell warning_free; // Warn when there's less free space than this.
+			bool warned;
+			MetricsEntry *stack_peak_metric;
+			MetricsEntry *heap_peak_metric;
+			MetricsEntry *min_free_metric;
+		};
+
+		// There are only a few scripts, a linear search is fine.
+		std::vector<Entry> entries;
+		Entry *last_entry; // The script that called a native last.
+
+		Entry *Find(AMX *amx)
+		{
+			for (size_t i = 0; i < entries.size(); ++i)
+			{
+				if (entries[i].amx == amx)
+					return &entries[i];
+			}
+			return NULL;
+		}
+
+		void Reset(Entry &entry)
+		{
+			AMX *amx = entry.amx;
+			entry.min_stk = amx->stk;
+			entry.max_hea = amx->hea;
+			entry.min_free = amx->stk - amx->hea;
+			metrics::Set(entry.stack_peak_metric, amx->stp - entry.min_stk);
+			metrics::Set(entry.heap_peak_metric, entry.max_hea - amx->hlw);
+			metrics::Set(entry.min_free_metric, entry.min_free);
+		}
+
+		int GetScriptNumber(AMX *amx)
+		{
+			const std::vector<AMX *> &all = scripts::GetAll();
+			return (int)(std::find(all.begin(), all.end(), amx) - all.begin());
+		}
+
+		MetricsEntry *AddScriptGauge(AMX *amx, const char *name)
+		{
+			char metric_name[METRICS_NAME_SIZE];
+			snprintf(metric_name, sizeof(metric_name), "scripts.%d.%s", GetScriptNumber(amx), name);
+			return metrics::AddGauge(metric_name);
+		}
+
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		Entry entry;
+		entry.amx = amx;
+		entry.warning_free = (amx->stp - amx->hlw) / 100 * (cell)PLUGIN_MEMORY_WARNING_PERCENT;
+		entry.warned = false;
+		// A script loaded in place of another one takes over its metrics.
+		entry.stack_peak_metric = AddScriptGauge(amx, "stack_peak");
+		entry.heap_peak_metric = AddScriptGauge(amx, "heap_peak");
+		entry.min_free_metric = AddScriptGauge(amx, "min_free");
+		Reset(entry);
+		entries.push_back(entry);
+		last_entry = NULL;
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		Usage usage;
+		if (GetUsage(amx, usage))
+		{
+			long code_size, data_size, stack_heap_size;
+			amx_MemInfo(amx, &code_size, &data_size, &stack_heap_size);
+			logprintf("%s: Script #%d used %d bytes of stack and %d bytes of heap at most, "
+				"%d of %ld bytes were always free (code: %ld bytes, data: %ld bytes).", PLUGIN_NAME,
+				GetScriptNumber(amx), (int)usage.stack_peak, (int)usage.heap_peak, (int)usage.min_free,
+				stack_heap_size, code_size, data_size);
+		}
+		for (size_t i = 0; i < entries.size(); ++i)
+		{
+			if (entries[i].amx == amx)
+			{
+				entries.erase(entries.begin() + i);
+				break;
+			}
+		}
+		last_entry = NULL;
+	}
+
+	void Sample(AMX *amx)
+	{
+		Entry *entry = last_entry;
+		if (entry == NULL || entry->amx != amx)
+		{
+			if ((entry = Find(amx)) == NULL)
+				return;
+			last_entry = entry;
+		}
+		const cell stk = amx->stk, hea = amx->hea;
+		if (stk < entry->min_stk)
+		{
+			entry->min_stk = stk;
+			metrics::Set(entry->stack_peak_metric, amx->stp - stk);
+		}
+		if (hea > entry->max_hea)
+		{
+			entry->max_hea = hea;
+			metrics::Set(entry->heap_peak_metric, hea - amx->hlw);
+		}
+		if (stk - hea >= entry->min_free)
+			return;
+		entry->min_free = stk - hea;
+		metrics::Set(entry->min_free_metric, entry->min_free);
+		if (entry->min_free < entry->warning_free && !entry->warned)
+		{
+			entry->warned = true;
+			logprintf("%s: Script #%d is running out of stack/heap space (%d of %d bytes free) in %s.",
+				PLUGIN_NAME, GetScriptNumber(amx), (int)entry->min_free, (int)(amx->stp - amx->hlw),
+				pluginutils::GetCurrentNativeFunctionName(amx));
+		}
+	}
+
+	bool GetUsage(AMX *amx, Usage &usage)
+	{
+		const Entry *entry = Find(amx);
+		if (entry == NULL)
+			return false;
+		usage.stack_peak = amx->stp - entry->min_stk;
+		usage.heap_peak = entry->max_hea - amx->hlw;
+		usage.min_free = entry->min_free;
+		usage.stack_heap_size = amx->stp - amx->hlw;
+		return true;
+	}
+
+	bool ResetUsage(AMX *amx)
+	{
+		Entry *entry = Find(amx);
+		if (entry == NULL)
+			return false;
+		Reset(*entry);
+		return true;
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_GetMemoryUsage(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_stack_peak,
+		arg_heap_peak,
+		arg_min_free,
+		arg_stack_heap_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	memmonitor::Usage usage;
+	if (!memmonitor::GetUsage(amx, usage))
+		return 0;
+	const cell values[] = { usage.stack_peak, usage.heap_peak, usage.min_free, usage.stack_heap_size };
+	for (int i = 0; i < (int)arraysize(values); ++i)
+	{
+		cell *dest;
+		const int error = amx_GetAddr(amx, params[arg_stack_peak + i], &dest);
+		if (error != AMX_ERR_NONE)
+			return amx_RaiseError(amx, error), 0;
+		*dest = values[i];
+	}
+	return 1;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_ResetMemoryUsage(AMX *amx, cell *params)
+{
+	return memmonitor::ResetUsage(amx) ? 1 : 0;
+}
@@ -0,0 +1,55 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _MEMMONITOR_H
+#define _MEMMONITOR_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Tracks how much of its stack/heap space each script really uses, to size
+	#pragma dynamic from data: the lowest stack pointer, the highest heap
+	top and the least free space between the two, sampled on entry to and
+	exit from every call of the plugin's natives and hooks.
+
+	A warning is printed the first time the free space of a script falls
+	below PLUGIN_MEMORY_WARNING_PERCENT of its stack/heap size, and the
+	peaks are printed when the script is unloaded. They are also published
+	as the "scripts.<number>.*" gauges of the metrics (metrics.h).
+*/
+namespace memmonitor
+{
+
+	void AmxLoad(AMX *amx);
+	void AmxUnload(AMX *amx);
+
+	/*
+		Called by the native thunks. Only from the server thread.
+	*/
+	void Sample(AMX *amx);
+
+	struct Usage
+	{
+		cell stack_peak;      // Bytes
+		cell heap_peak;
+		cell min_free;
+		cell stack_heap_size; // Total, as set by #pragma dynamic.
+	};
+
+	bool GetUsage(AMX *amx, Usage &usage);
+
+	/*
+		Starts over from the current stack and heap.
+	*/
+	bool ResetUsage(AMX *amx);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_GetMemoryUsage(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_ResetMemoryUsage(AMX *amx, cell *params);
+
+
+#endif // _MEMMONITOR_H
@@ -0,0 +1,232 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#if defined _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include "metrics.h"
+#include "pluginconfig.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace metrics
+{
+
+	namespace
+	{
+
+		const uint32_t MAX_ENTRIES = 512;
+		const size_t SEGMENT_SIZE = sizeof(MetricsHeader) + MAX_ENTRIES * sizeof(MetricsEntry);
+
+		static_assert(sizeof(MetricsHeader) % 8 == 0 && sizeof(MetricsEntry) % 8 == 0,
+			"The 64-bit values must stay aligned");
+		static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t),
+			"The values are updated in place");
+
+		MetricsHeader *header;
+		MetricsEntry *entries;
+		// Used instead of the segment if it couldn't be created.
+		std::vector<uint64_t> local_memory;
+		// Shared by the metrics that didn't fit.
+		std::vector<uint64_t> spare_memory;
+		bool full_reported;
+
+		std::chrono::steady_clock::time_point last_tick;
+		MetricsEntry *ticks;
+		MetricsEntry *tick_interval;
+
+#if defined _WIN32
+
+		HANDLE mapping_handle;
+
+		void *CreateSegment()
+		{
+			char name[256];
+			snprintf(name, sizeof(name), "Local\\%s.%u", PLUGIN_METRICS_NAME, (unsigned)GetCurrentProcessId());
+			mapping_handle = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+				0, (DWORD)SEGMENT_SIZE, name);
+			if (mapping_handle == NULL)
+				return NULL;
+			void *ptr = MapViewOfFile(mapping_handle, FILE_MAP_ALL_ACCESS, 0, 0, SEGMENT_SIZE);
+			if (ptr == NULL)
+			{
+				CloseHandle(mapping_handle);
+				mapping_handle = NULL;
+			}
+			return ptr;
+		}
+
+		void DestroySegment(void *ptr)
+		{
+			UnmapViewOfFile(ptr);
+			CloseHandle(mapping_handle);
+			mapping_handle = NULL;
+		}
+
+		uint32_t GetProcessId()
+		{
+			return (uint32_t)GetCurrentProcessId();
+		}
+
+#else // _WIN32
+
+		char segment_name[256];
+
+		void *CreateSegment()
+		{
+			snprintf(segment_name, sizeof(segment_name), "/%s.%u", PLUGIN_METRICS_NAME, (unsigned)getpid());
+			const int fd = shm_open(segment_name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+			if (fd == -1)
+				return NULL;
+			void *ptr = MAP_FAILED;
+			if (ftruncate(fd, (off_t)SEGMENT_SIZE) == 0)
+				ptr = mmap(NULL, SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+			// The mapping stays valid after the descriptor is closed.
+			close(fd);
+			if (ptr == MAP_FAILED)
+			{
+				shm_unlink(segment_name);
+				return NULL;
+			}
+			return ptr;
+		}
+
+		void DestroySegment(void *ptr)
+		{
+			munmap(ptr, SEGMENT_SIZE);
+			shm_unlink(segment_name);
+		}
+
+		uint32_t GetProcessId()
+		{
+			return (uint32_t)getpid();
+		}
+
+#endif // _WIN32
+
+		void Init(void *memory)
+		{
+			header = (MetricsHeader *)memory;
+			entries = (MetricsEntry *)(header + 1);
+			header->version = METRICS_FORMAT_VERSION;
+			header->header_size = sizeof(MetricsHeader);
+			header->entry_size = sizeof(MetricsEntry);
+			header->max_entries = MAX_ENTRIES;
+			header->num_entries = 0;
+			header->pid = GetProcessId();
+			header->start_time = (uint64_t)time(NULL);
+			// Readers check the magic first.
+			std::atomic_thread_fence(std::memory_order_release);
+			memcpy(header->magic, METRICS_MAGIC, sizeof(header->magic));
+		}
+
+		MetricsEntry *GetSpare()
+		{
+			if (spare_memory.empty())
+				spare_memory.resize(sizeof(MetricsEntry) / sizeof(uint64_t));
+			return (MetricsEntry *)(void *)&spare_memory[0];
+		}
+
+		MetricsEntry *Add(const char *name, MetricType type)
+		{
+			if (header == NULL)
+				return GetSpare();
+			const uint32_t num_entries = header->num_entries;
+			for (uint32_t i = 0; i < num_entries; ++i)
+			{
+				if (strncmp(entries[i].name, name, METRICS_NAME_SIZE - 1) != 0)
+					continue;
+				if (entries[i].type == (uint32_t)type)
+					return &entries[i];
+				logprintf("%s: Metric \"%s\" is already registered with another type.", PLUGIN_NAME, name);
+				return GetSpare();
+			}
+			if (num_entries == MAX_ENTRIES)
+			{
+				if (!full_reported)
+					logprintf("%s: Too many metrics, \"%s\" and later ones won't be published.", PLUGIN_NAME, name);
+				full_reported = true;
+				return GetSpare();
+			}
+			MetricsEntry &entry = entries[num_entries];
+			memset(&entry, 0, sizeof(entry));
+			strncpy(entry.name, name, METRICS_NAME_SIZE - 1);
+			entry.type = (uint32_t)type;
+			reinterpret_cast<std::atomic<uint32_t> *>(&header->num_entries)->store(
+				num_entries + 1, std::memory_order_release);
+			return &entry;
+		}
+
+	}
+
+	void Load()
+	{
+		if (header != NULL)
+			return;
+		void *memory = NULL;
+		if (PLUGIN_METRICS_NAME[0] != '\0' && (memory = CreateSegment()) == NULL)
+			logprintf("%s: Failed to create the shared memory segment for the metrics.", PLUGIN_NAME);
+		if (memory == NULL)
+		{
+			local_memory.assign(SEGMENT_SIZE / sizeof(uint64_t), 0);
+			memory = &local_memory[0];
+		}
+		Init(memory);
+		full_reported = false;
+		last_tick = std::chrono::steady_clock::time_point();
+		ticks = AddCounter("ticks");
+		tick_interval = AddHistogram("ticks.interval_us");
+	}
+
+	void Unload()
+	{
+		if (header == NULL)
+			return;
+		if (local_memory.empty())
+			DestroySegment(header);
+		std::vector<uint64_t>().swap(local_memory);
+		header = NULL;
+		entries = NULL;
+	}
+
+	void ProcessTick()
+	{
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (last_tick != std::chrono::steady_clock::time_point())
+		{
+			Record(tick_interval, (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+				now - last_tick).count());
+		}
+		last_tick = now;
+		Increment(ticks);
+	}
+
+	MetricsEntry *AddCounter(const char *name)
+	{
+		return Add(name, METRIC_COUNTER);
+	}
+
+	MetricsEntry *AddGauge(const char *name)
+	{
+		return Add(name, METRIC_GAUGE);
+	}
+
+	MetricsEntry *AddHistogram(const char *name)
+	{
+		return Add(name, METRIC_HISTOGRAM);
+	}
+
+}
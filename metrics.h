@@ -0,0 +1,83 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <atomic>
+#include <stdint.h>
+#include "metricsformat.h"
+
+
+/*
+	Counters, gauges and histograms published in a shared memory segment
+	(see metricsformat.h) that the 'metrics' tool reads while the server
+	is running. Updating a metric is a few plain memory operations.
+
+	Metrics are registered by the server thread. Registering a name again
+	returns the same entry, so a script that is loaded again reuses its
+	metrics. The returned pointers are never NULL: if the segment couldn't
+	be created or is full, the metrics are still kept, but aren't published.
+*/
+namespace metrics
+{
+
+	void Load();
+	void Unload();
+
+	/*
+		Updates the tick metrics.
+	*/
+	void ProcessTick();
+
+	MetricsEntry *AddCounter(const char *name);
+	MetricsEntry *AddGauge(const char *name);
+	MetricsEntry *AddHistogram(const char *name);
+
+	inline std::atomic<uint64_t> &AsAtomic(uint64_t &value)
+	{
+		return *reinterpret_cast<std::atomic<uint64_t> *>(&value);
+	}
+
+	/*
+		For metrics updated by one thread at a time (no locked instructions).
+	*/
+	inline void Increment(MetricsEntry *metric, uint64_t n = 1)
+	{
+		std::atomic<uint64_t> &value = AsAtomic(metric->value);
+		value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	/*
+		For counters updated by several threads.
+	*/
+	inline void IncrementShared(MetricsEntry *metric, uint64_t n = 1)
+	{
+		AsAtomic(metric->value).fetch_add(n, std::memory_order_relaxed);
+	}
+
+	inline void Set(MetricsEntry *metric, int64_t value)
+	{
+		AsAtomic(metric->value).store((uint64_t)value, std::memory_order_relaxed);
+	}
+
+	/*
+		Adds a sample to a histogram. One thread at a time.
+	*/
+	inline void Record(MetricsEntry *metric, uint64_t sample)
+	{
+		size_t bucket = 0;
+		for (uint64_t rest = sample; rest != 0 && bucket < METRICS_NUM_BUCKETS - 1; rest >>= 1)
+			++bucket;
+		Increment(metric);
+		std::atomic<uint64_t> &sum = AsAtomic(metric->sum);
+		sum.store(sum.load(std::memory_order_relaxed) + sample, std::memory_order_relaxed);
+		std::atomic<uint64_t> &count = AsAtomic(metric->buckets[bucket]);
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+}
+
+
+#endif // _METRICS_H
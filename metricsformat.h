@@ -0,0 +1,71 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _METRICSFORMAT_H
+#define _METRICSFORMAT_H
+
+#include <cstddef>
+#include <stdint.h>
+
+
+/*
+	Layout of the shared memory segment the plugin publishes its metrics in,
+	read by the 'metrics' tool.
+
+	The segment is named PLUGIN_METRICS_NAME followed by a dot and the process
+	id of the server ("/name.1234" for shm_open, "Local\name.1234" on Windows).
+	All numbers are in the byte order of the server, the segment starts at a
+	page boundary and every 64-bit number is at a multiple of 8.
+
+		MetricsHeader
+		MetricsEntry entries[max_entries]
+
+	Only the first num_entries entries are in use. The plugin fills in a new
+	entry before raising num_entries and never removes or reorders them, so
+	a reader can keep pointers to the entries. The 64-bit values are updated
+	with (relaxed) atomic stores and must be read with atomic 64-bit loads.
+	The values of an entry aren't updated together: the sum of a histogram
+	may already include a sample that the count doesn't.
+*/
+
+const char METRICS_MAGIC[4] = { 'H', 'W', 'M', 'T' };
+const uint32_t METRICS_FORMAT_VERSION = 1;
+
+const size_t METRICS_NAME_SIZE = 48;
+const size_t METRICS_NUM_BUCKETS = 32;
+
+enum MetricType
+{
+	METRIC_COUNTER = 1,   // 'value' only grows.
+	METRIC_GAUGE = 2,     // 'value' is the current value (signed).
+	METRIC_HISTOGRAM = 3  // 'value' is the number of samples.
+};
+
+struct MetricsHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t header_size;   // sizeof(MetricsHeader)
+	uint32_t entry_size;    // sizeof(MetricsEntry)
+	uint32_t max_entries;
+	uint32_t num_entries;
+	uint32_t pid;
+	uint32_t reserved;
+	uint64_t start_time;    // When the plugin was loaded (Unix time, in seconds).
+};
+
+struct MetricsEntry
+{
+	char name[METRICS_NAME_SIZE]; // Zero-terminated.
+	uint32_t type;                // MetricType
+	uint32_t reserved;
+	uint64_t value;
+	uint64_t sum;                 // Histograms: the sum of the samples.
+	// Histograms: bucket 0 counts the samples equal to 0, bucket i counts
+	// the samples in [2^(i-1), 2^i), the last one also counts the larger ones.
+	uint64_t buckets[METRICS_NUM_BUCKETS];
+};
+
+
+#endif // _METRICSFORMAT_H
@@ -0,0 +1,266 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include <vector>
+#include "nativecache.h"
+#include "exechook.h"
+#include "nativethunks.h"
+#include "pluginconfig.h"
+#include "pluginutils.h"
+
+
+namespace nativecache
+{
+
+	namespace
+	{
+
+		// Player names are at most 24 characters long (MAX_PLAYER_NAME).
+		const size_t MAX_NAME_CELLS = 32;
+
+		enum ConnectionState
+		{
+			STATE_UNKNOWN,
+			STATE_DISCONNECTED,
+			STATE_CONNECTED
+		};
+
+		struct PlayerEntry
+		{
+			unsigned char connected; // ConnectionState
+			bool has_name;
+			bool bypass;             // Invalidated during the current tick.
+			cell name_len;
+			cell name[MAX_NAME_CELLS];
+		};
+
+		/*
+			The callbacks that change the results, as seen in amx_Exec.
+			-1 if the script doesn't have them.
+		*/
+		struct ScriptInfo
+		{
+			AMX *amx;
+			int connect_index;
+			int disconnect_index;
+			bool calls_invalidate; // Uses HelloWorld_InvalidatePlayer.
+		};
+
+		PlayerEntry players[PLUGIN_MAX_PLAYERS];
+		std::vector<cell> bypassed_players;
+		std::vector<ScriptInfo> scripts;
+
+		// Whether any loaded script lets the plugin know when players connect
+		// and disconnect. Otherwise there's nothing to drop the cache on.
+		bool enabled;
+
+		AMX_NATIVE orig_IsPlayerConnected;
+		AMX_NATIVE orig_GetPlayerName;
+		AMX_NATIVE orig_SetPlayerName;
+
+		FORCE_INLINE PlayerEntry *GetEntry(const cell *params, int num_args)
+		{
+			if (params[0] < num_args * (cell)sizeof(cell))
+				return NULL;
+			const ucell playerid = (ucell)params[1];
+			if (!enabled || playerid >= (ucell)PLUGIN_MAX_PLAYERS || players[playerid].bypass)
+				return NULL;
+			return &players[playerid];
+		}
+
+		cell AMX_NATIVE_CALL hook_IsPlayerConnected(AMX *amx, cell *params)
+		{
+			PlayerEntry *entry = GetEntry(params, 1);
+			if (entry == NULL)
+				return orig_IsPlayerConnected(amx, params);
+			if (entry->connected != STATE_UNKNOWN)
+				return (entry->connected == STATE_CONNECTED) ? 1 : 0;
+			const cell result = orig_IsPlayerConnected(amx, params);
+			entry->connected = (unsigned char)((result != 0) ? STATE_CONNECTED : STATE_DISCONNECTED);
+			return result;
+		}
+
+		cell AMX_NATIVE_CALL hook_GetPlayerName(AMX *amx, cell *params)
+		{
+			enum
+			{
+				args_size,
+				arg_playerid,
+				arg_name,
+				arg_len,
+				__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+			};
+			PlayerEntry *entry = GetEntry(params, num_args_expected);
+			if (entry == NULL || params[arg_len] <= 0)
+				return orig_GetPlayerName(amx, params);
+			const size_t size = (size_t)params[arg_len];
+			int error;
+			if (entry->has_name)
+			{
+				cell *dest = pluginutils::GetArrayAddr(amx, params[arg_name], size, error);
+				if (dest == NULL)
+					return orig_GetPlayerName(amx, params); // Let the server report the error.
+				const size_t len = std::min((size_t)entry->name_len, size - 1);
+				std::copy(entry->name, entry->name + len, dest);
+				dest[len] = 0;
+				return (cell)len;
+			}
+			const cell result = orig_GetPlayerName(amx, params);
+			// Don't cache names of disconnected players and names that didn't fit.
+			if (result <= 0 || (size_t)result >= std::min(size - 1, MAX_NAME_CELLS))
+				return result;
+			const cell *name = pluginutils::GetArrayAddr(amx, params[arg_name], (size_t)result, error);
+			if (name != NULL)
+			{
+				std::copy(name, name + result, entry->name);
+				entry->name_len = result;
+				entry->has_name = true;
+			}
+			return result;
+		}
+
+		cell AMX_NATIVE_CALL hook_SetPlayerName(AMX *amx, cell *params)
+		{
+			const cell result = orig_SetPlayerName(amx, params);
+			if (params[0] >= (cell)sizeof(cell) && (ucell)params[1] < (ucell)PLUGIN_MAX_PLAYERS)
+				Invalidate(params[1]);
+			return result;
+		}
+
+		void Hook(AMX *amx, const char *name, AMX_NATIVE hook, AMX_NATIVE &orig)
+		{
+			AMX_NATIVE native;
+			hook = nativethunks::Wrap(name, hook);
+			if (!pluginutils::ReplaceNative(amx, name, hook, &native))
+				return;
+			// The server natives are the same for every script.
+			if (orig == NULL && native != hook)
+				orig = native;
+		}
+
+		int FindPublic(AMX *amx, const char *name)
+		{
+			int index;
+			return (amx_FindPublic(amx, name, &index) == AMX_ERR_NONE) ? index : -1;
+		}
+
+		/*
+			Forgets everything when caching is turned off, so that nothing
+			stale is returned once it's turned back on.
+		*/
+		void UpdateEnabled()
+		{
+			bool enable = false;
+			for (size_t i = 0; i < scripts.size(); ++i)
+			{
+				const ScriptInfo &script = scripts[i];
+				if (script.calls_invalidate || (exechook::SeesServerCallbacks() &&
+					script.connect_index >= 0 && script.disconnect_index >= 0))
+				{
+					enable = true;
+					break;
+				}
+			}
+			if (enable == enabled)
+				return;
+			enabled = enable;
+			for (size_t i = 0; i < PLUGIN_MAX_PLAYERS; ++i)
+			{
+				players[i].connected = STATE_UNKNOWN;
+				players[i].has_name = false;
+			}
+		}
+
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		Hook(amx, "IsPlayerConnected", hook_IsPlayerConnected, orig_IsPlayerConnected);
+		Hook(amx, "GetPlayerName", hook_GetPlayerName, orig_GetPlayerName);
+		Hook(amx, "SetPlayerName", hook_SetPlayerName, orig_SetPlayerName);
+
+		ScriptInfo script;
+		int index;
+		script.amx = amx;
+		script.connect_index = FindPublic(amx, "OnPlayerConnect");
+		script.disconnect_index = FindPublic(amx, "OnPlayerDisconnect");
+		script.calls_invalidate = (amx_FindNative(amx, "HelloWorld_InvalidatePlayer", &index) == AMX_ERR_NONE);
+		scripts.push_back(script);
+		UpdateEnabled();
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		for (size_t i = 0; i < scripts.size(); ++i)
+		{
+			if (scripts[i].amx == amx)
+			{
+				scripts.erase(scripts.begin() + i);
+				break;
+			}
+		}
+		UpdateEnabled();
+	}
+
+	void BeginExec(AMX *amx, int index)
+	{
+		if (index < 0)
+			return;
+		for (size_t i = 0; i < scripts.size(); ++i)
+		{
+			const ScriptInfo &script = scripts[i];
+			if (script.amx != amx)
+				continue;
+			if (index != script.connect_index && index != script.disconnect_index)
+				return;
+			// The arguments are already pushed, playerid comes first.
+			cell *playerid;
+			if (amx->paramcount >= 1 && amx_GetAddr(amx, amx->stk, &playerid) == AMX_ERR_NONE &&
+				(ucell)*playerid < (ucell)PLUGIN_MAX_PLAYERS)
+			{
+				Invalidate(*playerid);
+			}
+			return;
+		}
+	}
+
+	void ProcessTick()
+	{
+		for (size_t i = 0; i < bypassed_players.size(); ++i)
+			players[bypassed_players[i]].bypass = false;
+		bypassed_players.clear();
+	}
+
+	void Invalidate(cell playerid)
+	{
+		PlayerEntry &entry = players[playerid];
+		entry.connected = STATE_UNKNOWN;
+		entry.has_name = false;
+		if (!entry.bypass)
+		{
+			entry.bypass = true;
+			bypassed_players.push_back(playerid);
+		}
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_InvalidatePlayer(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_playerid,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell playerid = params[arg_playerid];
+	if ((ucell)playerid >= (ucell)PLUGIN_MAX_PLAYERS)
+		return 0;
+	nativecache::Invalidate(playerid);
+	return 1;
+}
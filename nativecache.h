@@ -0,0 +1,53 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _NATIVECACHE_H
+#define _NATIVECACHE_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Memoization of server natives whose results only change on known events:
+	IsPlayerConnected and GetPlayerName are answered from per-player arrays
+	instead of calling into the server every time.
+
+	Entries are dropped when the server calls OnPlayerConnect or
+	OnPlayerDisconnect in any script (seen through exechook.h), by
+	Invalidate() (the include also calls it from these callbacks) and by
+	the SetPlayerName hook. If neither is possible, i.e. amx_Exec couldn't be
+	patched or no script has the callbacks, and no script calls
+	HelloWorld_InvalidatePlayer, nothing is cached. Right after an invalidation the player's results aren't cached until the
+	next server tick, as the server may still change them in the meantime
+	(e.g. the player is removed only after OnPlayerDisconnect returns).
+*/
+namespace nativecache
+{
+
+	/*
+		Hooks the cached natives used by the script.
+	*/
+	void AmxLoad(AMX *amx);
+
+	void AmxUnload(AMX *amx);
+
+	/*
+		Called by the amx_Exec hook before a public is executed.
+	*/
+	void BeginExec(AMX *amx, int index);
+
+	/*
+		Ends the no-cache period of the players invalidated during this tick.
+	*/
+	void ProcessTick();
+
+	void Invalidate(cell playerid);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_InvalidatePlayer(AMX *amx, cell *params);
+
+
+#endif // _NATIVECACHE_H
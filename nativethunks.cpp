@@ -0,0 +1,111 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <cstdio>
+#include "nativethunks.h"
+#include "memmonitor.h"
+#include "metrics.h"
+#include "pluginconfig.h"
+#include "recorder.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace nativethunks
+{
+
+	namespace
+	{
+
+		const size_t MAX_THUNKS = 128;
+
+		struct Slot
+		{
+			const char *name;
+			AMX_NATIVE func;
+			MetricsEntry *calls;
+		};
+
+		// Only changed by the server thread, before the thunk is handed out.
+		Slot slots[MAX_THUNKS];
+		AMX_NATIVE thunks[MAX_THUNKS];
+		size_t num_slots;
+
+		cell Call(size_t id, AMX *amx, cell *params)
+		{
+			metrics::Increment(slots[id].calls);
+			memmonitor::Sample(amx);
+			const cell result = recorder::Call(id, slots[id].func, amx, params);
+			memmonitor::Sample(amx);
+			return result;
+		}
+
+		template <size_t Id>
+		cell AMX_NATIVE_CALL Thunk(AMX *amx, cell *params)
+		{
+			return Call(Id, amx, params);
+		}
+
+		template <size_t NumThunks>
+		struct ThunkTable
+		{
+			static void Fill(AMX_NATIVE *table)
+			{
+				ThunkTable<NumThunks - 1>::Fill(table);
+				table[NumThunks - 1] = Thunk<NumThunks - 1>;
+			}
+		};
+
+		template <>
+		struct ThunkTable<0>
+		{
+			static void Fill(AMX_NATIVE *) {}
+		};
+
+	}
+
+	AMX_NATIVE Wrap(const char *name, AMX_NATIVE func)
+	{
+		if (thunks[0] == NULL)
+			ThunkTable<MAX_THUNKS>::Fill(thunks);
+		for (size_t i = 0; i < num_slots; ++i)
+		{
+			if (slots[i].func == func || thunks[i] == func)
+				return thunks[i];
+		}
+		if (num_slots == MAX_THUNKS)
+		{
+			logprintf("%s: Too many natives, calls of %s won't be monitored.", PLUGIN_NAME, name);
+			return func;
+		}
+		slots[num_slots].name = name;
+		slots[num_slots].func = func;
+		char metric_name[METRICS_NAME_SIZE];
+		snprintf(metric_name, sizeof(metric_name), "natives.%s.calls", name);
+		slots[num_slots].calls = metrics::AddCounter(metric_name);
+		recorder::AddNative(num_slots, name);
+		return thunks[num_slots++];
+	}
+
+	bool IsThunk(AMX_NATIVE func)
+	{
+		for (size_t i = 0; i < num_slots; ++i)
+		{
+			if (thunks[i] == func)
+				return true;
+		}
+		return false;
+	}
+
+	size_t GetCount()
+	{
+		return num_slots;
+	}
+
+	const char *GetName(size_t id)
+	{
+		return slots[id].name;
+	}
+
+}
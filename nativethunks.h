@@ -0,0 +1,45 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _NATIVETHUNKS_H
+#define _NATIVETHUNKS_H
+
+#include <cstddef>
+#include "SDK/amx/amx.h"
+
+
+/*
+	The plugin's natives and hooks are given to the scripts as thunks:
+	small functions that call the real native and let the memory monitor
+	(memmonitor.h) and the recorder (recorder.h) see every call. The calls
+	of each native are also counted in the metrics (metrics.h).
+	Each wrapped function gets an id, its index in the order of wrapping.
+*/
+namespace nativethunks
+{
+
+	/*
+		Returns the thunk of 'func'. Wrapping the same function (or a thunk)
+		again returns the same thunk.
+	*/
+	AMX_NATIVE Wrap(const char *name, AMX_NATIVE func);
+
+	inline void WrapNatives(AMX_NATIVE_INFO *natives, size_t num_natives)
+	{
+		for (size_t i = 0; i < num_natives; ++i)
+			natives[i].func = Wrap(natives[i].name, natives[i].func);
+	}
+
+	/*
+		Whether 'func' is one of the thunks handed out by Wrap.
+	*/
+	bool IsThunk(AMX_NATIVE func);
+
+	size_t GetCount();
+	const char *GetName(size_t id);
+
+}
+
+
+#endif // _NATIVETHUNKS_H
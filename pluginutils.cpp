@@ -22,6 +22,7 @@ redistribute it freely, subject to the following restrictions:
 
 #include <cstring>
 #include "pluginutils.h"
+#include "amxopcodes.h"
 
 
 extern void *(*logprintf)(const char *fmt, ...);
@@ -67,37 +68,8 @@ namespace pluginutils
 		return false;
 	}
 
-	const char *GetCurrentNativeFunctionName(AMX *amx)
-	{ // http://pro-pawn.ru/showthread.php?14522
-#if (6 <= CUR_FILE_VERSION) && (CUR_FILE_VERSION <= 8)
-		const cell OP_SYSREQ_C = 123, OP_SYSREQ_D = 135;
-#elif CUR_FILE_VERSION == 9
-		const cell OP_SYSREQ_C = 123, OP_SYSREQ_D = 158, OP_SYSREQ_ND = 159;
-		const cell OP_SYSREQ_N = 135;
-#elif CUR_FILE_VERSION == 10
-		const cell OP_SYSREQ_C = 123, OP_SYSREQ_D = 213, OP_SYSREQ_ND = 214;
-		const cell OP_SYSREQ_N = 135;
-#elif CUR_FILE_VERSION == 11
-		const cell OP_SYSREQ_C = 69, OP_SYSREQ_D = 75, OP_SYSREQ_ND = 76;
-		const cell OP_SYSREQ_N = 112;
-#else
-		#error Unsupported version of AMX instruction set.
-#endif
-
-		AMX_HEADER *hdr = (AMX_HEADER *)amx->base;
-		AMX_FUNCSTUB *natives =
-			(AMX_FUNCSTUB *)((size_t)hdr + (size_t)hdr->natives);
-		const size_t defsize = (size_t)hdr->defsize;
-		const cell num_natives =
-			(cell)(hdr->libraries - hdr->natives) / (cell)defsize;
-		AMX_FUNCSTUB *func = NULL;
-#ifndef AMX_FLAG_OVERLAY
-		unsigned char *code = amx->base + (size_t)(hdr->cod);
-#else
-		unsigned char *code = amx->code;
-#endif
-		cell op_addr, opcode;
-
+	cell *GetOpcodeJumpTable(AMX *amx)
+	{
 		static cell *jump_table = NULL;
 		static bool jump_table_checked = false;
 		if (!jump_table_checked)
@@ -125,6 +97,27 @@ namespace pluginutils
 #endif // CUR_FILE_VERSION < 11
 			jump_table_checked = true;
 		}
+		return jump_table;
+	}
+
+	const char *GetCurrentNativeFunctionName(AMX *amx)
+	{ // http://pro-pawn.ru/showthread.php?14522
+		using namespace amxopcodes;
+
+		AMX_HEADER *hdr = (AMX_HEADER *)amx->base;
+		AMX_FUNCSTUB *natives =
+			(AMX_FUNCSTUB *)((size_t)hdr + (size_t)hdr->natives);
+		const size_t defsize = (size_t)hdr->defsize;
+		const cell num_natives =
+			(cell)(hdr->libraries - hdr->natives) / (cell)defsize;
+		AMX_FUNCSTUB *func = NULL;
+#ifndef AMX_FLAG_OVERLAY
+		unsigned char *code = amx->base + (size_t)(hdr->cod);
+#else
+		unsigned char *code = amx->code;
+#endif
+		cell op_addr, opcode;
+		const cell *jump_table = GetOpcodeJumpTable(amx);
 
 #ifdef AMX_FLAG_SYSREQN
 		if (amx->flags & AMX_FLAG_SYSREQN)
@@ -177,7 +170,7 @@ namespace pluginutils
 				*(ucell *)(void *)(code + (size_t)op_addr + sizeof(cell));
 			func = natives;
 			size_t libraries = (size_t)amx->base + (size_t)hdr->libraries;
-			for (; (size_t)natives < libraries; *((size_t *)&func) += defsize)
+			for (; (size_t)func < libraries; *((size_t *)&func) += defsize)
 				if (func->address == func_addr)
 					goto ret;
 			func = NULL;
@@ -268,28 +261,22 @@ namespace pluginutils
 	{
 		int len;
 		cell *cptr;
-		char *cstr;
 
 		error = amx_GetAddr(amx, address, &cptr);
 		if (error != AMX_ERR_NONE)
-			return NULL;
+			return std::string();
 
 		error = amx_StrLen(cptr, &len);
 		if (error != AMX_ERR_NONE)
-			return NULL;
+			return std::string();
 
-		cstr = (char *)alloca((size_t)(len + 1) * sizeof(char));
-		if (cstr == NULL)
-		{
-			error = AMX_ERR_MEMORY;
-			return NULL;
-		}
-
-		error = amx_GetString(cstr, cptr, 0, (size_t)(len + 1));
+		// The string may be long, so don't put it on the stack.
+		std::string str((size_t)len + 1, '\0');
+		error = amx_GetString(&str[0], cptr, 0, (size_t)(len + 1));
 		if (error != AMX_ERR_NONE)
-			return NULL;
+			return std::string();
 
-		std::string str(cstr);
+		str.resize((size_t)len);
 		return str;
 	}
 
@@ -310,4 +297,42 @@ namespace pluginutils
 		return SetCString(amx, address, size, str.c_str(), pack);
 	}
 
+	cell *GetArrayAddr(AMX *amx, cell address, size_t num_cells, int &error)
+	{
+		// Same rules as in amx_GetAddr(), applied to the whole range.
+		const ucell start = (ucell)address;
+		const ucell hea = (ucell)amx->hea, stk = (ucell)amx->stk, stp = (ucell)amx->stp;
+		const ucell size = (num_cells > (size_t)stp / sizeof(cell))
+			? stp + 1 : (ucell)(((num_cells != 0) ? num_cells : 1) * sizeof(cell));
+		const bool in_data = (start < hea && size <= hea - start);
+		const bool in_stack = (start >= stk && start < stp && size <= stp - start);
+		if (!in_data && !in_stack)
+		{
+			error = AMX_ERR_MEMACCESS;
+			return NULL;
+		}
+		unsigned char *data = (amx->data != NULL)
+			? amx->data : amx->base + (size_t)((AMX_HEADER *)amx->base)->dat;
+		error = AMX_ERR_NONE;
+		return (cell *)(void *)(data + (size_t)start);
+	}
+
+	bool GetArray(AMX *amx, cell address, cell *dest, size_t num_cells, int &error)
+	{
+		const cell *arr = GetArrayAddr(amx, address, num_cells, error);
+		if (arr == NULL)
+			return false;
+		memcpy(dest, arr, num_cells * sizeof(cell));
+		return true;
+	}
+
+	bool SetArray(AMX *amx, cell address, const cell *src, size_t num_cells, int &error)
+	{
+		cell *arr = GetArrayAddr(amx, address, num_cells, error);
+		if (arr == NULL)
+			return false;
+		memcpy(arr, src, num_cells * sizeof(cell));
+		return true;
+	}
+
 }
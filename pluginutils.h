@@ -42,6 +42,20 @@ redistribute it freely, subject to the following restrictions:
 		#define REGISTER_VAR
 	#endif
 #endif
+#if !defined USE_SSE2
+	#if (PAWN_CELL_SIZE == 32) && \
+		(defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2))
+		#define USE_SSE2
+	#endif
+#endif
+
+/*
+	Checks the number of arguments passed to a native function.
+	The native is expected to declare 'num_args_expected' in its argument enum.
+*/
+#if !defined CheckArgs
+	#define CheckArgs() pluginutils::CheckNumberOfArguments(amx, params, num_args_expected)
+#endif
 
 /*
 	Remove the #if block below and include osdefs.h if you want to use functions
@@ -123,27 +137,27 @@ namespace pluginutils
 	{
 #if BYTE_ORDER == LITTLE_ENDIAN
 		REGISTER_VAR cell *ptr = &a[0];
-		REGISTER_VAR const cell *end = &a[num_elements];
+		REGISTER_VAR cell *end = &a[num_elements];
 		const size_t num_remaining = (num_elements % 4);
 		REGISTER_VAR const cell *aligned_end = end - num_remaining;
 		while (ptr < aligned_end)
 		{
-			AlignCell(*ptr);
-			AlignCell(*(ptr + 1));
-			AlignCell(*(ptr + 2));
-			AlignCell(*(ptr + 3));
+			*ptr = AlignCell(*ptr);
+			*(ptr + 1) = AlignCell(*(ptr + 1));
+			*(ptr + 2) = AlignCell(*(ptr + 2));
+			*(ptr + 3) = AlignCell(*(ptr + 3));
 			ptr += 4;
 		}
 		switch (num_remaining)
 		{
 		case 3:
-			AlignCell(*(end - 3));
+			*(end - 3) = AlignCell(*(end - 3));
 			// Fallthrough.
 		case 2:
-			AlignCell(*(end - 2));
+			*(end - 2) = AlignCell(*(end - 2));
 			// Fallthrough.
 		case 1:
-			AlignCell(*(end - 1));
+			*(end - 1) = AlignCell(*(end - 1));
 		}
 #endif // BYTE_ORDER == LITTLE_ENDIAN
 	}
@@ -177,6 +191,14 @@ namespace pluginutils
 #endif // BYTE_ORDER == LITTLE_ENDIAN
 	}
 
+	/*
+		Returns the table that maps each opcode to the value the interpreter
+		has replaced it with in the code of the loaded scripts (threaded code),
+		or NULL if the opcodes are left as they are.
+		The first call runs amx_Exec to get the table: only call it from the server thread.
+	*/
+	cell *GetOpcodeJumpTable(AMX *amx);
+
 	/*
 		Returns the name of the current native function.
 	*/
@@ -212,6 +234,53 @@ namespace pluginutils
 	bool SetCString(AMX *amx, cell address, cell size, const char *str, bool pack = false);
 	bool SetCXXString(AMX *amx, cell address, cell size, const std::string &str, bool pack = false);
 
+	/*
+		Returns the physical address of an array of 'num_cells' cells, or NULL
+		if any part of it is outside of the data section and the heap (below 'hea';
+		the heap itself starts at 'hlw') and outside of the stack ('stk' to 'stp').
+		The whole range is checked at once, so the array can be accessed
+		with memcpy or SIMD instructions afterwards.
+	*/
+	cell *GetArrayAddr(AMX *amx, cell address, size_t num_cells, int &error);
+
+	/*
+		Copies an array from or to script memory.
+	*/
+	bool GetArray(AMX *amx, cell address, cell *dest, size_t num_cells, int &error);
+	bool SetArray(AMX *amx, cell address, const cell *src, size_t num_cells, int &error);
+
+	/*
+		A bounds-checked view of an array in script memory.
+		T can be any cell-sized type, e.g. 'const cell' or 'float'.
+	*/
+	template <typename T>
+	class ArrayView
+	{
+	public:
+		ArrayView(AMX *amx, cell address, size_t size)
+			: data(NULL), size(0), error(AMX_ERR_NONE)
+		{
+			static_assert(sizeof(T) == sizeof(cell), "T must be of the same size as cell");
+			data = (T *)(void *)GetArrayAddr(amx, address, size, error);
+			if (data != NULL)
+				this->size = size;
+		}
+
+		bool IsValid() const { return data != NULL; }
+		int GetError() const { return error; }
+		T *GetData() const { return data; }
+		size_t GetSize() const { return size; }
+
+		T &operator[](size_t index) const { return data[index]; }
+		T *begin() const { return data; }
+		T *end() const { return data + size; }
+
+	private:
+		T *data;
+		size_t size;
+		int error;
+	};
+
 }
 
 
@@ -0,0 +1,356 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include "recorder.h"
+
+#ifdef PLUGIN_ENABLE_RECORDER
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "nativethunks.h"
+#include "pluginutils.h"
+#include "traceformat.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace recorder
+{
+
+	namespace
+	{
+
+		const size_t MAX_RECORDED_ARGS = 256;
+		const size_t MAX_PAYLOADS = 16;
+		// Natives calling natives (e.g. HelloWorld_BatchCall) deeper than this aren't recorded.
+		const size_t MAX_DEPTH = 8;
+		const unsigned FLUSH_INTERVAL = 100; // Milliseconds
+
+		typedef std::chrono::steady_clock Clock;
+
+		/*
+			A ring of records written by one thread and read by the flush thread.
+		*/
+		class Buffer
+		{
+		public:
+			explicit Buffer(uint32_t id)
+				: id(id), capacity(1), head(0), tail(0), dropped(0)
+			{
+				while (capacity < PLUGIN_RECORDER_BUFFER_SIZE)
+					capacity *= 2;
+				data.resize(capacity);
+			}
+
+			uint32_t GetId() const { return id; }
+
+			bool Push(const char *record, size_t size)
+			{
+				const size_t h = head.load(std::memory_order_relaxed);
+				const size_t t = tail.load(std::memory_order_acquire);
+				if (capacity - (h - t) < size)
+				{
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return false;
+				}
+				const size_t pos = h & (capacity - 1);
+				const size_t first = std::min(size, capacity - pos);
+				memcpy(&data[pos], record, first);
+				memcpy(&data[0], record + first, size - first);
+				head.store(h + size, std::memory_order_release);
+				return true;
+			}
+
+			bool Drain(FILE *file)
+			{
+				const size_t t = tail.load(std::memory_order_relaxed);
+				const size_t h = head.load(std::memory_order_acquire);
+				const size_t pos = t & (capacity - 1);
+				const size_t size = h - t;
+				const size_t first = std::min(size, capacity - pos);
+				const bool ok = fwrite(&data[pos], 1, first, file) == first
+					&& fwrite(&data[0], 1, size - first, file) == size - first;
+				tail.store(h, std::memory_order_release);
+				return ok;
+			}
+
+			uint32_t TakeDropped()
+			{
+				return dropped.exchange(0, std::memory_order_relaxed);
+			}
+
+		private:
+			const uint32_t id;
+			size_t capacity; // A power of 2.
+			std::vector<char> data;
+			std::atomic<size_t> head;
+			std::atomic<size_t> tail;
+			std::atomic<uint32_t> dropped;
+		};
+
+		std::atomic<bool> recording(false);
+		Clock::time_point start_time;
+		FILE *trace_file;
+
+		// Shared with the flush thread.
+		std::mutex flush_mutex;
+		std::condition_variable flush_cond;
+		bool stopping;
+		std::vector<char> pending_names;
+		std::vector<Buffer *> buffers;
+		std::atomic<unsigned> generation(0);
+		std::thread flusher;
+		std::atomic<bool> write_failed(false);
+		size_t num_dropped;
+
+		thread_local Buffer *thread_buffer;
+		thread_local unsigned thread_generation;
+		thread_local size_t thread_depth;
+		thread_local std::vector<char> thread_records[MAX_DEPTH];
+
+		Buffer *GetThreadBuffer()
+		{
+			std::lock_guard<std::mutex> lock(flush_mutex);
+			if (thread_buffer == NULL || thread_generation != generation)
+			{
+				thread_buffer = new Buffer((uint32_t)buffers.size());
+				thread_generation = generation;
+				buffers.push_back(thread_buffer);
+			}
+			return thread_buffer;
+		}
+
+		template <typename T>
+		void Append(std::vector<char> &record, const T &value)
+		{
+			const char *bytes = (const char *)&value;
+			record.insert(record.end(), bytes, bytes + sizeof(T));
+		}
+
+		void AppendCells(std::vector<char> &record, const cell *cells, size_t num_cells)
+		{
+			const char *bytes = (const char *)cells;
+			record.insert(record.end(), bytes, bytes + num_cells * sizeof(cell));
+		}
+
+		void AppendNameRecord(std::vector<char> &names, uint32_t native_id, const char *name)
+		{
+			const size_t name_size = (strlen(name) + sizeof(uint32_t)) & ~(sizeof(uint32_t) - 1);
+			TraceRecordHeader header;
+			header.type = TRACE_RECORD_NATIVE;
+			header.size = (uint32_t)(sizeof(header) + sizeof(native_id) + name_size);
+			Append(names, header);
+			Append(names, native_id);
+			const size_t pos = names.size();
+			names.resize(pos + name_size, '\0');
+			memcpy(&names[pos], name, strlen(name));
+		}
+
+		/*
+			The memory an argument may point to: from the address to the end of
+			the data/heap or the stack, at most PLUGIN_RECORDER_PAYLOAD_CELLS.
+		*/
+		const cell *GetPayload(AMX *amx, cell address, size_t &num_cells)
+		{
+			if (address % (cell)sizeof(cell) != 0 || address < 0)
+				return NULL;
+			cell end;
+			if (address < amx->hea)
+				end = amx->hea;
+			else if (address >= amx->stk && address < amx->stp)
+				end = amx->stp;
+			else
+				return NULL;
+			num_cells = std::min((size_t)(end - address) / sizeof(cell), (size_t)PLUGIN_RECORDER_PAYLOAD_CELLS);
+			int error;
+			return pluginutils::GetArrayAddr(amx, address, num_cells, error);
+		}
+
+		/*
+			Writes everything but the results of the call.
+		*/
+		void BeginCallRecord(std::vector<char> &record, uint32_t native_id, AMX *amx, const cell *params)
+		{
+			const size_t num_args = std::min((size_t)params[0] / sizeof(cell), MAX_RECORDED_ARGS);
+			record.clear();
+			TraceRecordHeader header;
+			header.type = TRACE_RECORD_CALL;
+			header.size = 0;
+			Append(record, header);
+			TraceCall call;
+			memset(&call, 0, sizeof(call));
+			call.native_id = native_id;
+			call.script_id = (uint32_t)(size_t)amx;
+			call.thread_id = thread_buffer->GetId();
+			call.num_args = (uint32_t)num_args;
+			Append(record, call);
+			AppendCells(record, params + 1, num_args);
+
+			uint32_t num_payloads = 0;
+			for (size_t i = 0; i < num_args && num_payloads < MAX_PAYLOADS; ++i)
+			{
+				const cell address = params[1 + i];
+				if (std::find(params + 1, params + 1 + i, address) != params + 1 + i)
+					continue; // Already stored.
+				size_t num_cells;
+				const cell *cells = GetPayload(amx, address, num_cells);
+				if (cells == NULL)
+					continue;
+				size_t num_stored = num_cells;
+				while (num_stored != 0 && cells[num_stored - 1] == 0)
+					--num_stored;
+				TracePayload payload;
+				payload.arg_index = (uint32_t)i;
+				payload.num_cells = (uint32_t)num_stored;
+				payload.num_zero_cells = (uint32_t)(num_cells - num_stored);
+				Append(record, payload);
+				AppendCells(record, cells, num_stored);
+				++num_payloads;
+			}
+			TraceRecordHeader *record_header = (TraceRecordHeader *)&record[0];
+			record_header->size = (uint32_t)record.size();
+			TraceCall *record_call = (TraceCall *)&record[sizeof(TraceRecordHeader)];
+			record_call->num_payloads = num_payloads;
+		}
+
+		void Flush()
+		{
+			std::vector<char> names;
+			std::vector<Buffer *> current;
+			{
+				std::lock_guard<std::mutex> lock(flush_mutex);
+				names.swap(pending_names);
+				current = buffers;
+			}
+			bool ok = fwrite(names.data(), 1, names.size(), trace_file) == names.size();
+			for (size_t i = 0; i < current.size(); ++i)
+			{
+				ok = current[i]->Drain(trace_file) && ok;
+				const uint32_t dropped = current[i]->TakeDropped();
+				if (dropped != 0)
+				{
+					TraceRecordHeader header;
+					header.type = TRACE_RECORD_DROPPED;
+					header.size = (uint32_t)(sizeof(header) + sizeof(dropped));
+					ok = fwrite(&header, sizeof(header), 1, trace_file) == 1
+						&& fwrite(&dropped, sizeof(dropped), 1, trace_file) == 1 && ok;
+					num_dropped += dropped;
+				}
+			}
+			if (fflush(trace_file) != 0 || !ok)
+				write_failed = true;
+		}
+
+		void FlushThread()
+		{
+			std::unique_lock<std::mutex> lock(flush_mutex);
+			for (;;)
+			{
+				flush_cond.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL), [] { return stopping; });
+				const bool stop = stopping;
+				lock.unlock();
+				Flush();
+				lock.lock();
+				if (stop)
+					break;
+			}
+		}
+
+	}
+
+	void Load()
+	{
+		trace_file = fopen(PLUGIN_RECORDER_FILE, "wb");
+		if (trace_file == NULL)
+		{
+			logprintf("%s: Can't open \"%s\" for writing, native calls won't be recorded.", PLUGIN_NAME,
+				PLUGIN_RECORDER_FILE);
+			return;
+		}
+		TraceHeader header;
+		memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+		header.version = TRACE_FORMAT_VERSION;
+		header.cell_size = (uint32_t)sizeof(cell);
+		header.reserved = 0;
+		fwrite(&header, sizeof(header), 1, trace_file);
+
+		// The natives wrapped before (or during an earlier Load) are named again in the new file.
+		pending_names.clear();
+		for (size_t i = 0; i < nativethunks::GetCount(); ++i)
+			AppendNameRecord(pending_names, (uint32_t)i, nativethunks::GetName(i));
+		++generation;
+		stopping = false;
+		num_dropped = 0;
+		start_time = Clock::now();
+		flusher = std::thread(FlushThread);
+		recording = true;
+		logprintf("%s: Recording native calls to \"%s\".", PLUGIN_NAME, PLUGIN_RECORDER_FILE);
+	}
+
+	void Unload()
+	{
+		if (!recording)
+			return;
+		recording = false;
+		{
+			std::lock_guard<std::mutex> lock(flush_mutex);
+			stopping = true;
+		}
+		flush_cond.notify_one();
+		if (flusher.joinable())
+			flusher.join();
+		fclose(trace_file);
+		trace_file = NULL;
+		for (size_t i = 0; i < buffers.size(); ++i)
+			delete buffers[i];
+		buffers.clear();
+		if (write_failed.exchange(false))
+			logprintf("%s: Failed to write \"%s\".", PLUGIN_NAME, PLUGIN_RECORDER_FILE);
+		if (num_dropped != 0)
+		{
+			logprintf("%s: %u native calls weren't recorded (PLUGIN_RECORDER_BUFFER_SIZE is too small).",
+				PLUGIN_NAME, (unsigned)num_dropped);
+		}
+	}
+
+	void AddNative(size_t native_id, const char *name)
+	{
+		std::lock_guard<std::mutex> lock(flush_mutex);
+		AppendNameRecord(pending_names, (uint32_t)native_id, name);
+	}
+
+	cell Call(size_t native_id, AMX_NATIVE func, AMX *amx, cell *params)
+	{
+		if (!recording.load(std::memory_order_relaxed) || thread_depth >= MAX_DEPTH)
+			return func(amx, params);
+		Buffer *buffer = (thread_buffer != NULL && thread_generation == generation)
+			? thread_buffer : GetThreadBuffer();
+
+		std::vector<char> &record = thread_records[thread_depth];
+		BeginCallRecord(record, (uint32_t)native_id, amx, params);
+		const size_t depth = thread_depth++;
+		const Clock::time_point start = Clock::now();
+		const cell result = func(amx, params);
+		const Clock::time_point end = Clock::now();
+		--thread_depth;
+
+		TraceCall *call = (TraceCall *)&record[sizeof(TraceRecordHeader)];
+		call->depth = (uint32_t)depth;
+		call->start_ns = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(start - start_time).count();
+		call->duration_ns = (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+		call->result = (int32_t)result;
+		buffer->Push(&record[0], record.size());
+		return result;
+	}
+
+}
+
+#endif // PLUGIN_ENABLE_RECORDER
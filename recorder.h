@@ -0,0 +1,69 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _RECORDER_H
+#define _RECORDER_H
+
+#include <cstddef>
+#include "SDK/amx/amx.h"
+#include "pluginconfig.h"
+
+
+/*
+	Records every call of the plugin's natives and hooks (the arguments,
+	the memory they point to, the result and the time it took) to a trace
+	file (PLUGIN_RECORDER_FILE, see traceformat.h), so that the calls made
+	on a live server can be replayed offline with the 'replay' tool.
+
+	Only built in when PLUGIN_ENABLE_RECORDER is set; otherwise the functions
+	below do nothing and the natives are called directly.
+
+	The calls come from the native thunks (see nativethunks.h). Each record
+	is written into a buffer owned by the calling thread, without locks.
+	A flush thread moves the buffers to the file. When a buffer is full the
+	calls are not recorded (only counted) rather than waiting for the flush
+	thread.
+*/
+namespace recorder
+{
+
+#ifdef PLUGIN_ENABLE_RECORDER
+
+	/*
+		Opens the trace file and starts the flush thread.
+	*/
+	void Load();
+
+	/*
+		Writes the remaining records and stops the flush thread.
+	*/
+	void Unload();
+
+	/*
+		Names a native id in the trace. Called for every new thunk.
+	*/
+	void AddNative(size_t native_id, const char *name);
+
+	/*
+		Calls the native and records the call.
+	*/
+	cell Call(size_t native_id, AMX_NATIVE func, AMX *amx, cell *params);
+
+#else
+
+	inline void Load() {}
+	inline void Unload() {}
+	inline void AddNative(size_t, const char *) {}
+
+	inline cell Call(size_t, AMX_NATIVE func, AMX *amx, cell *params)
+	{
+		return func(amx, params);
+	}
+
+#endif
+
+}
+
+
+#endif // _RECORDER_H
@@ -0,0 +1,266 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "remotecall.h"
+#include "cellstring.h"
+#include "pluginutils.h"
+#include "scripts.h"
+
+
+namespace remotecall
+{
+
+	namespace
+	{
+
+		struct Target
+		{
+			AMX *amx;
+			int index;
+		};
+
+		struct FunctionRef
+		{
+			std::string name;
+			bool resolved;
+			unsigned generation;
+			std::vector<Target> targets;
+		};
+
+		/*
+			An argument is either a single value or an array that is copied
+			from the caller's memory straight into the heap of the callee.
+		*/
+		struct Arg
+		{
+			cell value;
+			const cell *array;
+			int num_cells;
+		};
+
+		std::vector<FunctionRef> refs;
+		std::unordered_map<std::string, cell> refs_by_name;
+
+		cell GetRef(const std::string &name)
+		{
+			std::unordered_map<std::string, cell>::const_iterator it = refs_by_name.find(name);
+			if (it != refs_by_name.end())
+				return it->second;
+			FunctionRef ref;
+			ref.name = name;
+			ref.resolved = false;
+			ref.generation = 0;
+			refs.push_back(ref);
+			const cell id = (cell)refs.size();
+			refs_by_name[name] = id;
+			return id;
+		}
+
+		const std::vector<Target> &GetTargets(FunctionRef &ref)
+		{
+			const unsigned generation = scripts::GetGeneration();
+			if (ref.resolved && ref.generation == generation)
+				return ref.targets;
+			ref.targets.clear();
+			const std::vector<AMX *> &all_scripts = scripts::GetAll();
+			for (size_t i = 0; i < all_scripts.size(); ++i)
+			{
+				Target target = { all_scripts[i], 0 };
+				if (amx_FindPublic(target.amx, ref.name.c_str(), &target.index) == AMX_ERR_NONE)
+					ref.targets.push_back(target);
+			}
+			ref.resolved = true;
+			ref.generation = generation;
+			return ref.targets;
+		}
+
+		/*
+			Collects the arguments described by the format string.
+			Variadic arguments are passed by reference, so each one is an address.
+			Format specifiers: 'i', 'd', 'c', 'b', 'f' - a single value,
+			's' - a string (packed or unpacked), 'a' - an array followed
+			by its size ('i' or 'd').
+		*/
+		bool CollectArgs(AMX *amx, const cell *params, int first_arg,
+			const cellstring::StringArg &format, std::vector<Arg> &args, int &error)
+		{
+			const int num_params = (int)(params[0] / (cell)sizeof(cell));
+			if (first_arg - 1 + (int)format.len > num_params)
+			{
+				error = AMX_ERR_PARAMS;
+				return false;
+			}
+			args.resize(format.len);
+			for (size_t i = 0; i < format.len; ++i)
+			{
+				cell *ptr;
+				if ((error = amx_GetAddr(amx, params[first_arg + i], &ptr)) != AMX_ERR_NONE)
+					return false;
+				Arg &arg = args[i];
+				arg.array = NULL;
+				switch (format.str[i])
+				{
+				case 'i': case 'd': case 'c': case 'b': case 'f':
+					arg.value = *ptr;
+					break;
+				case 's':
+				{
+					int len;
+					if ((error = amx_StrLen(ptr, &len)) != AMX_ERR_NONE)
+						return false;
+					arg.array = ptr;
+					arg.num_cells = ((ucell)*ptr > UNPACKEDMAX)
+						? len / (int)sizeof(cell) + 1 : len + 1;
+					break;
+				}
+				case 'a':
+				{
+					cell *size_ptr;
+					if (i + 1 >= format.len || (format.str[i + 1] != 'i' && format.str[i + 1] != 'd'))
+					{
+						error = AMX_ERR_PARAMS;
+						return false;
+					}
+					if ((error = amx_GetAddr(amx, params[first_arg + i + 1], &size_ptr)) != AMX_ERR_NONE)
+						return false;
+					if (*size_ptr <= 0)
+					{
+						error = AMX_ERR_PARAMS;
+						return false;
+					}
+					// The whole array is copied into the callee, not just its first cell.
+					if ((ptr = pluginutils::GetArrayAddr(amx, params[first_arg + i], (size_t)*size_ptr, error)) == NULL)
+						return false;
+					arg.array = ptr;
+					arg.num_cells = (int)*size_ptr;
+					break;
+				}
+				default:
+					error = AMX_ERR_PARAMS;
+					return false;
+				}
+			}
+			return true;
+		}
+
+		cell Call(FunctionRef &ref, const std::vector<Arg> &args, int &error)
+		{
+			cell retval = 0;
+			error = AMX_ERR_NONE;
+
+			// Copy the targets, as the callee might load or unload scripts.
+			const std::vector<Target> targets = GetTargets(ref);
+			for (size_t t = 0; t < targets.size(); ++t)
+			{
+				AMX *amx = targets[t].amx;
+				cell heap_start = -1, addr;
+				for (size_t i = args.size(); i-- > 0; )
+				{
+					if (args[i].array == NULL)
+					{
+						amx_Push(amx, args[i].value);
+						continue;
+					}
+					error = amx_PushArray(amx, &addr, NULL, args[i].array, args[i].num_cells);
+					if (error != AMX_ERR_NONE)
+						break;
+					if (heap_start == -1)
+						heap_start = addr;
+				}
+				if (error == AMX_ERR_NONE)
+				{
+					error = amx_Exec(amx, &retval, targets[t].index);
+				}
+				else
+				{
+					// Pop the arguments that were pushed before the failure.
+					amx->stk += amx->paramcount * (cell)sizeof(cell);
+					amx->paramcount = 0;
+				}
+				if (heap_start != -1)
+					amx_Release(amx, heap_start);
+				if (error != AMX_ERR_NONE)
+					break;
+			}
+			return retval;
+		}
+
+		cell CallImpl(AMX *amx, const cell *params, cell ref_id, cell format_addr, int first_arg)
+		{
+			if (ref_id <= 0 || (size_t)ref_id > refs.size())
+				return 0;
+			int error;
+			cellstring::StringArg format;
+			std::vector<Arg> args;
+			if (!cellstring::GetStringArg(amx, format_addr, format, error) ||
+				!CollectArgs(amx, params, first_arg, format, args, error))
+				return amx_RaiseError(amx, error), 0;
+			const cell retval = Call(refs[ref_id - 1], args, error);
+			if (error != AMX_ERR_NONE)
+				return amx_RaiseError(amx, error), 0;
+			return retval;
+		}
+
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_RemoteRef(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_function,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	char *name = pluginutils::GetCString(amx, params[arg_function], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	const cell ref = remotecall::GetRef(name);
+	free(name);
+	return ref;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_CallRemoteRef(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_ref,
+		arg_format,
+		arg_first_vararg,
+		num_args_expected = arg_format
+	};
+	if (!CheckArgs())
+		return 0;
+	return remotecall::CallImpl(amx, params, params[arg_ref], params[arg_format], arg_first_vararg);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_CallRemote(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_function,
+		arg_format,
+		arg_first_vararg,
+		num_args_expected = arg_format
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	char *name = pluginutils::GetCString(amx, params[arg_function], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	const cell ref = remotecall::GetRef(name);
+	free(name);
+	return remotecall::CallImpl(amx, params, ref, params[arg_format], arg_first_vararg);
+}
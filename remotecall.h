@@ -0,0 +1,21 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _REMOTECALL_H
+#define _REMOTECALL_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Natives for calling public functions in other scripts.
+	The (script, public index) pairs are looked up once per function name
+	and cached until a script is loaded or unloaded.
+*/
+cell AMX_NATIVE_CALL n_HelloWorld_RemoteRef(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_CallRemoteRef(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_CallRemote(AMX *amx, cell *params);
+
+
+#endif // _REMOTECALL_H
@@ -0,0 +1,44 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include "scripts.h"
+
+
+namespace scripts
+{
+
+	namespace
+	{
+
+		std::vector<AMX *> loaded_scripts;
+		unsigned generation = 0;
+
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		loaded_scripts.push_back(amx);
+		++generation;
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		std::vector<AMX *>::iterator it = std::find(loaded_scripts.begin(), loaded_scripts.end(), amx);
+		if (it != loaded_scripts.end())
+			loaded_scripts.erase(it);
+		++generation;
+	}
+
+	const std::vector<AMX *> &GetAll()
+	{
+		return loaded_scripts;
+	}
+
+	unsigned GetGeneration()
+	{
+		return generation;
+	}
+
+}
@@ -0,0 +1,35 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _SCRIPTS_H
+#define _SCRIPTS_H
+
+#include <vector>
+#include "SDK/amx/amx.h"
+
+
+namespace scripts
+{
+
+	/*
+		Keeps track of the loaded scripts (the gamemode and filterscripts).
+	*/
+	void AmxLoad(AMX *amx);
+	void AmxUnload(AMX *amx);
+
+	/*
+		Returns all loaded scripts in the order they were loaded.
+	*/
+	const std::vector<AMX *> &GetAll();
+
+	/*
+		Returns a number that changes every time a script is loaded or unloaded.
+		Can be used to tell whether something cached per script is still valid.
+	*/
+	unsigned GetGeneration();
+
+}
+
+
+#endif // _SCRIPTS_H
@@ -0,0 +1,325 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include "segments.h"
+#include "pluginutils.h"
+
+
+namespace segments
+{
+
+	namespace
+	{
+
+		const size_t MAX_SEGMENTS = 1024;
+
+		struct Segment
+		{
+			std::string name;
+			SegmentType type;
+			bool versioned;
+			size_t size;
+			std::unique_ptr<cell[]> data;
+			std::atomic<uint32_t> sequence;
+			int num_refs;
+		};
+
+		// Handles are indices in this array plus one. The array never moves,
+		// so the C++ API can look up segments from any thread.
+		Segment *segments[MAX_SEGMENTS];
+		std::map<std::string, cell> handles_by_name;
+
+		// How many times each script attached to each segment.
+		std::map<AMX *, std::map<cell, int> > attachments;
+
+		FORCE_INLINE Segment *GetSegment(cell handle)
+		{
+			if (handle <= 0 || (size_t)handle > MAX_SEGMENTS)
+				return NULL;
+			return segments[handle - 1];
+		}
+
+		cell CreateSegment(const std::string &name, size_t size, SegmentType type, bool versioned)
+		{
+			size_t idx = 0;
+			while (idx < MAX_SEGMENTS && segments[idx] != NULL)
+				++idx;
+			if (idx == MAX_SEGMENTS)
+				return 0;
+			Segment *segment = new Segment;
+			segment->name = name;
+			segment->type = type;
+			segment->versioned = versioned;
+			segment->size = size;
+			segment->data.reset(new cell[size]());
+			segment->sequence.store(0, std::memory_order_relaxed);
+			segment->num_refs = 0;
+			segments[idx] = segment;
+			const cell handle = (cell)idx + 1;
+			handles_by_name[name] = handle;
+			return handle;
+		}
+
+		void Release(cell handle, int num_refs)
+		{
+			Segment *segment = GetSegment(handle);
+			if (segment == NULL || (segment->num_refs -= num_refs) > 0)
+				return;
+			handles_by_name.erase(segment->name);
+			segments[handle - 1] = NULL;
+			delete segment;
+		}
+
+		/*
+			Returns the segment if the script is attached to it. Scripts can only
+			use the segments they attached to, not any handle they guess.
+		*/
+		Segment *GetAttachedSegment(AMX *amx, cell handle)
+		{
+			std::map<AMX *, std::map<cell, int> >::const_iterator it = attachments.find(amx);
+			if (it == attachments.end() || it->second.find(handle) == it->second.end())
+				return NULL;
+			return GetSegment(handle);
+		}
+
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		attachments[amx];
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		std::map<AMX *, std::map<cell, int> >::iterator it = attachments.find(amx);
+		if (it == attachments.end())
+			return;
+		for (std::map<cell, int>::const_iterator ref = it->second.begin(); ref != it->second.end(); ++ref)
+			Release(ref->first, ref->second);
+		attachments.erase(it);
+	}
+
+	size_t Read(cell handle, size_t offset, cell dest[], size_t count)
+	{
+		Segment *segment = GetSegment(handle);
+		if (segment == NULL || offset >= segment->size)
+			return 0;
+		if (count > segment->size - offset)
+			count = segment->size - offset;
+		if (!segment->versioned)
+		{
+			memcpy(dest, &segment->data[offset], count * sizeof(cell));
+			return count;
+		}
+		// Retry if a writer was active before or during the copy.
+		uint32_t seq_before, seq_after;
+		do
+		{
+			while ((seq_before = segment->sequence.load(std::memory_order_acquire)) & 1)
+				;
+			memcpy(dest, &segment->data[offset], count * sizeof(cell));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			seq_after = segment->sequence.load(std::memory_order_relaxed);
+		} while (seq_before != seq_after);
+		return count;
+	}
+
+	size_t Write(cell handle, size_t offset, const cell src[], size_t count)
+	{
+		Segment *segment = GetSegment(handle);
+		if (segment == NULL || offset >= segment->size)
+			return 0;
+		if (count > segment->size - offset)
+			count = segment->size - offset;
+		if (segment->versioned)
+		{
+			segment->sequence.fetch_add(1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+		}
+		memcpy(&segment->data[offset], src, count * sizeof(cell));
+		if (segment->versioned)
+			segment->sequence.fetch_add(1, std::memory_order_release);
+		return count;
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentAttach(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_name,
+		arg_size,
+		arg_type,
+		arg_versioned,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	char *name = pluginutils::GetCString(amx, params[arg_name], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	const std::string name_str(name);
+	free(name);
+
+	const cell size = params[arg_size];
+	const segments::SegmentType type = (segments::SegmentType)params[arg_type];
+	const bool versioned = (params[arg_versioned] != 0);
+	if (type != segments::SEGMENT_INT && type != segments::SEGMENT_FLOAT)
+		return 0;
+	cell handle;
+	std::map<std::string, cell>::const_iterator it = segments::handles_by_name.find(name_str);
+	if (it != segments::handles_by_name.end())
+	{
+		// All scripts must agree on the layout of the segment.
+		handle = it->second;
+		const segments::Segment *segment = segments::GetSegment(handle);
+		if ((size != 0 && (size_t)size != segment->size) ||
+			segment->type != type || segment->versioned != versioned)
+			return 0;
+	}
+	else
+	{
+		if (size <= 0)
+			return 0;
+		if ((handle = segments::CreateSegment(name_str, (size_t)size, type, versioned)) == 0)
+			return 0;
+	}
+	segments::GetSegment(handle)->num_refs++;
+	segments::attachments[amx][handle]++;
+	return handle;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentDetach(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_handle,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell handle = params[arg_handle];
+	std::map<AMX *, std::map<cell, int> >::iterator script = segments::attachments.find(amx);
+	if (script == segments::attachments.end())
+		return 0;
+	std::map<cell, int> &refs = script->second;
+	std::map<cell, int>::iterator it = refs.find(handle);
+	if (it == refs.end())
+		return 0;
+	if (--it->second == 0)
+		refs.erase(it);
+	segments::Release(handle, 1);
+	return 1;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentSize(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_handle,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const segments::Segment *segment = segments::GetAttachedSegment(amx, params[arg_handle]);
+	return (segment != NULL) ? (cell)segment->size : 0;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentVersion(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_handle,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const segments::Segment *segment = segments::GetAttachedSegment(amx, params[arg_handle]);
+	if (segment == NULL)
+		return 0;
+	return (cell)(segment->sequence.load(std::memory_order_acquire) >> 1);
+}
+
+static cell SegmentCopyImpl(AMX *amx, cell *params, bool write)
+{
+	enum
+	{
+		args_size,
+		arg_handle,
+		arg_offset,
+		arg_array,
+		arg_count,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell offset = params[arg_offset], count = params[arg_count];
+	if (offset < 0 || count <= 0 || segments::GetAttachedSegment(amx, params[arg_handle]) == NULL)
+		return 0;
+	int error;
+	cell *arr = pluginutils::GetArrayAddr(amx, params[arg_array], (size_t)count, error);
+	if (arr == NULL)
+		return amx_RaiseError(amx, error), 0;
+	return write
+		? (cell)segments::Write(params[arg_handle], (size_t)offset, arr, (size_t)count)
+		: (cell)segments::Read(params[arg_handle], (size_t)offset, arr, (size_t)count);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentRead(AMX *amx, cell *params)
+{
+	return SegmentCopyImpl(amx, params, false);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentWrite(AMX *amx, cell *params)
+{
+	return SegmentCopyImpl(amx, params, true);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentGet(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_handle,
+		arg_index,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	cell value = 0;
+	if (params[arg_index] < 0 || segments::GetAttachedSegment(amx, params[arg_handle]) == NULL ||
+		segments::Read(params[arg_handle], (size_t)params[arg_index], &value, 1) == 0)
+		return amx_RaiseError(amx, AMX_ERR_BOUNDS), 0;
+	return value;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentSet(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_handle,
+		arg_index,
+		arg_value,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	if (params[arg_index] < 0 || segments::GetAttachedSegment(amx, params[arg_handle]) == NULL ||
+		segments::Write(params[arg_handle], (size_t)params[arg_index], &params[arg_value], 1) == 0)
+		return amx_RaiseError(amx, AMX_ERR_BOUNDS), 0;
+	return 1;
+}
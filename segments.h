@@ -0,0 +1,50 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _SEGMENTS_H
+#define _SEGMENTS_H
+
+#include <cstddef>
+#include "SDK/amx/amx.h"
+
+
+namespace segments
+{
+
+	enum SegmentType
+	{
+		SEGMENT_INT,
+		SEGMENT_FLOAT
+	};
+
+	/*
+		Registers and releases the script's attachments.
+		All segments attached by a script are detached when it's unloaded,
+		and a segment is freed when no script is attached to it anymore.
+	*/
+	void AmxLoad(AMX *amx);
+	void AmxUnload(AMX *amx);
+
+	/*
+		Copies cells from/to a segment. Versioned segments are protected with
+		a sequence lock, so readers always get a consistent snapshot, even if
+		they run on another thread. Return the number of copied cells.
+	*/
+	size_t Read(cell handle, size_t offset, cell dest[], size_t count);
+	size_t Write(cell handle, size_t offset, const cell src[], size_t count);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentAttach(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentDetach(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentSize(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentVersion(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentRead(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentWrite(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentGet(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SegmentSet(AMX *amx, cell *params);
+
+
+#endif // _SEGMENTS_H
@@ -0,0 +1,368 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "serialize.h"
+#include "pluginutils.h"
+
+
+namespace serialize
+{
+
+	namespace
+	{
+
+		enum FieldType
+		{
+			FIELD_INT,    // 'i' - zigzag varint
+			FIELD_UINT,   // 'u' - varint
+			FIELD_RAW,    // 'f', 'r' - cells copied as is
+			FIELD_STRING  // 's' - length and characters as varints
+		};
+
+		struct Field
+		{
+			FieldType type;
+			size_t num_cells;
+		};
+
+		struct Schema
+		{
+			std::vector<Field> fields;
+			size_t num_cells;
+		};
+
+		// Far more than a script can pass in one array (4 MiB), and few enough
+		// that a schema of integers ('i[N]' is N fields) fits in memory.
+		const size_t MAX_SCHEMA_CELLS = 1 << 20;
+
+		std::vector<Schema> schemas;
+		std::unordered_map<std::string, cell> schemas_by_text;
+
+		/*
+			Compiles a schema such as "iiu f[3] s[24] r[10]". Each letter may
+			be followed by a count in brackets; for 's' it's the size of the string.
+			Adjacent raw fields are merged so that they can be copied at once.
+			The whole schema may describe at most MAX_SCHEMA_CELLS cells.
+		*/
+		bool CompileSchema(const char *text, Schema &schema)
+		{
+			schema.fields.clear();
+			schema.num_cells = 0;
+			for (const char *p = text; *p != '\0'; )
+			{
+				const char c = *p++;
+				Field field;
+				switch (c)
+				{
+				case ' ':
+				case ',':
+					continue;
+				case 'i': case 'd':
+					field.type = FIELD_INT;
+					break;
+				case 'u':
+					field.type = FIELD_UINT;
+					break;
+				case 'f': case 'r':
+					field.type = FIELD_RAW;
+					break;
+				case 's':
+					field.type = FIELD_STRING;
+					break;
+				default:
+					return false;
+				}
+				size_t count = 1;
+				if (*p == '[')
+				{
+					char *end;
+					const unsigned long value = strtoul(p + 1, &end, 10);
+					if (*end != ']' || value == 0 || value > MAX_SCHEMA_CELLS)
+						return false;
+					count = (size_t)value;
+					p = end + 1;
+				}
+				if (count > MAX_SCHEMA_CELLS - schema.num_cells)
+					return false;
+				if (field.type == FIELD_STRING)
+				{
+					field.num_cells = count;
+					schema.fields.push_back(field);
+				}
+				else if (field.type == FIELD_RAW)
+				{
+					if (!schema.fields.empty() && schema.fields.back().type == FIELD_RAW)
+					{
+						schema.fields.back().num_cells += count;
+					}
+					else
+					{
+						field.num_cells = count;
+						schema.fields.push_back(field);
+					}
+				}
+				else
+				{
+					field.num_cells = 1;
+					schema.fields.insert(schema.fields.end(), count, field);
+				}
+				schema.num_cells += count;
+			}
+			return schema.num_cells != 0;
+		}
+
+		const Schema *GetSchema(cell handle)
+		{
+			if (handle <= 0 || (size_t)handle > schemas.size())
+				return NULL;
+			return &schemas[handle - 1];
+		}
+
+		FORCE_INLINE void WriteVarint(std::vector<unsigned char> &out, ucell value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back((unsigned char)(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back((unsigned char)value);
+		}
+
+		FORCE_INLINE bool ReadVarint(const unsigned char *&p, const unsigned char *end, ucell &value)
+		{
+			value = 0;
+			for (unsigned shift = 0; shift < sizeof(ucell) * 8; shift += 7)
+			{
+				if (p == end)
+					return false;
+				const unsigned char byte = *p++;
+				value |= (ucell)(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		FORCE_INLINE ucell ZigZagEncode(cell value)
+		{
+			return ((ucell)value << 1) ^ (ucell)(value >> (sizeof(cell) * 8 - 1));
+		}
+
+		FORCE_INLINE cell ZigZagDecode(ucell value)
+		{
+			return (cell)(value >> 1) ^ -(cell)(value & 1);
+		}
+
+		void Serialize(const Schema &schema, const cell *data, std::vector<unsigned char> &out)
+		{
+			for (size_t i = 0; i < schema.fields.size(); ++i)
+			{
+				const Field &field = schema.fields[i];
+				switch (field.type)
+				{
+				case FIELD_INT:
+					WriteVarint(out, ZigZagEncode(*data));
+					break;
+				case FIELD_UINT:
+					WriteVarint(out, (ucell)*data);
+					break;
+				case FIELD_RAW:
+				{
+					const size_t start = out.size();
+					out.resize(start + field.num_cells * sizeof(cell));
+					memcpy(&out[start], data, field.num_cells * sizeof(cell));
+					break;
+				}
+				case FIELD_STRING:
+				{
+					// A string that fills the whole field loses its last character,
+					// so that it fits with a terminator when it's deserialized.
+					size_t len = 0;
+					while (len + 1 < field.num_cells && data[len] != 0)
+						++len;
+					WriteVarint(out, (ucell)len);
+					for (size_t j = 0; j < len; ++j)
+						WriteVarint(out, (ucell)data[j]);
+					break;
+				}
+				}
+				data += field.num_cells;
+			}
+		}
+
+		bool Deserialize(const Schema &schema, const unsigned char *p, const unsigned char *end, cell *data)
+		{
+			for (size_t i = 0; i < schema.fields.size(); ++i)
+			{
+				const Field &field = schema.fields[i];
+				ucell value;
+				switch (field.type)
+				{
+				case FIELD_INT:
+					if (!ReadVarint(p, end, value))
+						return false;
+					*data = ZigZagDecode(value);
+					break;
+				case FIELD_UINT:
+					if (!ReadVarint(p, end, value))
+						return false;
+					*data = (cell)value;
+					break;
+				case FIELD_RAW:
+				{
+					const size_t size = field.num_cells * sizeof(cell);
+					if ((size_t)(end - p) < size)
+						return false;
+					memcpy(data, p, size);
+					p += size;
+					break;
+				}
+				case FIELD_STRING:
+				{
+					ucell len;
+					if (!ReadVarint(p, end, len) || len >= field.num_cells)
+						return false;
+					for (size_t j = 0; j < len; ++j)
+					{
+						if (!ReadVarint(p, end, value))
+							return false;
+						data[j] = (cell)value;
+					}
+					std::fill(&data[len], &data[field.num_cells], 0);
+					break;
+				}
+				}
+				data += field.num_cells;
+			}
+			return true;
+		}
+
+	}
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_SerialSchema(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_schema,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	int error;
+	char *text = pluginutils::GetCString(amx, params[arg_schema], error);
+	if (error != AMX_ERR_NONE)
+		return amx_RaiseError(amx, error), 0;
+	const std::string key(text);
+	free(text);
+	std::unordered_map<std::string, cell>::const_iterator it = serialize::schemas_by_text.find(key);
+	if (it != serialize::schemas_by_text.end())
+		return it->second;
+	serialize::Schema schema;
+	if (!serialize::CompileSchema(key.c_str(), schema))
+		return 0;
+	serialize::schemas.push_back(schema);
+	const cell handle = (cell)serialize::schemas.size();
+	serialize::schemas_by_text[key] = handle;
+	return handle;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SerialSchemaSize(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_schema,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const serialize::Schema *schema = serialize::GetSchema(params[arg_schema]);
+	return (schema != NULL) ? (cell)schema->num_cells : 0;
+}
+
+/*
+	The buffer is a packed array, so that blob{i} gives the i-th byte.
+*/
+cell AMX_NATIVE_CALL n_HelloWorld_Serialize(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_schema,
+		arg_data,
+		arg_dest,
+		arg_data_size,
+		arg_dest_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const serialize::Schema *schema = serialize::GetSchema(params[arg_schema]);
+	if (schema == NULL || params[arg_data_size] < (cell)schema->num_cells || params[arg_dest_size] <= 0)
+		return 0;
+	int error;
+	cell *data, *dest;
+	if ((data = pluginutils::GetArrayAddr(amx, params[arg_data], schema->num_cells, error)) == NULL ||
+		(dest = pluginutils::GetArrayAddr(amx, params[arg_dest], (size_t)params[arg_dest_size], error)) == NULL)
+		return amx_RaiseError(amx, error), 0;
+
+	thread_local std::vector<unsigned char> buffer;
+	buffer.clear();
+	serialize::Serialize(*schema, data, buffer);
+	const size_t num_bytes = buffer.size();
+	const size_t num_cells = (num_bytes + sizeof(cell) - 1) / sizeof(cell);
+	if (num_cells > (size_t)params[arg_dest_size])
+		return 0;
+	buffer.resize(num_cells * sizeof(cell), 0);
+	pluginutils::CopyAndAlignCellArray(dest, (cell *)(void *)&buffer[0], num_cells);
+	return (cell)num_bytes;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_Deserialize(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_schema,
+		arg_src,
+		arg_num_bytes,
+		arg_data,
+		arg_data_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const serialize::Schema *schema = serialize::GetSchema(params[arg_schema]);
+	const cell num_bytes = params[arg_num_bytes];
+	if (schema == NULL || params[arg_data_size] < (cell)schema->num_cells || num_bytes <= 0)
+		return 0;
+	const size_t num_cells = ((size_t)num_bytes + sizeof(cell) - 1) / sizeof(cell);
+	int error;
+	cell *src, *data;
+	if ((src = pluginutils::GetArrayAddr(amx, params[arg_src], num_cells, error)) == NULL ||
+		(data = pluginutils::GetArrayAddr(amx, params[arg_data], schema->num_cells, error)) == NULL)
+		return amx_RaiseError(amx, error), 0;
+
+	// Decode into a temporary copy, so that the array isn't left half-written
+	// if the input turns out to be malformed.
+	thread_local std::vector<cell> buffer, result;
+	buffer.resize(num_cells);
+	pluginutils::CopyAndAlignCellArray(&buffer[0], src, num_cells);
+	result.resize(schema->num_cells);
+	const unsigned char *begin = (const unsigned char *)(const void *)&buffer[0];
+	if (!serialize::Deserialize(*schema, begin, begin + num_bytes, &result[0]))
+		return 0;
+	memcpy(data, &result[0], schema->num_cells * sizeof(cell));
+	return (cell)schema->num_cells;
+}
@@ -0,0 +1,22 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _SERIALIZE_H
+#define _SERIALIZE_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Natives for packing arrays and enum-structs into compact binary buffers.
+	The layout is described by a schema string that is compiled once and
+	then referred to by a handle.
+*/
+cell AMX_NATIVE_CALL n_HelloWorld_SerialSchema(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SerialSchemaSize(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_Serialize(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_Deserialize(AMX *amx, cell *params);
+
+
+#endif // _SERIALIZE_H
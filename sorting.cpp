@@ -0,0 +1,396 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <cstring>
+#include <vector>
+#include "sorting.h"
+#include "pluginconfig.h"
+#include "pluginutils.h"
+#include "threadpool.h"
+
+#ifdef USE_SSE2
+	#include <emmintrin.h>
+#endif
+
+
+namespace sorting
+{
+
+	namespace
+	{
+
+		const unsigned RADIX_BITS = 8;
+		const size_t RADIX_SIZE = (size_t)1 << RADIX_BITS;
+		const ucell RADIX_MASK = (ucell)(RADIX_SIZE - 1);
+		const unsigned NUM_PASSES = (unsigned)sizeof(ucell) * 8 / RADIX_BITS;
+		const ucell SIGN_BIT = (ucell)1 << (sizeof(ucell) * 8 - 1);
+		const size_t MAX_SORT_THREADS = 16;
+
+		/*
+			Radix sort works on unsigned integers, so the values are converted
+			into keys that preserve the order when compared as unsigned.
+		*/
+		FORCE_INLINE ucell IntToKey(cell value)
+		{
+			return (ucell)value ^ SIGN_BIT;
+		}
+
+		FORCE_INLINE cell KeyToInt(ucell key)
+		{
+			return (cell)(key ^ SIGN_BIT);
+		}
+
+		FORCE_INLINE ucell FloatToKey(cell value)
+		{
+			const ucell bits = (ucell)value;
+			return (bits & SIGN_BIT) ? ~bits : (bits | SIGN_BIT);
+		}
+
+		FORCE_INLINE cell KeyToFloat(ucell key)
+		{
+			return (cell)((key & SIGN_BIT) ? (key & ~SIGN_BIT) : ~key);
+		}
+
+		FORCE_INLINE ucell ValueToKey(cell value, bool floats, bool descending)
+		{
+			const ucell key = floats ? FloatToKey(value) : IntToKey(value);
+			return descending ? ~key : key;
+		}
+
+		FORCE_INLINE cell KeyToValue(ucell key, bool floats, bool descending)
+		{
+			if (descending)
+				key = ~key;
+			return floats ? KeyToFloat(key) : KeyToInt(key);
+		}
+
+		size_t GetNumSortThreads(size_t num_keys)
+		{
+			if (num_keys < PLUGIN_PARALLEL_SORT_THRESHOLD)
+				return 1;
+			const size_t num_threads = threadpool::GetNumThreads();
+			return (num_threads > MAX_SORT_THREADS) ? MAX_SORT_THREADS : num_threads;
+		}
+
+		/*
+			Runs 'func(0)' ... 'func(num_tasks - 1)' on the thread pool
+			and waits for all of them to finish.
+		*/
+		template <typename Func>
+		void RunTasks(size_t num_tasks, const Func &func)
+		{
+			threadpool::ParallelFor(0, num_tasks, 1, [&func](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; ++i)
+					func(i);
+			});
+		}
+
+		/*
+			Sorts the keys and the optional values that go along with them.
+			The result is stored in 'keys' and 'vals'.
+		*/
+		void RadixSort(ucell keys[], ucell vals[], size_t num_keys)
+		{
+			if (num_keys < 2)
+				return;
+			const size_t num_threads = GetNumSortThreads(num_keys);
+			const size_t slice_size = (num_keys + num_threads - 1) / num_threads;
+			std::vector<ucell> keys_buf(num_keys), vals_buf((vals != NULL) ? num_keys : 0);
+			std::vector<size_t> counts(num_threads * RADIX_SIZE);
+			ucell *src_keys = keys, *dst_keys = &keys_buf[0];
+			ucell *src_vals = vals, *dst_vals = (vals != NULL) ? &vals_buf[0] : NULL;
+
+			for (unsigned pass = 0; pass < NUM_PASSES; ++pass)
+			{
+				const unsigned shift = pass * RADIX_BITS;
+
+				// Count the digits in each slice.
+				RunTasks(num_threads, [&](size_t thread_idx)
+				{
+					size_t *count = &counts[thread_idx * RADIX_SIZE];
+					memset(count, 0, RADIX_SIZE * sizeof(size_t));
+					const size_t begin = thread_idx * slice_size;
+					const size_t end = (begin + slice_size < num_keys) ? begin + slice_size : num_keys;
+					for (size_t i = begin; i < end; ++i)
+						++count[(src_keys[i] >> shift) & RADIX_MASK];
+				});
+
+				// Skip the pass if all keys have the same digit.
+				size_t digit_total = 0;
+				const size_t first_digit = (size_t)((src_keys[0] >> shift) & RADIX_MASK);
+				for (size_t t = 0; t < num_threads; ++t)
+					digit_total += counts[t * RADIX_SIZE + first_digit];
+				if (digit_total == num_keys)
+					continue;
+
+				// Turn the counts into starting positions, digit-major,
+				// so each slice writes its elements after the previous slices.
+				size_t offset = 0;
+				for (size_t digit = 0; digit < RADIX_SIZE; ++digit)
+				{
+					for (size_t t = 0; t < num_threads; ++t)
+					{
+						const size_t count = counts[t * RADIX_SIZE + digit];
+						counts[t * RADIX_SIZE + digit] = offset;
+						offset += count;
+					}
+				}
+
+				RunTasks(num_threads, [&](size_t thread_idx)
+				{
+					size_t *pos = &counts[thread_idx * RADIX_SIZE];
+					const size_t begin = thread_idx * slice_size;
+					const size_t end = (begin + slice_size < num_keys) ? begin + slice_size : num_keys;
+					for (size_t i = begin; i < end; ++i)
+					{
+						const size_t dst = pos[(src_keys[i] >> shift) & RADIX_MASK]++;
+						dst_keys[dst] = src_keys[i];
+						if (src_vals != NULL)
+							dst_vals[dst] = src_vals[i];
+					}
+				});
+
+				std::swap(src_keys, dst_keys);
+				std::swap(src_vals, dst_vals);
+			}
+
+			if (src_keys != keys)
+			{
+				memcpy(keys, src_keys, num_keys * sizeof(ucell));
+				if (vals != NULL)
+					memcpy(vals, src_vals, num_keys * sizeof(ucell));
+			}
+		}
+
+		/*
+			Branchless lower bound search (the loop body compiles into
+			a conditional move, so there are no mispredicted branches).
+		*/
+		template <ucell (*ToKey)(cell)>
+		cell SearchSorted(const cell arr[], size_t num_cells, cell value)
+		{
+			if (num_cells == 0)
+				return -1;
+			const ucell key = ToKey(value);
+			const cell *base = arr;
+			size_t len = num_cells;
+			while (len > 1)
+			{
+				const size_t half = len / 2;
+				base = (ToKey(base[half]) < key) ? base + half : base;
+				len -= half;
+			}
+			base += (ToKey(*base) < key) ? 1 : 0;
+			if (base == &arr[num_cells] || *base != value)
+				return -1;
+			return (cell)(base - arr);
+		}
+
+	}
+
+	void SortCells(cell arr[], size_t num_cells, bool floats, bool descending)
+	{
+		ucell *keys = (ucell *)arr;
+		for (size_t i = 0; i < num_cells; ++i)
+			keys[i] = ValueToKey(arr[i], floats, descending);
+		RadixSort(keys, NULL, num_cells);
+		for (size_t i = 0; i < num_cells; ++i)
+			arr[i] = KeyToValue(keys[i], floats, descending);
+	}
+
+	void SortOrder(const cell keys[], ucell order[], size_t num_keys, bool floats, bool descending)
+	{
+		std::vector<ucell> radix_keys(num_keys);
+		for (size_t i = 0; i < num_keys; ++i)
+		{
+			radix_keys[i] = ValueToKey(keys[i], floats, descending);
+			order[i] = (ucell)i;
+		}
+		if (num_keys != 0)
+			RadixSort(&radix_keys[0], order, num_keys);
+	}
+
+	cell BinarySearch(const cell arr[], size_t num_cells, cell value)
+	{
+		return SearchSorted<IntToKey>(arr, num_cells, value);
+	}
+
+	cell BinarySearchFloat(const cell arr[], size_t num_cells, cell value)
+	{
+		return SearchSorted<FloatToKey>(arr, num_cells, value);
+	}
+
+	cell LinearSearch(const cell arr[], size_t num_cells, cell value)
+	{
+		size_t i = 0;
+#ifdef USE_SSE2
+		const __m128i needle = _mm_set1_epi32((int)value);
+		for (; i + 16 <= num_cells; i += 16)
+		{
+			const __m128i *ptr = (const __m128i *)(const void *)&arr[i];
+			const __m128i eq0 = _mm_cmpeq_epi32(_mm_loadu_si128(ptr + 0), needle);
+			const __m128i eq1 = _mm_cmpeq_epi32(_mm_loadu_si128(ptr + 1), needle);
+			const __m128i eq2 = _mm_cmpeq_epi32(_mm_loadu_si128(ptr + 2), needle);
+			const __m128i eq3 = _mm_cmpeq_epi32(_mm_loadu_si128(ptr + 3), needle);
+			const __m128i any = _mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3));
+			if (_mm_movemask_epi8(any) != 0)
+				break;
+		}
+#else
+		for (; i + 4 <= num_cells; i += 4)
+			if (arr[i] == value || arr[i + 1] == value || arr[i + 2] == value || arr[i + 3] == value)
+				break;
+#endif
+		for (; i < num_cells; ++i)
+			if (arr[i] == value)
+				return (cell)i;
+		return -1;
+	}
+
+}
+
+
+static cell SortArrayImpl(AMX *amx, cell *params, bool floats)
+{
+	enum
+	{
+		args_size,
+		arg_array,
+		arg_size,
+		arg_descending,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell size = params[arg_size];
+	if (size <= 0)
+		return 0;
+	int error;
+	cell *arr = pluginutils::GetArrayAddr(amx, params[arg_array], (size_t)size, error);
+	if (arr == NULL)
+		return amx_RaiseError(amx, error), 0;
+	sorting::SortCells(arr, (size_t)size, floats, params[arg_descending] != 0);
+	return 1;
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SortArray(AMX *amx, cell *params)
+{
+	return SortArrayImpl(amx, params, false);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SortFloatArray(AMX *amx, cell *params)
+{
+	return SortArrayImpl(amx, params, true);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_SortArrayRows(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_array,
+		arg_column,
+		arg_descending,
+		arg_float_keys,
+		arg_rows,
+		arg_row_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return 0;
+	const cell num_rows = params[arg_rows], row_size = params[arg_row_size];
+	const cell column = params[arg_column];
+	if (num_rows <= 0 || row_size <= 0)
+		return 0;
+	if (column < 0 || column >= row_size)
+		return amx_RaiseError(amx, AMX_ERR_BOUNDS), 0;
+
+	// A two-dimensional array starts with an indirection vector that holds
+	// the offsets from each of its cells to the corresponding row.
+	int error;
+	const cell array_addr = params[arg_array];
+	cell *vector = pluginutils::GetArrayAddr(amx, array_addr, (size_t)num_rows, error);
+	if (vector == NULL)
+		return amx_RaiseError(amx, error), 0;
+	std::vector<cell *> rows((size_t)num_rows);
+	std::vector<cell> keys((size_t)num_rows);
+	for (cell i = 0; i < num_rows; ++i)
+	{
+		const cell row_addr = array_addr + i * (cell)sizeof(cell) + vector[i];
+		rows[i] = pluginutils::GetArrayAddr(amx, row_addr, (size_t)row_size, error);
+		if (rows[i] == NULL)
+			return amx_RaiseError(amx, error), 0;
+		keys[i] = rows[i][column];
+	}
+
+	std::vector<ucell> order((size_t)num_rows);
+	sorting::SortOrder(&keys[0], &order[0], (size_t)num_rows,
+		params[arg_float_keys] != 0, params[arg_descending] != 0);
+
+	// Rearrange the rows themselves, so the indirection vector stays intact.
+	const size_t row_bytes = (size_t)row_size * sizeof(cell);
+	std::vector<cell> sorted((size_t)num_rows * (size_t)row_size);
+	for (size_t i = 0; i < (size_t)num_rows; ++i)
+		memcpy(&sorted[i * (size_t)row_size], rows[order[i]], row_bytes);
+	for (size_t i = 0; i < (size_t)num_rows; ++i)
+		memcpy(rows[i], &sorted[i * (size_t)row_size], row_bytes);
+	return 1;
+}
+
+static cell SearchImpl(AMX *amx, cell *params, cell (*search)(const cell [], size_t, cell))
+{
+	enum
+	{
+		args_size,
+		arg_array,
+		arg_value,
+		arg_size,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	const cell size = params[arg_size];
+	if (size <= 0)
+		return -1;
+	int error;
+	const cell *arr = pluginutils::GetArrayAddr(amx, params[arg_array], (size_t)size, error);
+	if (arr == NULL)
+		return amx_RaiseError(amx, error), -1;
+	return search(arr, (size_t)size, params[arg_value]);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_BinarySearch(AMX *amx, cell *params)
+{
+	return SearchImpl(amx, params, sorting::BinarySearch);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_BinarySearchFloat(AMX *amx, cell *params)
+{
+	return SearchImpl(amx, params, sorting::BinarySearchFloat);
+}
+
+cell AMX_NATIVE_CALL n_HelloWorld_LinearSearch(AMX *amx, cell *params)
+{
+	enum
+	{
+		args_size,
+		arg_array,
+		arg_value,
+		arg_size,
+		arg_start,
+		__dummy_elem_, num_args_expected = __dummy_elem_ - 1
+	};
+	if (!CheckArgs())
+		return -1;
+	const cell size = params[arg_size], start = params[arg_start];
+	if (start < 0 || start >= size)
+		return -1;
+	int error;
+	const cell *arr = pluginutils::GetArrayAddr(amx, params[arg_array], (size_t)size, error);
+	if (arr == NULL)
+		return amx_RaiseError(amx, error), -1;
+	const cell result = sorting::LinearSearch(&arr[start], (size_t)(size - start), params[arg_value]);
+	return (result != -1) ? result + start : -1;
+}
@@ -0,0 +1,51 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _SORTING_H
+#define _SORTING_H
+
+#include <cstddef>
+#include "SDK/amx/amx.h"
+
+
+namespace sorting
+{
+
+	/*
+		Sorts an array of cells in place (LSD radix sort).
+		If 'floats' is true, the cells are compared as floating-point numbers.
+		Arrays larger than PLUGIN_PARALLEL_SORT_THRESHOLD are sorted by several threads.
+	*/
+	void SortCells(cell arr[], size_t num_cells, bool floats, bool descending);
+
+	/*
+		Computes the stable order in which the specified keys should go.
+		On return 'order' contains indices of the keys in the sorted sequence.
+	*/
+	void SortOrder(const cell keys[], ucell order[], size_t num_keys, bool floats, bool descending);
+
+	/*
+		Searches for a value in an array sorted in ascending order.
+		Returns the index of the first matching element or -1 if there's none.
+	*/
+	cell BinarySearch(const cell arr[], size_t num_cells, cell value);
+	cell BinarySearchFloat(const cell arr[], size_t num_cells, cell value);
+
+	/*
+		Returns the index of the first element equal to 'value' or -1.
+	*/
+	cell LinearSearch(const cell arr[], size_t num_cells, cell value);
+
+}
+
+
+cell AMX_NATIVE_CALL n_HelloWorld_SortArray(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SortFloatArray(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_SortArrayRows(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_BinarySearch(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_BinarySearchFloat(AMX *amx, cell *params);
+cell AMX_NATIVE_CALL n_HelloWorld_LinearSearch(AMX *amx, cell *params);
+
+
+#endif // _SORTING_H
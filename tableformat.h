@@ -0,0 +1,82 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _TABLEFORMAT_H
+#define _TABLEFORMAT_H
+
+#include <cstddef>
+#include <stdint.h>
+
+
+/*
+	Layout of the compiled data table files (.tbl) produced by the 'tablec' tool
+	and memory-mapped by the plugin.
+
+	All numbers are 32-bit little-endian, all offsets are in bytes from the
+	beginning of the file and are multiples of 4.
+
+		TableHeader
+		TableColumn columns[num_columns]
+		int32_t cells[num_rows * num_columns]   (row-major; string cells hold
+		                                         offsets into the string pool)
+		string pool                             (each string is stored as its
+		                                         length followed by the characters
+		                                         as 32-bit cells and a zero cell)
+		key index                               (see below)
+
+	Column 0 is the key column. If it's an integer or float column,
+	the key index is an array of row numbers sorted by key. If it's a string
+	column, the key index is an open-addressing hash table: the number of
+	buckets (a power of 2) followed by the buckets, each holding
+	a row number plus one, or 0 if the bucket is empty.
+*/
+
+const char TABLE_MAGIC[4] = { 'H', 'W', 'T', 'B' };
+const uint32_t TABLE_FORMAT_VERSION = 1;
+
+enum TableColumnType
+{
+	TABLE_COLUMN_INT,
+	TABLE_COLUMN_FLOAT,
+	TABLE_COLUMN_STRING
+};
+
+struct TableHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t num_rows;
+	uint32_t num_columns;
+	uint32_t columns_offset;
+	uint32_t cells_offset;
+	uint32_t strings_offset;
+	uint32_t strings_size;
+	uint32_t index_offset;
+	uint32_t index_size;
+};
+
+struct TableColumn
+{
+	uint32_t name_offset; // Offset of the column name in the string pool.
+	uint32_t type;        // TableColumnType
+};
+
+/*
+	Hash function for the string keys. Works on characters stored
+	in any integer type, so it gives the same result for cell strings.
+*/
+template <typename Char>
+inline uint32_t TableHashKey(const Char str[], size_t len)
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < len; ++i)
+	{
+		hash ^= (uint32_t)str[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+
+#endif // _TABLEFORMAT_H
@@ -0,0 +1,215 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "threadpool.h"
+#include "metrics.h"
+
+
+namespace threadpool
+{
+
+	namespace
+	{
+
+		// How many chunks each thread should get, so that the threads
+		// that finish early have something to steal.
+		const size_t CHUNKS_PER_THREAD = 4;
+
+		struct Task
+		{
+			const RangeFunc *func;
+			size_t begin, end;
+			std::atomic<size_t> *pending;
+		};
+
+		struct WorkQueue
+		{
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<std::thread> workers;
+
+		// Queue 0 is shared by all threads outside of the pool,
+		// the rest of the queues belong to the worker threads.
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+		thread_local size_t own_queue = 0;
+
+		std::mutex sleep_mutex;
+		std::condition_variable wake_cond;
+		std::atomic<size_t> num_queued(0);
+		std::atomic<bool> stopping(false);
+
+		// Updated by any thread.
+		MetricsEntry *loops;
+		MetricsEntry *chunks;
+		MetricsEntry *steals;
+
+		bool PopTask(size_t queue_idx, Task &task)
+		{
+			WorkQueue &queue = *queues[queue_idx];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty())
+				return false;
+			// Take the most recently queued chunk: its data is likely still in cache.
+			task = queue.tasks.back();
+			queue.tasks.pop_back();
+			num_queued.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		bool StealTask(size_t thief_idx, Task &task)
+		{
+			const size_t num_queues = queues.size();
+			for (size_t i = 1; i < num_queues; ++i)
+			{
+				WorkQueue &queue = *queues[(thief_idx + i) % num_queues];
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				if (queue.tasks.empty())
+					continue;
+				task = queue.tasks.front();
+				queue.tasks.pop_front();
+				num_queued.fetch_sub(1, std::memory_order_relaxed);
+				metrics::IncrementShared(steals);
+				return true;
+			}
+			return false;
+		}
+
+		inline bool FindTask(size_t queue_idx, Task &task)
+		{
+			return PopTask(queue_idx, task) || StealTask(queue_idx, task);
+		}
+
+		inline void RunTask(const Task &task)
+		{
+			(*task.func)(task.begin, task.end);
+			task.pending->fetch_sub(1, std::memory_order_release);
+		}
+
+		void WorkerMain(size_t queue_idx)
+		{
+			own_queue = queue_idx;
+			for (;;)
+			{
+				Task task;
+				if (FindTask(queue_idx, task))
+				{
+					RunTask(task);
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(sleep_mutex);
+				wake_cond.wait(lock, []
+				{
+					return stopping.load() || num_queued.load() != 0;
+				});
+				if (stopping.load())
+					return;
+			}
+		}
+
+	}
+
+	void Start(size_t num_threads)
+	{
+		if (!queues.empty())
+			return;
+		if (num_threads == 0)
+		{
+			num_threads = (size_t)std::thread::hardware_concurrency();
+			num_threads = (num_threads > 1) ? num_threads - 1 : 0;
+		}
+		stopping = false;
+		loops = metrics::AddCounter("threadpool.loops");
+		chunks = metrics::AddCounter("threadpool.chunks");
+		steals = metrics::AddCounter("threadpool.steals");
+		metrics::Set(metrics::AddGauge("threadpool.threads"), (int64_t)num_threads);
+		for (size_t i = 0; i <= num_threads; ++i)
+			queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue));
+		for (size_t i = 1; i <= num_threads; ++i)
+			workers.push_back(std::thread(WorkerMain, i));
+	}
+
+	void Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			stopping = true;
+		}
+		wake_cond.notify_all();
+		for (size_t i = 0; i < workers.size(); ++i)
+			workers[i].join();
+		workers.clear();
+		queues.clear();
+	}
+
+	size_t GetNumThreads()
+	{
+		return workers.size() + 1;
+	}
+
+	void ParallelFor(size_t begin, size_t end, size_t grain, const RangeFunc &func)
+	{
+		if (begin >= end)
+			return;
+		if (grain == 0)
+			grain = 1;
+		const size_t count = end - begin;
+		if (workers.empty() || count <= grain)
+		{
+			func(begin, end);
+			return;
+		}
+
+		size_t num_chunks = count / grain;
+		if (num_chunks > GetNumThreads() * CHUNKS_PER_THREAD)
+			num_chunks = GetNumThreads() * CHUNKS_PER_THREAD;
+		const size_t chunk_size = (count + num_chunks - 1) / num_chunks;
+		num_chunks = (count + chunk_size - 1) / chunk_size;
+		metrics::IncrementShared(loops);
+		metrics::IncrementShared(chunks, num_chunks);
+
+		// Give each queue a contiguous run of chunks.
+		std::atomic<size_t> pending(num_chunks);
+		const size_t num_queues = queues.size();
+		const size_t chunks_per_queue = (num_chunks + num_queues - 1) / num_queues;
+		size_t chunk_idx = 0;
+		for (size_t q = 0; q < num_queues && chunk_idx < num_chunks; ++q)
+		{
+			WorkQueue &queue = *queues[(own_queue + q) % num_queues];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			for (size_t i = 0; i < chunks_per_queue && chunk_idx < num_chunks; ++i, ++chunk_idx)
+			{
+				const size_t chunk_begin = begin + chunk_idx * chunk_size;
+				const size_t chunk_end = (chunk_begin + chunk_size < end) ? chunk_begin + chunk_size : end;
+				const Task task = { &func, chunk_begin, chunk_end, &pending };
+				// Push to the front, so the owner pops the chunks in ascending order.
+				queue.tasks.push_front(task);
+				num_queued.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+		}
+		wake_cond.notify_all();
+
+		// Help the workers until every chunk is done.
+		while (pending.load(std::memory_order_acquire) != 0)
+		{
+			Task task;
+			if (FindTask(own_queue, task))
+				RunTask(task);
+			else
+				std::this_thread::yield();
+		}
+	}
+
+}
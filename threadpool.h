@@ -0,0 +1,48 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _THREADPOOL_H
+#define _THREADPOOL_H
+
+#include <cstddef>
+#include <functional>
+
+
+namespace threadpool
+{
+
+	typedef std::function<void (size_t begin, size_t end)> RangeFunc;
+
+	/*
+		Starts the worker threads.
+		If 'num_threads' is 0, one thread per CPU core is started
+		(minus one for the server thread, which also takes part in the work).
+	*/
+	void Start(size_t num_threads = 0);
+
+	/*
+		Stops the worker threads. Must not be called while a loop is running.
+	*/
+	void Stop();
+
+	/*
+		Returns the number of threads a loop can be split across,
+		including the calling thread.
+	*/
+	size_t GetNumThreads();
+
+	/*
+		Splits [begin, end) into chunks of at least 'grain' iterations
+		and calls 'func(chunk_begin, chunk_end)' for each of them on the worker
+		threads. Idle workers steal chunks from the busy ones.
+		The calling thread takes part in the work, and the function returns only
+		after all chunks are done, so it's safe to pass pointers to script memory.
+		If the pool isn't started, the whole range is processed by the calling thread.
+	*/
+	void ParallelFor(size_t begin, size_t end, size_t grain, const RangeFunc &func);
+
+}
+
+
+#endif // _THREADPOOL_H
@@ -0,0 +1,308 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+/*
+	Prints the live metrics of a running server (see metricsformat.h).
+
+	Usage: metrics [-n name] <pid> [seconds]
+
+	'pid' is the process id of the server and 'name' is PLUGIN_METRICS_NAME
+	(the name the tool was built with by default). Without 'seconds',
+	the current values are printed. Otherwise the tool waits and prints how
+	much each metric has changed in that time: the increase and the rate of
+	the counters, and the samples added to the histograms. Histogram
+	percentiles are upper bounds (the buckets are powers of 2).
+*/
+
+#if defined _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include "metricsformat.h"
+
+#ifndef METRICS_NAME
+	#define METRICS_NAME "helloworld_metrics"
+#endif
+
+
+namespace
+{
+
+	struct Values
+	{
+		uint64_t value;
+		uint64_t sum;
+		uint64_t buckets[METRICS_NUM_BUCKETS];
+	};
+
+	struct Snapshot
+	{
+		std::vector<Values> values;
+		std::chrono::steady_clock::time_point time;
+	};
+
+	class Segment
+	{
+	public:
+		Segment() : data(NULL), size(0)
+#if defined _WIN32
+			, mapping_handle(NULL)
+#endif
+		{
+		}
+
+		~Segment()
+		{
+			Close();
+		}
+
+		bool Open(const std::string &name, unsigned pid);
+		void Close();
+
+		const MetricsHeader *GetHeader() const
+		{
+			return (const MetricsHeader *)data;
+		}
+
+		const MetricsEntry *GetEntries() const
+		{
+			return (const MetricsEntry *)(const void *)((const char *)data + GetHeader()->header_size);
+		}
+
+		bool IsValid() const
+		{
+			const MetricsHeader *header = GetHeader();
+			return size >= sizeof(MetricsHeader) &&
+				memcmp(header->magic, METRICS_MAGIC, sizeof(header->magic)) == 0 &&
+				header->version == METRICS_FORMAT_VERSION &&
+				header->header_size == sizeof(MetricsHeader) &&
+				header->entry_size == sizeof(MetricsEntry) &&
+				(uint64_t)header->header_size + (uint64_t)header->max_entries * header->entry_size <= size;
+		}
+
+		uint32_t GetNumEntries() const
+		{
+			const uint32_t num_entries = reinterpret_cast<const std::atomic<uint32_t> *>(
+				&GetHeader()->num_entries)->load(std::memory_order_acquire);
+			return (num_entries <= GetHeader()->max_entries) ? num_entries : GetHeader()->max_entries;
+		}
+
+	private:
+		Segment(const Segment &);
+		Segment &operator=(const Segment &);
+
+		const void *data;
+		size_t size;
+#if defined _WIN32
+		HANDLE mapping_handle;
+#endif
+	};
+
+#if defined _WIN32
+
+	bool Segment::Open(const std::string &name, unsigned pid)
+	{
+		char full_name[256];
+		snprintf(full_name, sizeof(full_name), "Local\\%s.%u", name.c_str(), pid);
+		mapping_handle = OpenFileMappingA(FILE_MAP_READ, FALSE, full_name);
+		if (mapping_handle == NULL)
+			return false;
+		MEMORY_BASIC_INFORMATION info;
+		if ((data = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0)) == NULL ||
+			VirtualQuery(data, &info, sizeof(info)) == 0)
+		{
+			Close();
+			return false;
+		}
+		size = (size_t)info.RegionSize;
+		return true;
+	}
+
+	void Segment::Close()
+	{
+		if (data != NULL)
+			UnmapViewOfFile(data);
+		if (mapping_handle != NULL)
+			CloseHandle(mapping_handle);
+		data = NULL;
+		size = 0;
+		mapping_handle = NULL;
+	}
+
+#else // _WIN32
+
+	bool Segment::Open(const std::string &name, unsigned pid)
+	{
+		char full_name[256];
+		snprintf(full_name, sizeof(full_name), "/%s.%u", name.c_str(), pid);
+		const int fd = shm_open(full_name, O_RDONLY, 0);
+		if (fd == -1)
+			return false;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0)
+		{
+			close(fd);
+			return false;
+		}
+		void *ptr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (ptr == MAP_FAILED)
+			return false;
+		data = ptr;
+		size = (size_t)st.st_size;
+		return true;
+	}
+
+	void Segment::Close()
+	{
+		if (data != NULL)
+			munmap(const_cast<void *>(data), size);
+		data = NULL;
+		size = 0;
+	}
+
+#endif // _WIN32
+
+	uint64_t Load(const uint64_t &value)
+	{
+		return reinterpret_cast<const std::atomic<uint64_t> *>(&value)->load(std::memory_order_relaxed);
+	}
+
+	void TakeSnapshot(const Segment &segment, Snapshot &snapshot)
+	{
+		const uint32_t num_entries = segment.GetNumEntries();
+		const MetricsEntry *entries = segment.GetEntries();
+		snapshot.values.resize(num_entries);
+		for (uint32_t i = 0; i < num_entries; ++i)
+		{
+			Values &values = snapshot.values[i];
+			values.value = Load(entries[i].value);
+			values.sum = Load(entries[i].sum);
+			for (size_t j = 0; j < METRICS_NUM_BUCKETS; ++j)
+				values.buckets[j] = Load(entries[i].buckets[j]);
+		}
+		snapshot.time = std::chrono::steady_clock::now();
+	}
+
+	/*
+		The upper bound of the bucket the given share of the samples falls into.
+	*/
+	uint64_t GetPercentile(const Values &values, double share)
+	{
+		uint64_t count = 0;
+		for (size_t i = 0; i < METRICS_NUM_BUCKETS; ++i)
+			count += values.buckets[i];
+		const uint64_t target = (uint64_t)(count * share + 0.5);
+		uint64_t seen = 0;
+		for (size_t i = 0; i < METRICS_NUM_BUCKETS; ++i)
+		{
+			seen += values.buckets[i];
+			if (seen >= target && seen != 0)
+				return (i == 0) ? 0 : ((uint64_t)1 << i) - 1;
+		}
+		return 0;
+	}
+
+	void PrintEntry(const MetricsEntry &entry, const Values &values, double seconds)
+	{
+		switch (entry.type)
+		{
+		case METRIC_COUNTER:
+			if (seconds > 0.0)
+			{
+				printf("%-44s %14llu %14.1f/s\n", entry.name,
+					(unsigned long long)values.value, values.value / seconds);
+			}
+			else
+			{
+				printf("%-44s %14llu\n", entry.name, (unsigned long long)values.value);
+			}
+			break;
+		case METRIC_GAUGE:
+			printf("%-44s %14lld\n", entry.name, (long long)values.value);
+			break;
+		case METRIC_HISTOGRAM:
+			printf("%-44s %14llu  mean %.1f  p50 %llu  p99 %llu  max %llu\n", entry.name,
+				(unsigned long long)values.value,
+				(values.value != 0) ? (double)values.sum / values.value : 0.0,
+				(unsigned long long)GetPercentile(values, 0.5),
+				(unsigned long long)GetPercentile(values, 0.99),
+				(unsigned long long)GetPercentile(values, 1.0));
+			break;
+		}
+	}
+
+}
+
+int main(int argc, char **argv)
+{
+	std::string name = METRICS_NAME;
+	int arg = 1;
+	if (arg + 1 < argc && strcmp(argv[arg], "-n") == 0)
+	{
+		name = argv[arg + 1];
+		arg += 2;
+	}
+	if (arg >= argc || arg + 2 < argc)
+	{
+		fprintf(stderr, "Usage: %s [-n name] <pid> [seconds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	const unsigned pid = (unsigned)strtoul(argv[arg], NULL, 10);
+	const double seconds = (arg + 1 < argc) ? atof(argv[arg + 1]) : 0.0;
+
+	Segment segment;
+	if (!segment.Open(name, pid))
+	{
+		fprintf(stderr, "Can't open the metrics of process %u (\"%s\").\n", pid, name.c_str());
+		return EXIT_FAILURE;
+	}
+	if (!segment.IsValid())
+	{
+		fprintf(stderr, "The metrics of process %u have an unknown layout.\n", pid);
+		return EXIT_FAILURE;
+	}
+
+	Snapshot before, after;
+	TakeSnapshot(segment, before);
+	if (seconds > 0.0)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+		TakeSnapshot(segment, after);
+		// The metrics registered in the meantime started from 0.
+		before.values.resize(after.values.size(), Values());
+	}
+	const Snapshot &current = (seconds > 0.0) ? after : before;
+	const double elapsed = (seconds > 0.0)
+		? std::chrono::duration<double>(after.time - before.time).count()
+		: 0.0;
+
+	const MetricsEntry *entries = segment.GetEntries();
+	for (size_t i = 0; i < current.values.size(); ++i)
+	{
+		Values values = current.values[i];
+		if (seconds > 0.0 && entries[i].type != METRIC_GAUGE)
+		{
+			values.value -= before.values[i].value;
+			values.sum -= before.values[i].sum;
+			for (size_t j = 0; j < METRICS_NUM_BUCKETS; ++j)
+				values.buckets[j] -= before.values[i].buckets[j];
+		}
+		PrintEntry(entries[i], values, elapsed);
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,310 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+/*
+	Compiles a CSV file into a data table (.tbl) that can be memory-mapped
+	by the plugin.
+
+	Usage: tablec <input.csv> <output.tbl>
+
+	The first line of the input is the header. Each column is declared
+	as "name:type", where type is one of "int", "float" or "string"
+	(defaults to "string"). The first column is the key column.
+	Fields can be enclosed in double quotes, in which case they can contain
+	commas, line breaks and doubled quotes.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include "tableformat.h"
+
+
+namespace
+{
+
+	typedef std::vector<std::string> Record;
+
+	struct Column
+	{
+		std::string name;
+		TableColumnType type;
+	};
+
+	class StringPool
+	{
+	public:
+		uint32_t Add(const std::string &str)
+		{
+			std::map<std::string, uint32_t>::const_iterator it = offsets.find(str);
+			if (it != offsets.end())
+				return it->second;
+			const uint32_t offset = (uint32_t)(data.size() * sizeof(int32_t));
+			data.push_back((int32_t)str.length());
+			for (size_t i = 0; i < str.length(); ++i)
+				data.push_back((int32_t)(unsigned char)str[i]);
+			data.push_back(0);
+			offsets[str] = offset;
+			return offset;
+		}
+
+		const std::vector<int32_t> &GetData() const { return data; }
+
+	private:
+		std::vector<int32_t> data;
+		std::map<std::string, uint32_t> offsets;
+	};
+
+	bool ReadRecord(FILE *file, Record &record)
+	{
+		record.clear();
+		int c = fgetc(file);
+		if (c == EOF)
+			return false;
+		std::string field;
+		bool quoted = false;
+		for (;; c = fgetc(file))
+		{
+			if (quoted)
+			{
+				if (c == EOF)
+					break;
+				if (c == '"')
+				{
+					c = fgetc(file);
+					if (c != '"')
+					{
+						quoted = false;
+						ungetc(c, file);
+						continue;
+					}
+				}
+				field += (char)c;
+				continue;
+			}
+			if (c == EOF || c == '\n')
+				break;
+			if (c == '\r')
+				continue;
+			if (c == '"' && field.empty())
+			{
+				quoted = true;
+				continue;
+			}
+			if (c == ',')
+			{
+				record.push_back(field);
+				field.clear();
+				continue;
+			}
+			field += (char)c;
+		}
+		record.push_back(field);
+		return true;
+	}
+
+	bool ParseColumn(const std::string &decl, Column &column)
+	{
+		const size_t colon = decl.rfind(':');
+		column.name = decl.substr(0, colon);
+		column.type = TABLE_COLUMN_STRING;
+		if (colon == std::string::npos)
+			return true;
+		const std::string type = decl.substr(colon + 1);
+		if (type == "int")
+			column.type = TABLE_COLUMN_INT;
+		else if (type == "float")
+			column.type = TABLE_COLUMN_FLOAT;
+		else if (type != "string")
+			return false;
+		return true;
+	}
+
+	bool ParseValue(const std::string &str, TableColumnType type, int32_t &value)
+	{
+		char *end;
+		if (type == TABLE_COLUMN_INT)
+		{
+			value = (int32_t)strtol(str.c_str(), &end, 0);
+		}
+		else
+		{
+			const float f = strtof(str.c_str(), &end);
+			if (f != f)
+				return false; // NaN keys can't be sorted.
+			memcpy(&value, &f, sizeof(value));
+		}
+		return !str.empty() && *end == '\0';
+	}
+
+	uint32_t GetNumBuckets(size_t num_rows)
+	{
+		// Keep the load factor at or below 0.5.
+		uint32_t num_buckets = 1;
+		while (num_buckets < num_rows * 2)
+			num_buckets *= 2;
+		return num_buckets;
+	}
+
+	template <typename T>
+	void Write(FILE *file, const std::vector<T> &data)
+	{
+		if (!data.empty())
+			fwrite(&data[0], sizeof(T), data.size(), file);
+	}
+
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: %s <input.csv> <output.tbl>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	FILE *input = fopen(argv[1], "rb");
+	if (input == NULL)
+	{
+		fprintf(stderr, "Can't open \"%s\".\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	Record record;
+	std::vector<Column> columns;
+	if (ReadRecord(input, record))
+	{
+		columns.resize(record.size());
+		for (size_t i = 0; i < record.size(); ++i)
+		{
+			if (!ParseColumn(record[i], columns[i]))
+			{
+				fprintf(stderr, "%s: Invalid type of column \"%s\".\n", argv[1], record[i].c_str());
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	if (columns.empty())
+	{
+		fprintf(stderr, "%s: The header is missing.\n", argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	StringPool strings;
+	std::vector<TableColumn> table_columns(columns.size());
+	for (size_t i = 0; i < columns.size(); ++i)
+	{
+		table_columns[i].name_offset = strings.Add(columns[i].name);
+		table_columns[i].type = columns[i].type;
+	}
+
+	std::vector<int32_t> cells;
+	uint32_t num_rows = 0;
+	for (unsigned line = 2; ReadRecord(input, record); ++line)
+	{
+		if (record.size() == 1 && record[0].empty())
+			continue;
+		if (record.size() != columns.size())
+		{
+			fprintf(stderr, "%s:%u: Expected %u fields, got %u.\n", argv[1], line,
+				(unsigned)columns.size(), (unsigned)record.size());
+			return EXIT_FAILURE;
+		}
+		for (size_t i = 0; i < columns.size(); ++i)
+		{
+			int32_t value;
+			if (columns[i].type == TABLE_COLUMN_STRING)
+			{
+				value = (int32_t)strings.Add(record[i]);
+			}
+			else if (!ParseValue(record[i], columns[i].type, value))
+			{
+				fprintf(stderr, "%s:%u: Invalid value \"%s\" in column \"%s\".\n", argv[1], line,
+					record[i].c_str(), columns[i].name.c_str());
+				return EXIT_FAILURE;
+			}
+			cells.push_back(value);
+		}
+		++num_rows;
+	}
+	fclose(input);
+
+	// Build the key index.
+	const size_t num_columns = columns.size();
+	std::vector<uint32_t> index;
+	if (columns[0].type == TABLE_COLUMN_STRING)
+	{
+		const uint32_t num_buckets = GetNumBuckets(num_rows);
+		const std::vector<int32_t> &pool = strings.GetData();
+		index.resize(num_buckets + 1, 0);
+		index[0] = num_buckets;
+		for (uint32_t row = 0; row < num_rows; ++row)
+		{
+			const int32_t *key = &pool[cells[row * num_columns] / sizeof(int32_t)];
+			uint32_t bucket = TableHashKey(&key[1], (size_t)key[0]) & (num_buckets - 1);
+			while (index[bucket + 1] != 0)
+				bucket = (bucket + 1) & (num_buckets - 1);
+			index[bucket + 1] = row + 1;
+		}
+	}
+	else
+	{
+		index.resize(num_rows);
+		// Insertion into a sorted map keeps equal keys in their original order.
+		std::multimap<float, uint32_t> float_keys;
+		std::multimap<int32_t, uint32_t> int_keys;
+		for (uint32_t row = 0; row < num_rows; ++row)
+		{
+			const int32_t key = cells[row * num_columns];
+			if (columns[0].type == TABLE_COLUMN_FLOAT)
+			{
+				float f;
+				memcpy(&f, &key, sizeof(f));
+				float_keys.insert(std::make_pair(f, row));
+			}
+			else
+			{
+				int_keys.insert(std::make_pair(key, row));
+			}
+		}
+		size_t i = 0;
+		for (std::multimap<float, uint32_t>::const_iterator it = float_keys.begin(); it != float_keys.end(); ++it)
+			index[i++] = it->second;
+		for (std::multimap<int32_t, uint32_t>::const_iterator it = int_keys.begin(); it != int_keys.end(); ++it)
+			index[i++] = it->second;
+	}
+
+	TableHeader header;
+	memcpy(header.magic, TABLE_MAGIC, sizeof(header.magic));
+	header.version = TABLE_FORMAT_VERSION;
+	header.num_rows = num_rows;
+	header.num_columns = (uint32_t)num_columns;
+	header.columns_offset = sizeof(TableHeader);
+	header.cells_offset = header.columns_offset + (uint32_t)(table_columns.size() * sizeof(TableColumn));
+	header.strings_offset = header.cells_offset + (uint32_t)(cells.size() * sizeof(int32_t));
+	header.strings_size = (uint32_t)(strings.GetData().size() * sizeof(int32_t));
+	header.index_offset = header.strings_offset + header.strings_size;
+	header.index_size = (uint32_t)(index.size() * sizeof(uint32_t));
+
+	FILE *output = fopen(argv[2], "wb");
+	if (output == NULL)
+	{
+		fprintf(stderr, "Can't create \"%s\".\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	fwrite(&header, sizeof(header), 1, output);
+	Write(output, table_columns);
+	Write(output, cells);
+	Write(output, strings.GetData());
+	Write(output, index);
+	if (fclose(output) != 0)
+	{
+		fprintf(stderr, "Failed to write \"%s\".\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+	printf("%s: %u rows, %u columns.\n", argv[2], num_rows, (unsigned)num_columns);
+	return EXIT_SUCCESS;
+}
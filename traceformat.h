@@ -0,0 +1,98 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _TRACEFORMAT_H
+#define _TRACEFORMAT_H
+
+#include <stdint.h>
+
+
+/*
+	Layout of the native call traces written by the recorder (see recorder.h)
+	and read by the 'replay' tool.
+
+	All numbers are little-endian, all sizes are in bytes and are multiples of 4.
+
+		TraceHeader
+		records                                 (each one starts with
+		                                         a TraceRecordHeader)
+
+	TRACE_RECORD_NATIVE gives the name of a native id:
+
+		TraceRecordHeader
+		uint32_t native_id
+		char name[]                             (zero-terminated, padded
+		                                         with zeros to a multiple of 4)
+
+	TRACE_RECORD_CALL is one call of a native:
+
+		TraceRecordHeader
+		TraceCall
+		int32_t args[num_args]                  (the params array without
+		                                         params[0])
+		payloads                                (until the end of the record,
+		                                         see below)
+
+	An argument that is a valid address in the script (data, heap or stack)
+	may be a reference, a string or an array, or just a number that happens
+	to look like an address: the recorder can't tell. So it stores the memory
+	at every such address (up to a limit) as a payload: a TracePayload
+	followed by num_cells cells, and then num_zero_cells zero cells that
+	aren't stored. The replay puts the payloads at the same addresses
+	in its own script and passes the arguments as they were.
+
+	TRACE_RECORD_DROPPED tells that a number of calls were lost because
+	the recording thread's buffer was full:
+
+		TraceRecordHeader
+		uint32_t num_calls
+*/
+
+const char TRACE_MAGIC[4] = { 'H', 'W', 'T', 'R' };
+const uint32_t TRACE_FORMAT_VERSION = 1;
+
+enum TraceRecordType
+{
+	TRACE_RECORD_NATIVE = 1,
+	TRACE_RECORD_CALL,
+	TRACE_RECORD_DROPPED
+};
+
+struct TraceHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t cell_size;
+	uint32_t reserved;
+};
+
+struct TraceRecordHeader
+{
+	uint32_t type; // TraceRecordType
+	uint32_t size; // Including this header.
+};
+
+struct TraceCall
+{
+	uint32_t native_id;
+	uint32_t script_id;  // Tells the scripts apart, the value means nothing.
+	uint32_t thread_id;  // Order in which the recording threads made their first call.
+	uint32_t depth;      // 0, or the number of recorded calls this one is nested in
+	                     // (e.g. a native called by HelloWorld_BatchCall).
+	uint64_t start_ns;   // Since the recording started.
+	uint32_t duration_ns;
+	int32_t result;
+	uint32_t num_args;
+	uint32_t num_payloads;
+};
+
+struct TracePayload
+{
+	uint32_t arg_index; // Index into args.
+	uint32_t num_cells;
+	uint32_t num_zero_cells;
+};
+
+
+#endif // _TRACEFORMAT_H
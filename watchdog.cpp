@@ -0,0 +1,324 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "watchdog.h"
+#include "amxdebug.h"
+#include "exechook.h"
+#include "pluginconfig.h"
+#include "pluginutils.h"
+#include "scripts.h"
+
+
+extern void *(*logprintf)(const char *fmt, ...);
+
+namespace watchdog
+{
+
+	namespace
+	{
+
+		typedef std::chrono::steady_clock Clock;
+
+		const size_t MAX_FRAMES = 16;
+
+		// The public of a script found by its stack rather than through exechook.
+		const int UNKNOWN_PUBLIC = -100;
+
+		struct Sample
+		{
+			exechook::ExecInfo exec;
+			std::vector<cell> cips; // Where the script is, then the return addresses.
+			bool complete;          // The last return address is in the public.
+		};
+
+		struct Stall
+		{
+			int64_t tick_start; // Nanoseconds since the clock's epoch.
+			std::vector<Sample> samples;
+		};
+
+		// Written by the server thread, read by the watchdog thread.
+		std::atomic<int64_t> last_tick(0); // 0 until the first tick.
+		std::atomic<unsigned> tick_count(0);
+
+		// Shared with the watchdog thread.
+		std::mutex watchdog_mutex;
+		std::condition_variable watchdog_cond;
+		bool stopping;
+		std::vector<Stall> stalls;
+		std::atomic<bool> has_stalls(false);
+		std::thread watcher;
+		// The loaded scripts. A script is removed before it's freed, so the
+		// watchdog thread can read any script in here while it holds the lock.
+		std::vector<AMX *> watched_scripts;
+
+		// Loaded when a script is first reported, NULL if it has no debug info.
+		// Used by the server thread only.
+		std::map<AMX *, std::unique_ptr<amxdebug::DebugInfo> > debug_infos;
+
+		int64_t Now()
+		{
+			return (int64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+				Clock::now().time_since_epoch()).count();
+		}
+
+		/*
+			Reads the state of a script running on another thread. The values
+			may change while they are read, so everything is checked before use.
+		*/
+		void WalkStack(const AMX &amx, Sample &sample)
+		{
+			const AMX_HEADER *hdr = (const AMX_HEADER *)amx.base;
+			const unsigned char *data = (amx.data != NULL) ? amx.data : amx.base + (size_t)hdr->dat;
+			sample.cips.push_back(amx.cip);
+			sample.complete = false;
+			cell frm = amx.frm;
+			while (sample.cips.size() < MAX_FRAMES)
+			{
+				if (frm < amx.stk || frm > amx.stp - 2 * (cell)sizeof(cell) || frm % (cell)sizeof(cell) != 0)
+					break;
+				const cell *frame = (const cell *)(const void *)(data + (size_t)frm);
+				const cell prev_frm = frame[0], return_address = frame[1];
+				// amx_Exec starts the call chain with a zero return address.
+				if (return_address == 0)
+				{
+					sample.complete = true;
+					break;
+				}
+				sample.cips.push_back(return_address);
+				if (prev_frm <= frm)
+					break;
+				frm = prev_frm;
+			}
+		}
+
+		/*
+			Finds the script that is being executed. If exechook hasn't seen
+			the call, the scripts that are in the middle of a call are found by
+			their stack: it's empty (stk == stp) between calls. Called with
+			watchdog_mutex held.
+		*/
+		void TakeSnapshot(Stall &stall)
+		{
+			Sample sample;
+			if (exechook::GetCurrent(sample.exec))
+			{
+				WalkStack(*sample.exec.amx, sample);
+				stall.samples.push_back(sample);
+				return;
+			}
+			for (size_t i = 0; i < watched_scripts.size(); ++i)
+			{
+				const AMX amx = *watched_scripts[i];
+				if (amx.stk >= amx.stp)
+					continue;
+				sample.exec.amx = watched_scripts[i];
+				sample.exec.index = UNKNOWN_PUBLIC;
+				sample.cips.clear();
+				WalkStack(amx, sample);
+				stall.samples.push_back(sample);
+			}
+		}
+
+		void WatchdogThread()
+		{
+			const std::chrono::milliseconds interval(std::max(PLUGIN_WATCHDOG_THRESHOLD / 4, 1u));
+			const int64_t threshold = (int64_t)PLUGIN_WATCHDOG_THRESHOLD * 1000000;
+			unsigned reported_tick = 0;
+			std::unique_lock<std::mutex> lock(watchdog_mutex);
+			while (!stopping)
+			{
+				watchdog_cond.wait_for(lock, interval, [] { return stopping; });
+				const unsigned tick = tick_count.load(std::memory_order_acquire);
+				const int64_t tick_start = last_tick.load(std::memory_order_acquire);
+				if (stopping || tick_start == 0 || tick == reported_tick || Now() - tick_start < threshold)
+					continue;
+				reported_tick = tick;
+				Stall stall;
+				stall.tick_start = tick_start;
+				TakeSnapshot(stall);
+				stalls.push_back(stall);
+				has_stalls = true;
+			}
+		}
+
+		const amxdebug::DebugInfo *GetDebugInfo(AMX *amx)
+		{
+			std::map<AMX *, std::unique_ptr<amxdebug::DebugInfo> >::iterator it = debug_infos.find(amx);
+			if (it == debug_infos.end())
+			{
+				std::unique_ptr<amxdebug::DebugInfo> info(new amxdebug::DebugInfo);
+				if (!amxdebug::Load(amx, *info))
+					info.reset();
+				it = debug_infos.insert(std::make_pair(amx, std::move(info))).first;
+			}
+			return it->second.get();
+		}
+
+		/*
+			The function, source file and line of the address. Without the
+			debug info, the name of the function isn't known: the publics
+			table would only give the nearest public, which is wrong for
+			anything in between (stocks, static functions).
+		*/
+		std::string Symbolize(const amxdebug::DebugInfo *info, cell address)
+		{
+			// The addresses point past a call (of a native or a function),
+			// which may be the last instruction of its line.
+			--address;
+			const amxdebug::Function *func = (info != NULL) ? amxdebug::FindFunction(*info, address) : NULL;
+			if (func == NULL)
+				return "(name unknown)";
+			std::string result = func->name;
+			const amxdebug::Line *line = amxdebug::FindLine(*info, address);
+			const amxdebug::File *file = amxdebug::FindFile(*info, address);
+			if (line != NULL && file != NULL)
+			{
+				char location[32];
+				snprintf(location, sizeof(location), ":%d", (int)line->line + 1);
+				result += " at " + file->name + location;
+			}
+			return result;
+		}
+
+		/*
+			The public the call stack starts in, if the stack was walked to its
+			end and the function there starts exactly where a public does.
+		*/
+		bool FindOutermostPublic(AMX *amx, const amxdebug::DebugInfo *info, const Sample &sample,
+			char (&name)[sNAMEMAX + 1])
+		{
+			if (info == NULL || !sample.complete)
+				return false;
+			const amxdebug::Function *func = amxdebug::FindFunction(*info, sample.cips.back() - 1);
+			if (func == NULL)
+				return false;
+			int num_publics;
+			if (amx_NumPublics(amx, &num_publics) != AMX_ERR_NONE)
+				return false;
+			const AMX_HEADER *hdr = (const AMX_HEADER *)amx->base;
+			const unsigned char *publics = amx->base + (size_t)hdr->publics;
+			for (int i = 0; i < num_publics; ++i)
+			{
+				const AMX_FUNCSTUB *stub = (const AMX_FUNCSTUB *)(const void *)(publics + (size_t)i * (size_t)hdr->defsize);
+				if (stub->address == func->start)
+					return amx_GetPublic(amx, i, name) == AMX_ERR_NONE;
+			}
+			return false;
+		}
+
+		void ReportSample(const Sample &sample)
+		{
+			AMX *amx = sample.exec.amx;
+			const std::vector<AMX *> &all = scripts::GetAll();
+			const std::vector<AMX *>::const_iterator it = std::find(all.begin(), all.end(), amx);
+			if (it == all.end())
+			{
+				logprintf("%s:   The script being executed has been unloaded since.", PLUGIN_NAME);
+				return;
+			}
+			const amxdebug::DebugInfo *info = GetDebugInfo(amx);
+			char public_name[sNAMEMAX + 1] = "(unknown)";
+			if (sample.exec.index == AMX_EXEC_MAIN)
+				snprintf(public_name, sizeof(public_name), "main");
+			else if (sample.exec.index == AMX_EXEC_CONT)
+				snprintf(public_name, sizeof(public_name), "(continued)");
+			else if (sample.exec.index == UNKNOWN_PUBLIC && !FindOutermostPublic(amx, info, sample, public_name))
+				snprintf(public_name, sizeof(public_name), "a callback (name unknown)");
+			else
+				amx_GetPublic(amx, sample.exec.index, public_name);
+			// GetCurrentNativeFunctionName may need to call amx_Exec, so it's not
+			// used by the watchdog thread. The code doesn't change, only cip did.
+			AMX amx_at_stall = *amx;
+			amx_at_stall.cip = sample.cips[0];
+			logprintf("%s:   Script #%u was executing %s, last native called: %s.", PLUGIN_NAME,
+				(unsigned)(it - all.begin()), public_name, pluginutils::GetCurrentNativeFunctionName(&amx_at_stall));
+			for (size_t i = 0; i < sample.cips.size(); ++i)
+			{
+				logprintf("%s:     #%u 0x%08X %s", PLUGIN_NAME, (unsigned)i,
+					(unsigned)sample.cips[i], Symbolize(info, sample.cips[i]).c_str());
+			}
+		}
+
+		void Report(const Stall &stall, int64_t now)
+		{
+			logprintf("%s: The server tick took %u ms (more than %u ms).", PLUGIN_NAME,
+				(unsigned)((now - stall.tick_start) / 1000000), PLUGIN_WATCHDOG_THRESHOLD);
+			if (stall.samples.empty())
+			{
+				logprintf("%s:   No script was being executed.", PLUGIN_NAME);
+				return;
+			}
+			for (size_t i = 0; i < stall.samples.size(); ++i)
+				ReportSample(stall.samples[i]);
+		}
+
+	}
+
+	void Load()
+	{
+		if (PLUGIN_WATCHDOG_THRESHOLD == 0)
+			return;
+		last_tick = 0;
+		stopping = false;
+		watcher = std::thread(WatchdogThread);
+	}
+
+	void Unload()
+	{
+		{
+			std::lock_guard<std::mutex> lock(watchdog_mutex);
+			stopping = true;
+		}
+		watchdog_cond.notify_one();
+		if (watcher.joinable())
+			watcher.join();
+		stalls.clear();
+		has_stalls = false;
+		debug_infos.clear();
+	}
+
+	void AmxLoad(AMX *amx)
+	{
+		std::lock_guard<std::mutex> lock(watchdog_mutex);
+		watched_scripts.push_back(amx);
+	}
+
+	void AmxUnload(AMX *amx)
+	{
+		debug_infos.erase(amx);
+		std::lock_guard<std::mutex> lock(watchdog_mutex);
+		watched_scripts.erase(std::remove(watched_scripts.begin(), watched_scripts.end(), amx),
+			watched_scripts.end());
+	}
+
+	void ProcessTick()
+	{
+		const int64_t now = Now();
+		last_tick.store(now, std::memory_order_release);
+		tick_count.fetch_add(1, std::memory_order_release);
+		if (!has_stalls.load(std::memory_order_relaxed))
+			return;
+		std::vector<Stall> reports;
+		{
+			std::lock_guard<std::mutex> lock(watchdog_mutex);
+			reports.swap(stalls);
+			has_stalls = false;
+		}
+		for (size_t i = 0; i < reports.size(); ++i)
+			Report(reports[i], now);
+	}
+
+}
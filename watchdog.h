@@ -0,0 +1,56 @@
+/*
+	TODO: Put your copyright notice and license text here.
+*/
+
+#ifndef _WATCHDOG_H
+#define _WATCHDOG_H
+
+#include "SDK/amx/amx.h"
+
+
+/*
+	Reports server ticks that take longer than PLUGIN_WATCHDOG_THRESHOLD
+	milliseconds, and where the server was stuck.
+
+	A thread checks how long ago ProcessTick was last called. When the
+	threshold is exceeded, it samples the script being executed: the public,
+	the last native called and the call stack, from the script's cip and frm.
+	The report is printed by the next ProcessTick, i.e. on the server thread,
+	once the server has recovered.
+
+	The script and public are known from exechook.h. The calls it doesn't
+	see (see there) are found by the script's stack instead, which is only
+	empty between calls. The public is then only named if the whole call
+	stack could be walked and the debug info shows that it starts in one.
+
+	Functions are named from the debug info in the script's .amx file
+	(amxdebug.h). Without it the report shows only addresses.
+
+	The interpreter keeps cip, frm and stk in the AMX structure up to date
+	only when it calls a native, so a script stuck in a loop that calls
+	no natives is shown where it called its last native. A callback without
+	arguments that hasn't called a native yet isn't seen at all.
+*/
+namespace watchdog
+{
+
+	/*
+		Starts the watchdog thread (unless PLUGIN_WATCHDOG_THRESHOLD is 0).
+		Ticks are checked from the first ProcessTick call on, so that loading
+		the scripts doesn't count as a stall.
+	*/
+	void Load();
+	void Unload();
+
+	/*
+		Keeps track of the scripts the watchdog thread may look into.
+	*/
+	void AmxLoad(AMX *amx);
+	void AmxUnload(AMX *amx);
+
+	void ProcessTick();
+
+}
+
+
+#endif // _WATCHDOG_H